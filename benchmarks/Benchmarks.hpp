@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+// Average time of one call to func over runs calls, in nanoseconds.
+// func returns something that depends on its work, so the compiler
+// can't skip it
+template <typename Func>
+double nanosecondsPerRun(size_t runs, const Func& func)
+{
+    volatile float sink = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < runs; i++) {
+        sink = sink + func(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count()
+        / runs;
+}
+
+// The benchmarks print their timings and return false if the code they
+// time gave a wrong result
+
+// Shots against a scene of colliderCount spheres and boxes, through the
+// BVH and through every pool one after the other
+bool runBvhBenchmark(size_t colliderCount);
+
+// SpherePool::closestHit through each SIMD kernel and the scalar tail,
+// after checking they all agree with intersectRaySphere
+bool runSpherePoolBenchmark();
\ No newline at end of file
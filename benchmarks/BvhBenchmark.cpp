@@ -0,0 +1,141 @@
+#include "Benchmarks.hpp"
+
+#include "Bvh.hpp"
+#include "ColliderStore.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr size_t RAY_COUNT = 1024;
+constexpr size_t RUNS = 20000;
+
+// rotation around the vertical axis, so boxes aren't all axis aligned
+glm::mat3 yawRotation(float angle)
+{
+    float c = std::cos(angle);
+    float s = std::sin(angle);
+    return glm::mat3(glm::vec3(c, 0.0f, -s), glm::vec3(0.0f, 1.0f, 0.0f),
+        glm::vec3(s, 0.0f, c));
+}
+
+// Targets spread over a room the size of the play area, half spheres
+// and half boxes
+void buildScene(ColliderStore& colliders, size_t count, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> coord(-10.0f, 10.0f);
+    std::uniform_real_distribution<float> height(0.0f, 20.0f);
+    std::uniform_real_distribution<float> size(0.2f, 1.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2832f);
+
+    colliders.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        ColliderPose pose;
+        pose.pos = { coord(rng), height(rng), coord(rng) };
+        if (i % 2 == 0) {
+            pose.size = glm::vec3(size(rng));
+            colliders.add(ColliderShape::Sphere, pose, i);
+        } else {
+            pose.size = { size(rng), size(rng), size(rng) };
+            pose.rotation = yawRotation(angle(rng));
+            colliders.add(ColliderShape::Box, pose, i);
+        }
+    }
+}
+
+// What shots did before the BVH, every collider of every pool
+std::optional<ColliderHit> linearClosestHit(const ColliderStore& colliders,
+    const std::array<size_t, COLLIDER_SHAPE_COUNT>& poolSizes,
+    const glm::vec3& eyePos, const glm::vec3& eyeDir)
+{
+    std::optional<ColliderHit> result = std::nullopt;
+    float closestDist = FLT_MAX;
+    for (size_t shape = 0; shape < COLLIDER_SHAPE_COUNT; shape++) {
+        auto hit = colliders.closestHitInPool((ColliderShape)shape, 0,
+            poolSizes[shape], eyePos, eyeDir, closestDist);
+        if (hit.has_value()) {
+            closestDist = hit->dist;
+            result = hit;
+        }
+    }
+
+    return result;
+}
+
+}
+
+bool runBvhBenchmark(size_t colliderCount)
+{
+    std::mt19937 rng(colliderCount);
+
+    ColliderStore colliders;
+    buildScene(colliders, colliderCount, rng);
+    Bvh bvh;
+    bvh.build(colliders);
+
+    std::array<size_t, COLLIDER_SHAPE_COUNT> poolSizes = {};
+    std::vector<ColliderHandle> handles;
+    colliders.handles(handles);
+    for (ColliderHandle collider : handles) {
+        poolSizes[(size_t)colliders.shape(collider)]++;
+    }
+
+    // shots from anywhere in the room, in any direction
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<glm::vec3> eyePositions(RAY_COUNT);
+    std::vector<glm::vec3> eyeDirs(RAY_COUNT);
+    for (size_t i = 0; i < RAY_COUNT; i++) {
+        eyePositions[i]
+            = { unit(rng) * 10, unit(rng) * 10 + 10, unit(rng) * 10 };
+        eyeDirs[i]
+            = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)));
+    }
+
+    // both have to find the same collider for the timings to mean anything
+    size_t hits = 0;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < RAY_COUNT; i++) {
+        auto bvhHit = bvh.closestHit(colliders, eyePositions[i], eyeDirs[i]);
+        auto linearHit = linearClosestHit(
+            colliders, poolSizes, eyePositions[i], eyeDirs[i]);
+        hits += linearHit.has_value();
+        if (bvhHit.has_value() != linearHit.has_value()
+            || (bvhHit.has_value()
+                && bvhHit->collider != linearHit->collider)) {
+            mismatches++;
+        }
+    }
+
+    const auto toDist = [](const std::optional<ColliderHit>& hit) {
+        return hit.has_value() ? hit->dist : 0.0f;
+    };
+    double bvhNs = nanosecondsPerRun(RUNS, [&](size_t run) {
+        size_t i = run % RAY_COUNT;
+        return toDist(bvh.closestHit(colliders, eyePositions[i], eyeDirs[i]));
+    });
+    double linearNs = nanosecondsPerRun(RUNS, [&](size_t run) {
+        size_t i = run % RAY_COUNT;
+        return toDist(linearClosestHit(
+            colliders, poolSizes, eyePositions[i], eyeDirs[i]));
+    });
+
+    std::cout << std::fixed << std::setprecision(1) << "bvh: " << colliderCount
+              << " colliders, " << hits << "/" << RAY_COUNT
+              << " rays hit, Bvh::closestHit " << bvhNs << " ns, linear "
+              << linearNs << " ns (" << linearNs / bvhNs << "x)";
+    if (mismatches > 0) {
+        std::cout << ", " << mismatches << " MISMATCHES";
+    }
+    std::cout << "\n";
+
+    return mismatches == 0;
+}
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "Benchmarks.hpp"
+
+#include "ColliderPools.hpp"
+#include "Simd.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr size_t SPHERE_COUNT = 4096;
+constexpr size_t RAY_COUNT = 256;
+constexpr size_t RUNS = 2000;
+
+// Enough to go through every kernel in every combination: AVX2 does 8
+// spheres at a time, SSE 4, and the scalar tail the rest
+constexpr size_t MAX_CHECKED_FIRST = 16;
+constexpr size_t MAX_CHECKED_COUNT = 40;
+
+struct Kernel {
+    const char* name;
+    // ranges of this many spheres only go through that kernel
+    size_t rangeSize;
+};
+
+// Spheres in front of the eye, close enough that rays go through a few
+// of them, so hits have to be compared with each other
+void fillPool(SpherePool& spheres, size_t count, std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> coord(-4.0f, 4.0f);
+    std::uniform_real_distribution<float> depth(5.0f, 30.0f);
+    std::uniform_real_distribution<float> size(0.2f, 2.0f);
+
+    spheres.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        ColliderPose pose;
+        pose.pos = { coord(rng), coord(rng), -depth(rng) };
+        pose.size = glm::vec3(size(rng));
+        spheres.pushBack(pose);
+    }
+}
+
+// The path the kernels have to agree with
+std::optional<BatchHit> scalarClosestHit(const SpherePool& spheres,
+    size_t first, size_t count, const glm::vec3& eyePos,
+    const glm::vec3& eyeDir)
+{
+    std::optional<BatchHit> result = std::nullopt;
+    float closestDist = FLT_MAX;
+    for (size_t i = first; i < first + count; i++) {
+        auto dist = intersectRaySphere(
+            eyePos, eyeDir, spheres.center(i), spheres.radius(i));
+        if (dist.has_value() && dist.value() < closestDist) {
+            closestDist = dist.value();
+            result = { i, closestDist };
+        }
+    }
+
+    return result;
+}
+
+// Time per sphere when the whole pool goes through closestHit in ranges
+// of rangeSize, one ray per run
+template <typename ClosestHit>
+double nanosecondsPerSphere(size_t rangeSize,
+    const std::vector<glm::vec3>& eyeDirs, const ClosestHit& closestHit)
+{
+    size_t tested = SPHERE_COUNT / rangeSize * rangeSize;
+    double runNs = nanosecondsPerRun(RUNS, [&](size_t run) {
+        const glm::vec3& eyeDir = eyeDirs[run % eyeDirs.size()];
+        float sum = 0.0f;
+        for (size_t first = 0; first < tested; first += rangeSize) {
+            auto hit = closestHit(first, rangeSize, eyeDir);
+            sum += hit.has_value() ? hit->dist : 0.0f;
+        }
+        return sum;
+    });
+
+    return runNs / tested;
+}
+
+}
+
+bool runSpherePoolBenchmark()
+{
+    std::mt19937 rng(SPHERE_COUNT);
+
+    SpherePool spheres;
+    fillPool(spheres, SPHERE_COUNT, rng);
+
+    std::uniform_real_distribution<float> spread(-0.2f, 0.2f);
+    std::vector<glm::vec3> eyeDirs(RAY_COUNT);
+    for (auto& eyeDir : eyeDirs) {
+        eyeDir = glm::normalize(glm::vec3(spread(rng), spread(rng), -1.0f));
+    }
+    glm::vec3 eyePos(0.0f);
+
+    // same sphere at the same distance, bit for bit
+    size_t checks = 0;
+    size_t mismatches = 0;
+    for (const auto& eyeDir : eyeDirs) {
+        for (size_t first = 0; first < MAX_CHECKED_FIRST; first++) {
+            for (size_t count = 0; count <= MAX_CHECKED_COUNT; count++) {
+                auto hit = spheres.closestHit(
+                    first, count, eyePos, eyeDir, FLT_MAX);
+                auto expected
+                    = scalarClosestHit(spheres, first, count, eyePos, eyeDir);
+                checks++;
+                if (hit.has_value() != expected.has_value()
+                    || (hit.has_value()
+                        && (hit->index != expected->index
+                            || hit->dist != expected->dist))) {
+                    mismatches++;
+                }
+            }
+        }
+    }
+
+    std::cout << "spheres: " << checks << " ranges checked against "
+              << "intersectRaySphere";
+    if (mismatches > 0) {
+        std::cout << ", " << mismatches << " MISMATCHES";
+    }
+    std::cout << "\n";
+
+    std::vector<Kernel> kernels;
+#ifdef OPENAIM_SIMD_AVX2
+    kernels.push_back({ "AVX2", SPHERE_COUNT });
+    kernels.push_back({ "SSE", 4 });
+#elif defined(OPENAIM_SIMD_SSE)
+    std::cout << "spheres: AVX2 not built, configure with OPENAIM_AVX2\n";
+    kernels.push_back({ "SSE", SPHERE_COUNT });
+#else
+    std::cout << "spheres: no SIMD kernels on this target\n";
+#endif
+    kernels.push_back({ "scalar tail", 3 });
+
+    // the scalar loop over the same ranges is the baseline
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& kernel : kernels) {
+        double kernelNs = nanosecondsPerSphere(kernel.rangeSize, eyeDirs,
+            [&](size_t first, size_t count, const glm::vec3& eyeDir) {
+                return spheres.closestHit(
+                    first, count, eyePos, eyeDir, FLT_MAX);
+            });
+        double scalarNs = nanosecondsPerSphere(kernel.rangeSize, eyeDirs,
+            [&](size_t first, size_t count, const glm::vec3& eyeDir) {
+                return scalarClosestHit(spheres, first, count, eyePos, eyeDir);
+            });
+
+        std::cout << "spheres: " << kernel.name << " in ranges of "
+                  << kernel.rangeSize << ", " << kernelNs
+                  << " ns per sphere, scalar " << scalarNs << " ns ("
+                  << scalarNs / kernelNs << "x)\n";
+    }
+
+    return mismatches == 0;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#include "Benchmarks.hpp"
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+// Runs every benchmark, or only the one named by the first argument.
+// Fails if any of them got a wrong result
+int main(int argc, char** argv)
+{
+    std::string only = argc > 1 ? argv[1] : "";
+    bool ok = true;
+
+    if (only.empty() || only == "bvh") {
+        for (size_t count : { 100, 1000, 10000 }) {
+            ok &= runBvhBenchmark(count);
+        }
+    }
+
+    if (only.empty() || only == "spheres") {
+        ok &= runSpherePoolBenchmark();
+    }
+
+    return ok ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,9 @@
+#version 330 core
+// Fullscreen triangle, no vertex buffer needed
+out vec2 ScreenPos;
+
+void main()
+{
+    ScreenPos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+    gl_Position = vec4(ScreenPos, 0.0, 1.0);
+}
\ No newline at end of file
@@ -1,12 +1,21 @@
-#version 330 core
+#version 430 core
 layout (location = 0) in vec3 aPos;
 
 out vec3 FragPos;
 
-uniform mat4 mvp;
+layout (std140, binding = 0) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+};
+
+uniform mat4 model;
+
+#include "movement.glsl"
 
 void main()
 {
     FragPos = aPos;
-    gl_Position = mvp * vec4(aPos, 1.0);
+    gl_Position = projection * view
+        * vec4(vec3(model * vec4(aPos, 1.0)) + movementOffset(), 1.0);
 }
\ No newline at end of file
@@ -1,4 +1,4 @@
-#version 330 core
+#version 430 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
@@ -7,14 +7,21 @@ out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
+layout (std140, binding = 0) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+};
+
 uniform mat4 model;
 uniform mat3 normal;
-uniform mat4 mvp;
+
+#include "movement.glsl"
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    FragPos = vec3(model * vec4(aPos, 1.0)) + movementOffset();
     Normal = normal * aNormal;
     TexCoords = aTexCoords;    
-    gl_Position = mvp * vec4(aPos, 1.0);
+    gl_Position = projection * view * vec4(FragPos, 1.0);
 }
\ No newline at end of file
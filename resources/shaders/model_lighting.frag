@@ -1,5 +1,7 @@
-#version 330 core
-out vec4 FragColor;
+#version 420 core
+layout (location = 0) out vec4 FragColor;
+// only written to when the target has an id attachment, 0 means nothing
+layout (location = 1) out uint EntityId;
 
 struct Material {
     sampler2D diffuse;
@@ -22,9 +24,15 @@ in vec3 FragPos;
 in vec3 Normal;  
 in vec2 TexCoords;
 
-uniform vec3 viewPos;
+layout (std140, binding = 0) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+};
+
 uniform Material material;
 uniform Light light;
+uniform uint entityId;
 
 void main()
 {
@@ -39,7 +47,7 @@ void main()
     vec3 diffuse = light.diffuse * diff * texture(material.diffuse, TexCoords).rgb;  
     
     // specular
-    // vec3 viewDir = normalize(viewPos - FragPos);
+    // vec3 viewDir = normalize(viewPos.xyz - FragPos);
     // vec3 reflectDir = reflect(-lightDir, norm);  
     // float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     // vec3 specular = light.specular * spec * texture(material.specular, TexCoords).rgb;
@@ -47,4 +55,5 @@ void main()
         
     vec3 result = ambient + diffuse + specular;
     FragColor = vec4(result, 1.0);
+    EntityId = entityId;
 } 
\ No newline at end of file
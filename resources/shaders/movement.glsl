@@ -0,0 +1,88 @@
+// Offset of GPU moved targets, included by the vertex shaders. Same
+// operations in the same order as evaluateMovements() and fastCos() in
+// Movement.cpp, so targets are drawn where shots hit them
+
+struct GpuMovement {
+    // depends on the kind, which is params[0].w (-1 for none)
+    vec4 params[3];
+};
+
+layout (std430, binding = 1) readonly buffer Movements {
+    GpuMovement movements[];
+};
+
+// -1 if the entity isn't moved by the GPU
+uniform int movementIndex = -1;
+uniform float movementTime;
+
+const float MOVEMENT_PI = 3.14159265358979323846;
+const float MOVEMENT_TWO_PI = 2.0 * MOVEMENT_PI;
+
+float movementFract(float x)
+{
+    precise float truncated = float(int(x));
+    truncated -= truncated > x ? 1.0 : 0.0;
+    return x - truncated;
+}
+
+float movementCos(float angle)
+{
+    precise float x
+        = (movementFract(angle / MOVEMENT_TWO_PI + 0.5) - 0.5) * MOVEMENT_TWO_PI;
+    x = abs(x);
+    bool flipped = x > MOVEMENT_PI / 2.0;
+    x = flipped ? MOVEMENT_PI - x : x;
+
+    precise float x2 = x * x;
+    precise float result = -1.0 / 3628800.0;
+    result = result * x2 + 1.0 / 40320.0;
+    result = result * x2 - 1.0 / 720.0;
+    result = result * x2 + 1.0 / 24.0;
+    result = result * x2 - 1.0 / 2.0;
+    result = result * x2 + 1.0;
+    return flipped ? -result : result;
+}
+
+float movementSin(float x)
+{
+    return movementCos(x - MOVEMENT_PI / 2.0);
+}
+
+vec3 movementOffset()
+{
+    if (movementIndex < 0) {
+        return vec3(0.0);
+    }
+
+    GpuMovement movement = movements[movementIndex];
+    int kind = int(movement.params[0].w);
+    precise float time = movementTime;
+
+    // lissajous
+    if (kind == 0) {
+        precise vec3 angle
+            = movement.params[1].xyz * time + movement.params[2].xyz;
+        vec3 cosines = vec3(
+            movementCos(angle.x), movementCos(angle.y), movementCos(angle.z));
+        return movement.params[0].xyz * cosines;
+    }
+
+    // circle
+    if (kind == 1) {
+        precise float angle
+            = movement.params[0].y * time + movement.params[0].z;
+        return movement.params[0].x
+            * (movementCos(angle) * movement.params[1].xyz
+                + movementSin(angle) * movement.params[2].xyz);
+    }
+
+    // ping pong
+    if (kind == 2) {
+        precise float progress = 1.0
+            - abs(2.0 * movementFract(time / movement.params[2].x) - 1.0);
+        return movement.params[0].xyz
+            + (movement.params[1].xyz - movement.params[0].xyz) * progress;
+    }
+
+    return vec3(0.0);
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#version 330 core
+out vec4 FragColor;
+
+// normalized device coordinates of this fragment on the screen
+in vec2 ScreenPos;
+
+uniform sampler2D scene;
+// Takes a direction in the view space of the latest camera orientation
+// to the view space the scene was rendered with (late warp)
+uniform mat3 reprojection;
+// tangent of half the field of view, for x and y
+uniform vec2 screenTanHalfFov;
+uniform vec2 sceneTanHalfFov;
+// fraction of the scene texture that was rendered to (dynamic resolution)
+uniform vec2 uvScale;
+// 0 disables sharpening
+uniform float sharpness;
+
+vec3 sampleScene(vec2 uv)
+{
+    // never sample outside what was rendered this frame
+    vec2 halfTexel = 0.5 / vec2(textureSize(scene, 0));
+    return texture(scene, clamp(uv, halfTexel, uvScale - halfTexel)).rgb;
+}
+
+void main()
+{
+    vec3 dir = reprojection * vec3(ScreenPos * screenTanHalfFov, -1.0);
+    vec2 ndc = (dir.xy / -dir.z) / sceneTanHalfFov;
+    vec2 uv = (ndc * 0.5 + 0.5) * uvScale;
+
+    vec3 center = sampleScene(uv);
+    if (sharpness <= 0.0) {
+        FragColor = vec4(center, 1.0);
+        return;
+    }
+
+    // contrast adaptive sharpening, a simplified version of AMD's CAS.
+    // Sharpens less where there is already a lot of contrast
+    vec2 texel = 1.0 / vec2(textureSize(scene, 0));
+    vec3 up = sampleScene(uv + vec2(0.0, texel.y));
+    vec3 down = sampleScene(uv - vec2(0.0, texel.y));
+    vec3 left = sampleScene(uv - vec2(texel.x, 0.0));
+    vec3 right = sampleScene(uv + vec2(texel.x, 0.0));
+
+    vec3 minRgb = min(center, min(min(up, down), min(left, right)));
+    vec3 maxRgb = max(center, max(max(up, down), max(left, right)));
+    vec3 amplitude = sqrt(clamp(min(minRgb, 1.0 - maxRgb) / max(maxRgb, 0.0001), 0.0, 1.0));
+    vec3 weight = amplitude * (-1.0 / mix(8.0, 5.0, sharpness));
+
+    vec3 result = (center + (up + down + left + right) * weight) / (1.0 + 4.0 * weight);
+    FragColor = vec4(clamp(result, 0.0, 1.0), 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include "Aabb.hpp"
+
+#include <algorithm>
+
+void Aabb::grow(const Aabb& other)
+{
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+}
+
+glm::vec3 Aabb::center() const
+{
+    return (min + max) * 0.5f;
+}
+
+float Aabb::surfaceArea() const
+{
+    glm::vec3 extent = max - min;
+    return 2
+        * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+}
+
+std::optional<float> intersectRayAabb(const Aabb& box,
+    const glm::vec3& eyePos, const glm::vec3& invDir, float maxDist)
+{
+    glm::vec3 t1 = (box.min - eyePos) * invDir;
+    glm::vec3 t2 = (box.max - eyePos) * invDir;
+    glm::vec3 tNear = glm::min(t1, t2);
+    glm::vec3 tFar = glm::max(t1, t2);
+
+    float tEnter = std::max(std::max(tNear.x, tNear.y), tNear.z);
+    float tExit = std::min(std::min(tFar.x, tFar.y), tFar.z);
+
+    if (tExit < 0 || tEnter > tExit || tEnter > maxDist) {
+        return std::nullopt;
+    }
+
+    return std::max(tEnter, 0.0f);
+}
\ No newline at end of file
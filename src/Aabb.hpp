@@ -0,0 +1,22 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <optional>
+
+// Axis aligned bounding box
+struct Aabb {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    void grow(const Aabb& other);
+    glm::vec3 center() const;
+    float surfaceArea() const;
+};
+
+// Slab test. Returns the distance along the ray at which it enters the
+// box (0 if it starts inside), or nullopt if it misses it or enters
+// after maxDist. invDir is 1 / the direction of the ray
+std::optional<float> intersectRayAabb(const Aabb& box,
+    const glm::vec3& eyePos, const glm::vec3& invDir, float maxDist);
\ No newline at end of file
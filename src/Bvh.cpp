@@ -0,0 +1,457 @@
+#include "Bvh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cfloat>
+
+namespace {
+
+// colliders per leaf before we even consider splitting, about what the
+// pool kernels test in one go
+constexpr uint32_t MAX_LEAF_SIZE = 4;
+constexpr int SAH_BIN_COUNT = 12;
+// relative cost of testing a node's box vs testing a collider
+constexpr float TRAVERSAL_COST = 1.0f;
+constexpr float INTERSECTION_COST = 2.0f;
+// Nodes this deep stay leaves whatever their size. Traversal keeps at
+// most one node per level waiting, so its stack has a fixed size
+constexpr uint32_t MAX_DEPTH = 64;
+constexpr size_t STACK_SIZE = MAX_DEPTH + 1;
+
+}
+
+void Bvh::build(ColliderStore& colliders)
+{
+    m_nodes.clear();
+    colliders.handles(m_colliders);
+    m_colliderCount = m_colliders.size();
+    m_leafOfCollider.assign(colliders.handleLimit(), -1);
+
+    if (m_colliders.empty()) {
+        return;
+    }
+
+    // bounds by handle, they are needed a lot while building
+    m_bounds.resize(colliders.handleLimit());
+    for (ColliderHandle collider : m_colliders) {
+        m_bounds[collider] = colliders.bounds(collider);
+    }
+
+    // a binary tree with n leaves has 2n - 1 nodes
+    m_nodes.reserve(m_colliders.size() * 2);
+
+    Node root;
+    root.first = 0;
+    root.count = m_colliders.size();
+    for (ColliderHandle collider : m_colliders) {
+        root.bounds.grow(m_bounds[collider]);
+    }
+    m_nodes.push_back(root);
+    subdivide(m_bounds, 0, 0);
+
+    // Lays out the pools in leaf order, each leaf then covers one range
+    // per pool
+    for (auto& order : m_poolOrders) {
+        order.clear();
+    }
+    for (uint32_t nodeIndex = 0; nodeIndex < m_nodes.size(); nodeIndex++) {
+        Node& node = m_nodes[nodeIndex];
+        if (node.count == 0) {
+            continue;
+        }
+
+        auto begin = m_colliders.begin() + node.first;
+        std::stable_sort(begin, begin + node.count,
+            [&](ColliderHandle a, ColliderHandle b) {
+                return colliders.shape(a) < colliders.shape(b);
+            });
+
+        for (uint32_t i = node.first; i < node.first + node.count; i++) {
+            ColliderHandle collider = m_colliders[i];
+            auto shape = (size_t)colliders.shape(collider);
+            if (node.poolCount[shape] == 0) {
+                node.poolFirst[shape] = m_poolOrders[shape].size();
+            }
+            node.poolCount[shape]++;
+            m_poolOrders[shape].push_back(colliders.poolIndex(collider));
+            m_leafOfCollider[collider] = nodeIndex;
+        }
+    }
+
+    for (size_t shape = 0; shape < COLLIDER_SHAPE_COUNT; shape++) {
+        colliders.reorderPool((ColliderShape)shape, m_poolOrders[shape]);
+    }
+}
+
+void Bvh::refit(const ColliderStore& colliders, ColliderHandle collider)
+{
+    if (collider >= m_leafOfCollider.size()
+        || m_leafOfCollider[collider] == -1) {
+        return;
+    }
+
+    refitLeaf(colliders, m_leafOfCollider[collider]);
+}
+
+void Bvh::remove(ColliderStore& colliders, ColliderHandle collider)
+{
+    if (collider >= m_leafOfCollider.size()
+        || m_leafOfCollider[collider] == -1) {
+        return;
+    }
+
+    ColliderShape shape = colliders.shape(collider);
+    auto shapeIndex = (size_t)shape;
+    int32_t leafIndex = m_leafOfCollider[collider];
+    m_leafOfCollider[collider] = -1;
+    m_colliderCount--;
+
+    // to the end of its leaf's range, which then stops before it
+    Node& leaf = m_nodes[leafIndex];
+    size_t end = leaf.poolFirst[shapeIndex] + leaf.poolCount[shapeIndex] - 1;
+    colliders.swapInPool(shape, colliders.poolIndex(collider), end);
+    leaf.poolCount[shapeIndex]--;
+
+    // The last collider of the pool ends its own leaf's range. It's
+    // swapped with the removed one and joins this leaf, so the store
+    // popping the last collider doesn't move anything
+    size_t last = colliders.poolSize(shape) - 1;
+    if (end != last) {
+        ColliderHandle moved = colliders.handleInPool(shape, last);
+        int32_t ownerIndex = m_leafOfCollider[moved];
+        colliders.swapInPool(shape, end, last);
+        m_nodes[ownerIndex].poolCount[shapeIndex]--;
+        leaf.poolCount[shapeIndex]++;
+        m_leafOfCollider[moved] = leafIndex;
+        refitLeaf(colliders, ownerIndex);
+    }
+
+    refitLeaf(colliders, leafIndex);
+}
+
+void Bvh::refitLeaf(const ColliderStore& colliders, int32_t nodeIndex)
+{
+    updateLeafBounds(colliders, m_nodes[nodeIndex]);
+
+    nodeIndex = m_nodes[nodeIndex].parent;
+    while (nodeIndex != -1) {
+        Node& node = m_nodes[nodeIndex];
+        Aabb bounds = m_nodes[node.first].bounds;
+        bounds.grow(m_nodes[node.first + 1].bounds);
+
+        // nothing changes above this point
+        if (bounds.min == node.bounds.min && bounds.max == node.bounds.max) {
+            break;
+        }
+
+        node.bounds = bounds;
+        nodeIndex = node.parent;
+    }
+}
+
+std::optional<ColliderHit> Bvh::closestHit(const ColliderStore& colliders,
+    const glm::vec3& eyePos, const glm::vec3& eyeDir) const
+{
+    if (m_nodes.empty()) {
+        return std::nullopt;
+    }
+
+    glm::vec3 invDir = 1.0f / eyeDir;
+    std::optional<ColliderHit> result = std::nullopt;
+    float closestDist = FLT_MAX;
+
+    if (!intersectRayAabb(m_nodes[0].bounds, eyePos, invDir, closestDist)) {
+        return std::nullopt;
+    }
+
+    std::array<uint32_t, STACK_SIZE> stack;
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const Node& node = m_nodes[stack[--stackSize]];
+
+        if (node.count != 0) {
+            for (size_t shape = 0; shape < COLLIDER_SHAPE_COUNT; shape++) {
+                if (node.poolCount[shape] == 0) {
+                    continue;
+                }
+
+                auto hit = colliders.closestHitInPool((ColliderShape)shape,
+                    node.poolFirst[shape], node.poolCount[shape], eyePos,
+                    eyeDir, closestDist);
+                if (hit.has_value()) {
+                    closestDist = hit->dist;
+                    result = hit;
+                }
+            }
+            continue;
+        }
+
+        // Visit the closest child first. Once something was hit, any box
+        // the ray enters further away than that can be skipped entirely
+        uint32_t near = node.first;
+        uint32_t far = node.first + 1;
+        auto tNear = intersectRayAabb(
+            m_nodes[near].bounds, eyePos, invDir, closestDist);
+        auto tFar = intersectRayAabb(
+            m_nodes[far].bounds, eyePos, invDir, closestDist);
+
+        if (tNear.has_value() && tFar.has_value() && *tFar < *tNear) {
+            std::swap(near, far);
+            std::swap(tNear, tFar);
+        }
+
+        // pushed in reverse, so the near child is popped first
+        if (tFar.has_value()) {
+            stack[stackSize++] = far;
+        }
+        if (tNear.has_value()) {
+            stack[stackSize++] = near;
+        }
+    }
+
+    return result;
+}
+
+void Bvh::closestHits(const ColliderStore& colliders,
+    const glm::vec3& eyePos, const std::vector<glm::vec3>& eyeDirs,
+    std::vector<std::optional<ColliderHit>>& hits) const
+{
+    hits.assign(eyeDirs.size(), std::nullopt);
+    if (m_nodes.empty()) {
+        return;
+    }
+
+    Packet packet;
+    packet.eyePos = eyePos;
+    for (size_t first = 0; first < eyeDirs.size(); first += MAX_PACKET_SIZE) {
+        size_t rayCount = std::min(MAX_PACKET_SIZE, eyeDirs.size() - first);
+        packet.eyeDirs = &eyeDirs[first];
+        packet.hits = &hits[first];
+        for (size_t i = 0; i < rayCount; i++) {
+            packet.invDirs[i] = 1.0f / packet.eyeDirs[i];
+            packet.closestDists[i] = FLT_MAX;
+        }
+
+        closestHitsInPacket(colliders, packet, rayCount);
+    }
+}
+
+size_t Bvh::colliderCount() const
+{
+    return m_colliderCount;
+}
+
+void Bvh::closestHitsInPacket(
+    const ColliderStore& colliders, Packet& packet, size_t rayCount) const
+{
+    RayMask allRays = rayCount == MAX_PACKET_SIZE
+        ? ~RayMask(0)
+        : (RayMask(1) << rayCount) - 1;
+    float nearestDist;
+    RayMask rootRays
+        = raysEnteringNode(m_nodes[0], packet, allRays, nearestDist);
+    if (rootRays == 0) {
+        return;
+    }
+
+    std::array<std::pair<uint32_t, RayMask>, STACK_SIZE> stack;
+    size_t stackSize = 0;
+    stack[stackSize++] = { 0, rootRays };
+
+    while (stackSize > 0) {
+        auto [nodeIndex, rays] = stack[--stackSize];
+        const Node& node = m_nodes[nodeIndex];
+
+        if (node.count != 0) {
+            for (RayMask remaining = rays; remaining != 0;
+                remaining &= remaining - 1) {
+                int ray = std::countr_zero(remaining);
+                float& closestDist = packet.closestDists[ray];
+
+                for (size_t shape = 0; shape < COLLIDER_SHAPE_COUNT; shape++) {
+                    if (node.poolCount[shape] == 0) {
+                        continue;
+                    }
+
+                    auto hit = colliders.closestHitInPool((ColliderShape)shape,
+                        node.poolFirst[shape], node.poolCount[shape],
+                        packet.eyePos, packet.eyeDirs[ray], closestDist);
+                    if (hit.has_value()) {
+                        closestDist = hit->dist;
+                        packet.hits[ray] = hit;
+                    }
+                }
+            }
+            continue;
+        }
+
+        // same near child first order as closestHit(), using the ray of
+        // the packet that gets there first
+        uint32_t near = node.first;
+        uint32_t far = node.first + 1;
+        float nearDist;
+        float farDist;
+        RayMask nearRays
+            = raysEnteringNode(m_nodes[near], packet, rays, nearDist);
+        RayMask farRays = raysEnteringNode(m_nodes[far], packet, rays, farDist);
+
+        if (nearRays != 0 && farRays != 0 && farDist < nearDist) {
+            std::swap(near, far);
+            std::swap(nearRays, farRays);
+        }
+
+        if (farRays != 0) {
+            stack[stackSize++] = { far, farRays };
+        }
+        if (nearRays != 0) {
+            stack[stackSize++] = { near, nearRays };
+        }
+    }
+}
+
+Bvh::RayMask Bvh::raysEnteringNode(const Node& node, const Packet& packet,
+    RayMask mask, float& nearestDist)
+{
+    RayMask result = 0;
+    nearestDist = FLT_MAX;
+    for (RayMask remaining = mask; remaining != 0; remaining &= remaining - 1) {
+        int ray = std::countr_zero(remaining);
+        auto dist = intersectRayAabb(node.bounds, packet.eyePos,
+            packet.invDirs[ray], packet.closestDists[ray]);
+        if (dist.has_value()) {
+            result |= RayMask(1) << ray;
+            nearestDist = std::min(nearestDist, dist.value());
+        }
+    }
+
+    return result;
+}
+
+// Binned surface area heuristic: tries a few split planes along each
+// axis and keeps the one that minimizes the expected cost of a ray
+// going through the node
+void Bvh::subdivide(
+    const std::vector<Aabb>& bounds, uint32_t nodeIndex, uint32_t depth)
+{
+    uint32_t first = m_nodes[nodeIndex].first;
+    uint32_t count = m_nodes[nodeIndex].count;
+
+    if (count <= MAX_LEAF_SIZE || depth == MAX_DEPTH) {
+        return;
+    }
+
+    Aabb centroidBounds;
+    for (uint32_t i = first; i < first + count; i++) {
+        glm::vec3 centroid = bounds[m_colliders[i]].center();
+        centroidBounds.grow({ centroid, centroid });
+    }
+
+    struct Bin {
+        Aabb bounds;
+        uint32_t count = 0;
+    };
+
+    int bestAxis = -1;
+    float bestSplit = 0.0f;
+    float bestCost = INTERSECTION_COST * count;
+    float parentArea = m_nodes[nodeIndex].bounds.surfaceArea();
+
+    for (int axis = 0; axis < 3; axis++) {
+        float minCentroid = centroidBounds.min[axis];
+        float extent = centroidBounds.max[axis] - minCentroid;
+        if (extent <= 0.0f) {
+            continue;
+        }
+
+        std::array<Bin, SAH_BIN_COUNT> bins;
+        float binScale = SAH_BIN_COUNT / extent;
+        for (uint32_t i = first; i < first + count; i++) {
+            const Aabb& colliderBounds = bounds[m_colliders[i]];
+            int bin = std::min(SAH_BIN_COUNT - 1,
+                (int)((colliderBounds.center()[axis] - minCentroid)
+                    * binScale));
+            bins[bin].count++;
+            bins[bin].bounds.grow(colliderBounds);
+        }
+
+        // sweeping from both sides to get the cost of every split
+        std::array<float, SAH_BIN_COUNT - 1> leftArea;
+        std::array<uint32_t, SAH_BIN_COUNT - 1> leftCount;
+        Aabb leftBounds;
+        uint32_t leftSum = 0;
+        for (int i = 0; i < SAH_BIN_COUNT - 1; i++) {
+            leftSum += bins[i].count;
+            leftCount[i] = leftSum;
+            leftBounds.grow(bins[i].bounds);
+            leftArea[i] = leftSum > 0 ? leftBounds.surfaceArea() : 0.0f;
+        }
+
+        Aabb rightBounds;
+        uint32_t rightSum = 0;
+        for (int i = SAH_BIN_COUNT - 1; i > 0; i--) {
+            rightSum += bins[i].count;
+            rightBounds.grow(bins[i].bounds);
+            if (leftCount[i - 1] == 0 || rightSum == 0) {
+                continue;
+            }
+
+            float cost = TRAVERSAL_COST
+                + INTERSECTION_COST
+                    * (leftArea[i - 1] * leftCount[i - 1]
+                        + rightBounds.surfaceArea() * rightSum)
+                    / std::max(parentArea, FLT_MIN);
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = minCentroid + i / binScale;
+            }
+        }
+    }
+
+    if (bestAxis == -1) {
+        return;
+    }
+
+    auto middle = std::partition(m_colliders.begin() + first,
+        m_colliders.begin() + first + count, [&](ColliderHandle collider) {
+            return bounds[collider].center()[bestAxis] < bestSplit;
+        });
+    auto leftSize = (uint32_t)(middle - m_colliders.begin()) - first;
+    if (leftSize == 0 || leftSize == count) {
+        return;
+    }
+
+    auto leftIndex = (uint32_t)m_nodes.size();
+    for (uint32_t i = 0; i < 2; i++) {
+        Node child;
+        child.first = i == 0 ? first : first + leftSize;
+        child.count = i == 0 ? leftSize : count - leftSize;
+        child.parent = nodeIndex;
+        for (uint32_t j = child.first; j < child.first + child.count; j++) {
+            child.bounds.grow(bounds[m_colliders[j]]);
+        }
+        m_nodes.push_back(child);
+    }
+
+    m_nodes[nodeIndex].first = leftIndex;
+    m_nodes[nodeIndex].count = 0;
+
+    subdivide(bounds, leftIndex, depth + 1);
+    subdivide(bounds, leftIndex + 1, depth + 1);
+}
+
+void Bvh::updateLeafBounds(const ColliderStore& colliders, Node& node)
+{
+    // empty once all its colliders are removed, rays then go through it
+    // without testing anything
+    node.bounds = Aabb();
+    for (size_t shape = 0; shape < COLLIDER_SHAPE_COUNT; shape++) {
+        uint32_t end = node.poolFirst[shape] + node.poolCount[shape];
+        for (uint32_t i = node.poolFirst[shape]; i < end; i++) {
+            node.bounds.grow(colliders.boundsInPool((ColliderShape)shape, i));
+        }
+    }
+}
\ No newline at end of file
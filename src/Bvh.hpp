@@ -0,0 +1,101 @@
+#pragma once
+
+#include "ColliderStore.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Bounding volume hierarchy over the colliders of a ColliderStore, so a
+// shot only has to test the few colliders whose boxes it goes through
+// instead of all of them.
+// Building it rearranges the pools of the store so the colliders of each
+// leaf are contiguous and can be tested in a batch. Adding or removing
+// colliders breaks that, so the tree has to be rebuilt then. Colliders
+// that move just need a refit
+class Bvh {
+public:
+    Bvh() = default;
+
+    void build(ColliderStore& colliders);
+
+    // Updates the box of a collider that moved and the boxes above it.
+    // Much cheaper than a rebuild, but the tree gets worse if colliders
+    // end up far from where they were when it was built
+    void refit(const ColliderStore& colliders, ColliderHandle collider);
+    // Takes the collider out of the tree, then refits. Has to be called
+    // right before removing it from the store: the store pops the last
+    // collider of the pool into its place, so that one is moved into the
+    // removed collider's leaf first. The tree gets worse the same way it
+    // does with refit()
+    void remove(ColliderStore& colliders, ColliderHandle collider);
+
+    // Returns the collider closest to eyePos that the ray hits
+    std::optional<ColliderHit> closestHit(const ColliderStore& colliders,
+        const glm::vec3& eyePos, const glm::vec3& eyeDir) const;
+
+    // Same as closestHit() for every ray starting at eyePos, hits[i]
+    // being for eyeDirs[i]. The rays go down the tree together, so
+    // nodes shared by several of them are only fetched and tested once
+    void closestHits(const ColliderStore& colliders, const glm::vec3& eyePos,
+        const std::vector<glm::vec3>& eyeDirs,
+        std::vector<std::optional<ColliderHit>>& hits) const;
+
+    size_t colliderCount() const;
+
+private:
+    struct Node {
+        Aabb bounds;
+        // For leaves, index of the first collider in m_colliders.
+        // Otherwise index of the left child, the right one is right after
+        uint32_t first = 0;
+        // 0 for internal nodes. For leaves, the count when the tree was
+        // built, removals only change the pool counts
+        uint32_t count = 0;
+        int32_t parent = -1;
+        // Where the colliders of a leaf are in each pool of the store.
+        // The ranges of all the leaves cover each pool exactly, in order
+        std::array<uint32_t, COLLIDER_SHAPE_COUNT> poolFirst {};
+        std::array<uint32_t, COLLIDER_SHAPE_COUNT> poolCount {};
+    };
+
+    // one bit per ray of a packet
+    using RayMask = uint64_t;
+    static constexpr size_t MAX_PACKET_SIZE = 64;
+
+    struct Packet {
+        glm::vec3 eyePos;
+        const glm::vec3* eyeDirs;
+        std::array<glm::vec3, MAX_PACKET_SIZE> invDirs;
+        // distance to the closest hit so far of each ray
+        std::array<float, MAX_PACKET_SIZE> closestDists;
+        std::optional<ColliderHit>* hits;
+    };
+
+    void closestHitsInPacket(const ColliderStore& colliders, Packet& packet,
+        size_t rayCount) const;
+    // Rays of mask that enter the box of node before their closest hit.
+    // nearestDist is set to where the first of them enters it
+    static RayMask raysEnteringNode(const Node& node, const Packet& packet,
+        RayMask mask, float& nearestDist);
+
+    void subdivide(
+        const std::vector<Aabb>& bounds, uint32_t nodeIndex, uint32_t depth);
+    void updateLeafBounds(const ColliderStore& colliders, Node& node);
+    void refitLeaf(const ColliderStore& colliders, int32_t nodeIndex);
+
+    std::vector<Node> m_nodes;
+    // colliders of the leaves when the tree was built, sorted by shape
+    // inside each leaf
+    std::vector<ColliderHandle> m_colliders;
+    size_t m_colliderCount = 0;
+    // leaf of each collider, indexed by handle
+    std::vector<int32_t> m_leafOfCollider;
+    // only used while building, kept so rebuilds don't allocate
+    std::vector<Aabb> m_bounds;
+    std::array<std::vector<uint32_t>, COLLIDER_SHAPE_COUNT> m_poolOrders;
+};
\ No newline at end of file
@@ -50,8 +50,13 @@ void Camera::processMouseMovement(float xoffset, float yoffset)
     xoffset *= m_mouseSensitivity / 100;
     yoffset *= m_mouseSensitivity / 100;
 
-    m_yaw += xoffset;
-    m_pitch += yoffset;
+    rotate(xoffset, yoffset);
+}
+
+void Camera::rotate(float yawOffset, float pitchOffset)
+{
+    m_yaw += yawOffset;
+    m_pitch += pitchOffset;
 
     // constrain pitch
     if (m_pitch > 89.0F) {
@@ -63,11 +68,31 @@ void Camera::processMouseMovement(float xoffset, float yoffset)
     updateVectors();
 }
 
+Camera Camera::interpolate(const Camera& from, const Camera& to, float t)
+{
+    Camera camera = to;
+    camera.position = glm::mix(from.position, to.position, t);
+    camera.m_yaw = glm::mix(from.m_yaw, to.m_yaw, t);
+    camera.m_pitch = glm::mix(from.m_pitch, to.m_pitch, t);
+    camera.updateVectors();
+    return camera;
+}
+
 glm::vec3 Camera::front() const
 {
     return m_front;
 }
 
+glm::vec3 Camera::right() const
+{
+    return m_right;
+}
+
+glm::vec3 Camera::up() const
+{
+    return m_up;
+}
+
 float Camera::zoom() const
 {
     return m_zoom;
@@ -18,8 +18,15 @@ public:
     glm::mat4 buildViewMatrix() const;
     void processKeyboard(CameraMovement direction, float deltaTime);
     void processMouseMovement(float xoffset, float yoffset);
+    // in degrees, pitch is still kept between -89 and 89
+    void rotate(float yawOffset, float pitchOffset);
+    // from at t = 0, to at t = 1. The angles are interpolated rather than
+    // the vectors, that's what the mouse moves linearly
+    static Camera interpolate(const Camera& from, const Camera& to, float t);
 
     glm::vec3 front() const;
+    glm::vec3 right() const;
+    glm::vec3 up() const;
     float zoom() const;
 
     void setMouseSensitivity(float sensitivity);
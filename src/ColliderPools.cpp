@@ -0,0 +1,752 @@
+#include "ColliderPools.hpp"
+
+#include "Simd.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace {
+
+// Applies order to one of the arrays of a pool, see permute()
+void permuteArray(std::vector<float>& values,
+    const std::vector<uint32_t>& order, std::vector<float>& scratch)
+{
+    scratch.resize(values.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        scratch[i] = values[order[i]];
+    }
+    // copied back rather than swapped, values keeps what was reserved
+    std::copy(scratch.begin(), scratch.end(), values.begin());
+}
+
+void swapIn(std::vector<float>& values, size_t first, size_t second)
+{
+    std::swap(values[first], values[second]);
+}
+
+// Swaps the last element into index and pops it
+void swapRemoveFrom(std::vector<float>& values, size_t index)
+{
+    values[index] = values.back();
+    values.pop_back();
+}
+
+// Same results as _mm_min_ps/_mm_max_ps, NaNs included, so the scalar
+// and SIMD box tests agree
+float minLane(float a, float b)
+{
+    return a < b ? a : b;
+}
+
+float maxLane(float a, float b)
+{
+    return a > b ? a : b;
+}
+
+}
+
+std::optional<float> intersectRaySphere(const glm::vec3& eyePos,
+    const glm::vec3& eyeDir, const glm::vec3& center, float radius)
+{
+    // https://en.wikipedia.org/wiki/Line%E2%80%93sphere_intersection
+    glm::vec3 toEye = eyePos - center;
+    float b = eyeDir.x * toEye.x + eyeDir.y * toEye.y + eyeDir.z * toEye.z;
+    float c = (toEye.x * toEye.x + toEye.y * toEye.y + toEye.z * toEye.z)
+        - radius * radius;
+    float delta = b * b - c;
+
+    if (delta < 0) {
+        return std::nullopt;
+    }
+
+    float d = -b - std::sqrt(delta);
+    if (d > 0) {
+        return d;
+    }
+
+    return std::nullopt;
+}
+
+// Slab test in the space of the box
+std::optional<float> intersectRayBox(const glm::vec3& eyePos,
+    const glm::vec3& eyeDir, const glm::vec3& center,
+    const glm::vec3& halfSize, const glm::mat3& inverseRotation)
+{
+    glm::vec3 toEye = eyePos - center;
+    glm::vec3 tNear;
+    glm::vec3 tFar;
+
+    for (int i = 0; i < 3; i++) {
+        glm::vec3 row(inverseRotation[0][i], inverseRotation[1][i],
+            inverseRotation[2][i]);
+        float localEye = row.x * toEye.x + row.y * toEye.y + row.z * toEye.z;
+        float localDir
+            = row.x * eyeDir.x + row.y * eyeDir.y + row.z * eyeDir.z;
+        float invDir = 1.0f / localDir;
+
+        float t1 = (-halfSize[i] - localEye) * invDir;
+        float t2 = (halfSize[i] - localEye) * invDir;
+        tNear[i] = minLane(t1, t2);
+        tFar[i] = maxLane(t1, t2);
+    }
+
+    float tEnter = maxLane(maxLane(tNear.x, tNear.y), tNear.z);
+    float tExit = minLane(minLane(tFar.x, tFar.y), tFar.z);
+
+    if (tEnter <= tExit && tExit >= 0) {
+        // starting inside the box, hits it on the way out
+        return tEnter >= 0 ? tEnter : tExit;
+    }
+
+    return std::nullopt;
+}
+
+size_t SpherePool::size() const
+{
+    return m_radius.size();
+}
+
+void SpherePool::pushBack(const ColliderPose& pose)
+{
+    m_centerX.push_back(0.0f);
+    m_centerY.push_back(0.0f);
+    m_centerZ.push_back(0.0f);
+    m_radius.push_back(0.0f);
+    setPose(size() - 1, pose);
+}
+
+void SpherePool::reserve(size_t count)
+{
+    m_centerX.reserve(count);
+    m_centerY.reserve(count);
+    m_centerZ.reserve(count);
+    m_radius.reserve(count);
+    m_scratch.reserve(count);
+}
+
+void SpherePool::swapRemove(size_t index)
+{
+    swapRemoveFrom(m_centerX, index);
+    swapRemoveFrom(m_centerY, index);
+    swapRemoveFrom(m_centerZ, index);
+    swapRemoveFrom(m_radius, index);
+}
+
+void SpherePool::swap(size_t first, size_t second)
+{
+    swapIn(m_centerX, first, second);
+    swapIn(m_centerY, first, second);
+    swapIn(m_centerZ, first, second);
+    swapIn(m_radius, first, second);
+}
+
+void SpherePool::permute(const std::vector<uint32_t>& order)
+{
+    permuteArray(m_centerX, order, m_scratch);
+    permuteArray(m_centerY, order, m_scratch);
+    permuteArray(m_centerZ, order, m_scratch);
+    permuteArray(m_radius, order, m_scratch);
+}
+
+void SpherePool::setPose(size_t index, const ColliderPose& pose)
+{
+    m_centerX[index] = pose.pos.x;
+    m_centerY[index] = pose.pos.y;
+    m_centerZ[index] = pose.pos.z;
+    m_radius[index] = pose.size.x / 2;
+}
+
+Aabb SpherePool::bounds(size_t index) const
+{
+    glm::vec3 extent(m_radius[index]);
+    return { center(index) - extent, center(index) + extent };
+}
+
+glm::vec3 SpherePool::center(size_t index) const
+{
+    return { m_centerX[index], m_centerY[index], m_centerZ[index] };
+}
+
+float SpherePool::radius(size_t index) const
+{
+    return m_radius[index];
+}
+
+std::optional<BatchHit> SpherePool::closestHit(size_t first, size_t count,
+    const glm::vec3& eyePos, const glm::vec3& eyeDir, float maxDist) const
+{
+    std::optional<BatchHit> result = std::nullopt;
+    float closestDist = maxDist;
+
+    size_t i = first;
+    size_t end = first + count;
+
+    // Each lane does exactly what intersectRaySphere does. Lanes that hit
+    // something closer are checked one by one afterwards, which is rare
+    // enough to not matter
+#ifdef OPENAIM_SIMD_AVX2
+    {
+        __m256 eyeX = _mm256_set1_ps(eyePos.x);
+        __m256 eyeY = _mm256_set1_ps(eyePos.y);
+        __m256 eyeZ = _mm256_set1_ps(eyePos.z);
+        __m256 dirX = _mm256_set1_ps(eyeDir.x);
+        __m256 dirY = _mm256_set1_ps(eyeDir.y);
+        __m256 dirZ = _mm256_set1_ps(eyeDir.z);
+        __m256 zero = _mm256_setzero_ps();
+
+        for (; i + 8 <= end; i += 8) {
+            __m256 toEyeX = _mm256_sub_ps(eyeX, _mm256_loadu_ps(&m_centerX[i]));
+            __m256 toEyeY = _mm256_sub_ps(eyeY, _mm256_loadu_ps(&m_centerY[i]));
+            __m256 toEyeZ = _mm256_sub_ps(eyeZ, _mm256_loadu_ps(&m_centerZ[i]));
+            __m256 radius = _mm256_loadu_ps(&m_radius[i]);
+
+            __m256 b = _mm256_add_ps(
+                _mm256_add_ps(
+                    _mm256_mul_ps(dirX, toEyeX), _mm256_mul_ps(dirY, toEyeY)),
+                _mm256_mul_ps(dirZ, toEyeZ));
+            __m256 c = _mm256_sub_ps(
+                _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(toEyeX, toEyeX),
+                                  _mm256_mul_ps(toEyeY, toEyeY)),
+                    _mm256_mul_ps(toEyeZ, toEyeZ)),
+                _mm256_mul_ps(radius, radius));
+            __m256 delta = _mm256_sub_ps(_mm256_mul_ps(b, b), c);
+            __m256 d = _mm256_sub_ps(
+                _mm256_sub_ps(zero, b), _mm256_sqrt_ps(delta));
+
+            __m256 hit = _mm256_and_ps(
+                _mm256_cmp_ps(delta, zero, _CMP_GE_OQ),
+                _mm256_and_ps(_mm256_cmp_ps(d, zero, _CMP_GT_OQ),
+                    _mm256_cmp_ps(d, _mm256_set1_ps(closestDist),
+                        _CMP_LT_OQ)));
+            auto mask = (unsigned)_mm256_movemask_ps(hit);
+            if (mask == 0) {
+                continue;
+            }
+
+            alignas(32) float dists[8];
+            _mm256_store_ps(dists, d);
+            while (mask != 0) {
+                int lane = std::countr_zero(mask);
+                mask &= mask - 1;
+                if (dists[lane] < closestDist) {
+                    closestDist = dists[lane];
+                    result = { i + lane, closestDist };
+                }
+            }
+        }
+    }
+#endif
+
+#ifdef OPENAIM_SIMD_SSE
+    {
+        __m128 eyeX = _mm_set1_ps(eyePos.x);
+        __m128 eyeY = _mm_set1_ps(eyePos.y);
+        __m128 eyeZ = _mm_set1_ps(eyePos.z);
+        __m128 dirX = _mm_set1_ps(eyeDir.x);
+        __m128 dirY = _mm_set1_ps(eyeDir.y);
+        __m128 dirZ = _mm_set1_ps(eyeDir.z);
+        __m128 zero = _mm_setzero_ps();
+
+        for (; i + 4 <= end; i += 4) {
+            __m128 toEyeX = _mm_sub_ps(eyeX, _mm_loadu_ps(&m_centerX[i]));
+            __m128 toEyeY = _mm_sub_ps(eyeY, _mm_loadu_ps(&m_centerY[i]));
+            __m128 toEyeZ = _mm_sub_ps(eyeZ, _mm_loadu_ps(&m_centerZ[i]));
+            __m128 radius = _mm_loadu_ps(&m_radius[i]);
+
+            __m128 b = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(dirX, toEyeX), _mm_mul_ps(dirY, toEyeY)),
+                _mm_mul_ps(dirZ, toEyeZ));
+            __m128 c = _mm_sub_ps(
+                _mm_add_ps(_mm_add_ps(_mm_mul_ps(toEyeX, toEyeX),
+                               _mm_mul_ps(toEyeY, toEyeY)),
+                    _mm_mul_ps(toEyeZ, toEyeZ)),
+                _mm_mul_ps(radius, radius));
+            __m128 delta = _mm_sub_ps(_mm_mul_ps(b, b), c);
+            __m128 d = _mm_sub_ps(_mm_sub_ps(zero, b), _mm_sqrt_ps(delta));
+
+            __m128 hit = _mm_and_ps(_mm_cmpge_ps(delta, zero),
+                _mm_and_ps(_mm_cmpgt_ps(d, zero),
+                    _mm_cmplt_ps(d, _mm_set1_ps(closestDist))));
+            auto mask = (unsigned)_mm_movemask_ps(hit);
+            if (mask == 0) {
+                continue;
+            }
+
+            alignas(16) float dists[4];
+            _mm_store_ps(dists, d);
+            while (mask != 0) {
+                int lane = std::countr_zero(mask);
+                mask &= mask - 1;
+                if (dists[lane] < closestDist) {
+                    closestDist = dists[lane];
+                    result = { i + lane, closestDist };
+                }
+            }
+        }
+    }
+#endif
+
+    // whatever didn't fit in a full register
+    for (; i < end; i++) {
+        auto dist
+            = intersectRaySphere(eyePos, eyeDir, center(i), m_radius[i]);
+        if (dist.has_value() && dist.value() < closestDist) {
+            closestDist = dist.value();
+            result = { i, closestDist };
+        }
+    }
+
+    return result;
+}
+
+size_t BoxPool::size() const
+{
+    return m_center[0].size();
+}
+
+void BoxPool::pushBack(const ColliderPose& pose)
+{
+    for (auto& values : m_center) {
+        values.push_back(0.0f);
+    }
+    for (auto& values : m_halfSize) {
+        values.push_back(0.0f);
+    }
+    for (auto& values : m_inverseRotation) {
+        values.push_back(0.0f);
+    }
+    setPose(size() - 1, pose);
+}
+
+void BoxPool::reserve(size_t count)
+{
+    for (auto& values : m_center) {
+        values.reserve(count);
+    }
+    for (auto& values : m_halfSize) {
+        values.reserve(count);
+    }
+    for (auto& values : m_inverseRotation) {
+        values.reserve(count);
+    }
+    m_scratch.reserve(count);
+}
+
+void BoxPool::swapRemove(size_t index)
+{
+    for (auto& values : m_center) {
+        swapRemoveFrom(values, index);
+    }
+    for (auto& values : m_halfSize) {
+        swapRemoveFrom(values, index);
+    }
+    for (auto& values : m_inverseRotation) {
+        swapRemoveFrom(values, index);
+    }
+}
+
+void BoxPool::swap(size_t first, size_t second)
+{
+    for (auto& values : m_center) {
+        swapIn(values, first, second);
+    }
+    for (auto& values : m_halfSize) {
+        swapIn(values, first, second);
+    }
+    for (auto& values : m_inverseRotation) {
+        swapIn(values, first, second);
+    }
+}
+
+void BoxPool::permute(const std::vector<uint32_t>& order)
+{
+    for (auto& values : m_center) {
+        permuteArray(values, order, m_scratch);
+    }
+    for (auto& values : m_halfSize) {
+        permuteArray(values, order, m_scratch);
+    }
+    for (auto& values : m_inverseRotation) {
+        permuteArray(values, order, m_scratch);
+    }
+}
+
+void BoxPool::setPose(size_t index, const ColliderPose& pose)
+{
+    for (int i = 0; i < 3; i++) {
+        m_center[i][index] = pose.pos[i];
+        m_halfSize[i][index] = pose.size[i] / 2;
+        for (int j = 0; j < 3; j++) {
+            // the inverse is the transpose. Row i of it is column i of
+            // the rotation, and glm matrices are indexed by column first
+            m_inverseRotation[i * 3 + j][index] = pose.rotation[i][j];
+        }
+    }
+}
+
+Aabb BoxPool::bounds(size_t index) const
+{
+    // extent of the rotated box along each world axis
+    glm::mat3 absRotation = glm::transpose(inverseRotation(index));
+    for (int i = 0; i < 3; i++) {
+        absRotation[i] = glm::abs(absRotation[i]);
+    }
+    glm::vec3 extent = absRotation * halfSize(index);
+
+    return { center(index) - extent, center(index) + extent };
+}
+
+glm::vec3 BoxPool::center(size_t index) const
+{
+    return { m_center[0][index], m_center[1][index], m_center[2][index] };
+}
+
+glm::vec3 BoxPool::halfSize(size_t index) const
+{
+    return { m_halfSize[0][index], m_halfSize[1][index],
+        m_halfSize[2][index] };
+}
+
+OrientedBox BoxPool::orientedBox(size_t index) const
+{
+    return { center(index), halfSize(index), inverseRotation(index) };
+}
+
+glm::mat3 BoxPool::inverseRotation(size_t index) const
+{
+    glm::mat3 result;
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 3; col++) {
+            result[col][row] = m_inverseRotation[row * 3 + col][index];
+        }
+    }
+
+    return result;
+}
+
+std::optional<BatchHit> BoxPool::closestHit(size_t first, size_t count,
+    const glm::vec3& eyePos, const glm::vec3& eyeDir, float maxDist) const
+{
+    std::optional<BatchHit> result = std::nullopt;
+    float closestDist = maxDist;
+
+    size_t i = first;
+    size_t end = first + count;
+
+    // Lanes follow intersectRayBox step by step, see SpherePool
+#ifdef OPENAIM_SIMD_AVX2
+    {
+        __m256 zero = _mm256_setzero_ps();
+        __m256 signBit = _mm256_set1_ps(-0.0f);
+
+        for (; i + 8 <= end; i += 8) {
+            __m256 toEye[3];
+            for (int axis = 0; axis < 3; axis++) {
+                toEye[axis] = _mm256_sub_ps(_mm256_set1_ps(eyePos[axis]),
+                    _mm256_loadu_ps(&m_center[axis][i]));
+            }
+
+            // max(-inf, x) and min(inf, x) are x, even for NaNs
+            __m256 tEnter = _mm256_set1_ps(-INFINITY);
+            __m256 tExit = _mm256_set1_ps(INFINITY);
+            for (int axis = 0; axis < 3; axis++) {
+                __m256 row0 = _mm256_loadu_ps(&m_inverseRotation[axis * 3][i]);
+                __m256 row1
+                    = _mm256_loadu_ps(&m_inverseRotation[axis * 3 + 1][i]);
+                __m256 row2
+                    = _mm256_loadu_ps(&m_inverseRotation[axis * 3 + 2][i]);
+
+                __m256 localEye = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(row0, toEye[0]),
+                        _mm256_mul_ps(row1, toEye[1])),
+                    _mm256_mul_ps(row2, toEye[2]));
+                __m256 localDir = _mm256_add_ps(
+                    _mm256_add_ps(
+                        _mm256_mul_ps(row0, _mm256_set1_ps(eyeDir.x)),
+                        _mm256_mul_ps(row1, _mm256_set1_ps(eyeDir.y))),
+                    _mm256_mul_ps(row2, _mm256_set1_ps(eyeDir.z)));
+                __m256 invDir = _mm256_div_ps(_mm256_set1_ps(1.0f), localDir);
+
+                __m256 halfSize = _mm256_loadu_ps(&m_halfSize[axis][i]);
+                __m256 t1 = _mm256_mul_ps(
+                    _mm256_sub_ps(_mm256_xor_ps(halfSize, signBit), localEye),
+                    invDir);
+                __m256 t2
+                    = _mm256_mul_ps(_mm256_sub_ps(halfSize, localEye), invDir);
+                __m256 tNear = _mm256_min_ps(t1, t2);
+                __m256 tFar = _mm256_max_ps(t1, t2);
+
+                tEnter = _mm256_max_ps(tEnter, tNear);
+                tExit = _mm256_min_ps(tExit, tFar);
+            }
+
+            __m256 dist = _mm256_blendv_ps(
+                tExit, tEnter, _mm256_cmp_ps(tEnter, zero, _CMP_GE_OQ));
+            __m256 hit = _mm256_and_ps(
+                _mm256_and_ps(_mm256_cmp_ps(tEnter, tExit, _CMP_LE_OQ),
+                    _mm256_cmp_ps(tExit, zero, _CMP_GE_OQ)),
+                _mm256_cmp_ps(
+                    dist, _mm256_set1_ps(closestDist), _CMP_LT_OQ));
+            auto mask = (unsigned)_mm256_movemask_ps(hit);
+            if (mask == 0) {
+                continue;
+            }
+
+            alignas(32) float dists[8];
+            _mm256_store_ps(dists, dist);
+            while (mask != 0) {
+                int lane = std::countr_zero(mask);
+                mask &= mask - 1;
+                if (dists[lane] < closestDist) {
+                    closestDist = dists[lane];
+                    result = { i + lane, closestDist };
+                }
+            }
+        }
+    }
+#endif
+
+#ifdef OPENAIM_SIMD_SSE
+    {
+        __m128 zero = _mm_setzero_ps();
+        __m128 signBit = _mm_set1_ps(-0.0f);
+
+        for (; i + 4 <= end; i += 4) {
+            __m128 toEye[3];
+            for (int axis = 0; axis < 3; axis++) {
+                toEye[axis] = _mm_sub_ps(_mm_set1_ps(eyePos[axis]),
+                    _mm_loadu_ps(&m_center[axis][i]));
+            }
+
+            // max(-inf, x) and min(inf, x) are x, even for NaNs
+            __m128 tEnter = _mm_set1_ps(-INFINITY);
+            __m128 tExit = _mm_set1_ps(INFINITY);
+            for (int axis = 0; axis < 3; axis++) {
+                __m128 row0 = _mm_loadu_ps(&m_inverseRotation[axis * 3][i]);
+                __m128 row1 = _mm_loadu_ps(&m_inverseRotation[axis * 3 + 1][i]);
+                __m128 row2 = _mm_loadu_ps(&m_inverseRotation[axis * 3 + 2][i]);
+
+                __m128 localEye = _mm_add_ps(
+                    _mm_add_ps(
+                        _mm_mul_ps(row0, toEye[0]), _mm_mul_ps(row1, toEye[1])),
+                    _mm_mul_ps(row2, toEye[2]));
+                __m128 localDir = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(row0, _mm_set1_ps(eyeDir.x)),
+                        _mm_mul_ps(row1, _mm_set1_ps(eyeDir.y))),
+                    _mm_mul_ps(row2, _mm_set1_ps(eyeDir.z)));
+                __m128 invDir = _mm_div_ps(_mm_set1_ps(1.0f), localDir);
+
+                __m128 halfSize = _mm_loadu_ps(&m_halfSize[axis][i]);
+                __m128 t1 = _mm_mul_ps(
+                    _mm_sub_ps(_mm_xor_ps(halfSize, signBit), localEye),
+                    invDir);
+                __m128 t2 = _mm_mul_ps(_mm_sub_ps(halfSize, localEye), invDir);
+                __m128 tNear = _mm_min_ps(t1, t2);
+                __m128 tFar = _mm_max_ps(t1, t2);
+
+                tEnter = _mm_max_ps(tEnter, tNear);
+                tExit = _mm_min_ps(tExit, tFar);
+            }
+
+            // no blendv before SSE4.1
+            __m128 entersAhead = _mm_cmpge_ps(tEnter, zero);
+            __m128 dist = _mm_or_ps(_mm_and_ps(entersAhead, tEnter),
+                _mm_andnot_ps(entersAhead, tExit));
+            __m128 hit = _mm_and_ps(_mm_and_ps(_mm_cmple_ps(tEnter, tExit),
+                                        _mm_cmpge_ps(tExit, zero)),
+                _mm_cmplt_ps(dist, _mm_set1_ps(closestDist)));
+            auto mask = (unsigned)_mm_movemask_ps(hit);
+            if (mask == 0) {
+                continue;
+            }
+
+            alignas(16) float dists[4];
+            _mm_store_ps(dists, dist);
+            while (mask != 0) {
+                int lane = std::countr_zero(mask);
+                mask &= mask - 1;
+                if (dists[lane] < closestDist) {
+                    closestDist = dists[lane];
+                    result = { i + lane, closestDist };
+                }
+            }
+        }
+    }
+#endif
+
+    for (; i < end; i++) {
+        auto dist = intersectRayBox(
+            eyePos, eyeDir, center(i), halfSize(i), inverseRotation(i));
+        if (dist.has_value() && dist.value() < closestDist) {
+            closestDist = dist.value();
+            result = { i, closestDist };
+        }
+    }
+
+    return result;
+}
+
+size_t MeshPool::size() const
+{
+    return m_meshes.size();
+}
+
+void MeshPool::pushBack(const ColliderPose& pose)
+{
+    m_meshes.push_back(nullptr);
+    for (auto* values : { &m_pos, &m_scale }) {
+        for (auto& axis : *values) {
+            axis.push_back(0.0f);
+        }
+    }
+    for (auto& values : m_inverseRotation) {
+        values.push_back(0.0f);
+    }
+    setPose(size() - 1, pose);
+}
+
+void MeshPool::reserve(size_t count)
+{
+    m_meshes.reserve(count);
+    m_meshScratch.reserve(count);
+    for (auto* values : { &m_pos, &m_scale }) {
+        for (auto& axis : *values) {
+            axis.reserve(count);
+        }
+    }
+    for (auto& values : m_inverseRotation) {
+        values.reserve(count);
+    }
+    m_scratch.reserve(count);
+}
+
+void MeshPool::swapRemove(size_t index)
+{
+    m_meshes[index] = m_meshes.back();
+    m_meshes.pop_back();
+    for (auto* values : { &m_pos, &m_scale }) {
+        for (auto& axis : *values) {
+            swapRemoveFrom(axis, index);
+        }
+    }
+    for (auto& values : m_inverseRotation) {
+        swapRemoveFrom(values, index);
+    }
+}
+
+void MeshPool::swap(size_t first, size_t second)
+{
+    std::swap(m_meshes[first], m_meshes[second]);
+    for (auto* values : { &m_pos, &m_scale }) {
+        for (auto& axis : *values) {
+            swapIn(axis, first, second);
+        }
+    }
+    for (auto& values : m_inverseRotation) {
+        swapIn(values, first, second);
+    }
+}
+
+void MeshPool::permute(const std::vector<uint32_t>& order)
+{
+    m_meshScratch.resize(m_meshes.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        m_meshScratch[i] = m_meshes[order[i]];
+    }
+    std::copy(m_meshScratch.begin(), m_meshScratch.end(), m_meshes.begin());
+
+    for (auto* values : { &m_pos, &m_scale }) {
+        for (auto& axis : *values) {
+            permuteArray(axis, order, m_scratch);
+        }
+    }
+    for (auto& values : m_inverseRotation) {
+        permuteArray(values, order, m_scratch);
+    }
+}
+
+void MeshPool::setPose(size_t index, const ColliderPose& pose)
+{
+    m_meshes[index] = pose.mesh;
+    for (int i = 0; i < 3; i++) {
+        m_pos[i][index] = pose.pos[i];
+        m_scale[i][index] = pose.size[i];
+        for (int j = 0; j < 3; j++) {
+            m_inverseRotation[i * 3 + j][index] = pose.rotation[i][j];
+        }
+    }
+}
+
+Aabb MeshPool::bounds(size_t index) const
+{
+    OrientedBox box = proxyBox(index);
+    glm::mat3 absRotation = glm::transpose(box.inverseRotation);
+    for (int i = 0; i < 3; i++) {
+        absRotation[i] = glm::abs(absRotation[i]);
+    }
+    glm::vec3 extent = absRotation * box.halfSize;
+
+    return { box.center - extent, box.center + extent };
+}
+
+OrientedBox MeshPool::proxyBox(size_t index) const
+{
+    glm::vec3 pos(m_pos[0][index], m_pos[1][index], m_pos[2][index]);
+    if (m_meshes[index] == nullptr || m_meshes[index]->triangleCount() == 0) {
+        return { pos, glm::vec3(0.0f), glm::mat3(1.0f) };
+    }
+
+    glm::vec3 scale(m_scale[0][index], m_scale[1][index], m_scale[2][index]);
+    glm::mat3 inverse = inverseRotation(index);
+    const Aabb& meshBounds = m_meshes[index]->bounds();
+
+    // the box of the mesh isn't necessarily centered on its origin
+    glm::vec3 center
+        = pos + glm::transpose(inverse) * (meshBounds.center() * scale);
+    glm::vec3 halfSize
+        = glm::abs((meshBounds.max - meshBounds.min) * scale) / 2.0f;
+
+    return { center, halfSize, inverse };
+}
+
+std::optional<BatchHit> MeshPool::closestHit(size_t first, size_t count,
+    const glm::vec3& eyePos, const glm::vec3& eyeDir, float maxDist) const
+{
+    std::optional<BatchHit> result = std::nullopt;
+    float closestDist = maxDist;
+
+    for (size_t i = first; i < first + count; i++) {
+        if (m_meshes[i] == nullptr) {
+            continue;
+        }
+
+        // inverse of the model matrix. The direction isn't normalized
+        // afterwards, so distances along it are still world distances
+        glm::vec3 pos(m_pos[0][i], m_pos[1][i], m_pos[2][i]);
+        glm::vec3 scale(m_scale[0][i], m_scale[1][i], m_scale[2][i]);
+        glm::mat3 inverse = inverseRotation(i);
+        glm::vec3 localEye = (inverse * (eyePos - pos)) / scale;
+        glm::vec3 localDir = (inverse * eyeDir) / scale;
+
+        auto dist = m_meshes[i]->closestHit(localEye, localDir, closestDist);
+        if (dist.has_value()) {
+            closestDist = dist.value();
+            result = { i, closestDist };
+        }
+    }
+
+    return result;
+}
+
+glm::mat3 MeshPool::inverseRotation(size_t index) const
+{
+    glm::mat3 result;
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 3; col++) {
+            result[col][row] = m_inverseRotation[row * 3 + col][index];
+        }
+    }
+
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "Aabb.hpp"
+#include "TriangleBvh.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Where a collider is and how big it is, in the same terms as the entity
+// owning it. Each shape takes what it needs out of it
+struct ColliderPose {
+    glm::vec3 pos = glm::vec3(0.0f);
+    glm::vec3 size = glm::vec3(1.0f);
+    glm::mat3 rotation = glm::mat3(1.0f);
+    // triangles of the model, only used by mesh colliders. Owned by the
+    // model, which outlives the collider
+    const TriangleBvh* mesh = nullptr;
+};
+
+// What the narrowphase knows about boxes, and about meshes too since
+// they only get a box around them there
+struct OrientedBox {
+    glm::vec3 center;
+    glm::vec3 halfSize;
+    glm::mat3 inverseRotation;
+};
+
+struct BatchHit {
+    size_t index;
+    float dist;
+};
+
+// Distance along the ray to the closest intersection with the sphere in
+// front of eyePos. eyeDir has to be normalized. This is also what the
+// SIMD kernels compute for each lane, in the same order, so they agree
+// with it
+std::optional<float> intersectRaySphere(const glm::vec3& eyePos,
+    const glm::vec3& eyeDir, const glm::vec3& center, float radius);
+
+// Same as above, for a box centered at center that is rotated by the
+// inverse of inverseRotation. A box may have a size of 0 along an axis
+std::optional<float> intersectRayBox(const glm::vec3& eyePos,
+    const glm::vec3& eyeDir, const glm::vec3& center,
+    const glm::vec3& halfSize, const glm::mat3& inverseRotation);
+
+// The pools hold every collider of one shape as a structure of arrays,
+// so a ray can be tested against 4 (SSE) or 8 (AVX2) of them per
+// iteration. They all have the same interface, ColliderStore relies on
+// it to handle them generically
+
+// Diameter is size.x, the rotation doesn't matter
+class SpherePool {
+public:
+    SpherePool() = default;
+
+    size_t size() const;
+    void pushBack(const ColliderPose& pose);
+    void reserve(size_t count);
+    // Moves the last collider to index
+    void swapRemove(size_t index);
+    void swap(size_t first, size_t second);
+    // Collider i ends up where collider order[i] was
+    void permute(const std::vector<uint32_t>& order);
+
+    void setPose(size_t index, const ColliderPose& pose);
+    Aabb bounds(size_t index) const;
+
+    glm::vec3 center(size_t index) const;
+    float radius(size_t index) const;
+
+    // Closest sphere in [first, first + count) hit by the ray before
+    // maxDist
+    std::optional<BatchHit> closestHit(size_t first, size_t count,
+        const glm::vec3& eyePos, const glm::vec3& eyeDir,
+        float maxDist) const;
+
+private:
+    std::vector<float> m_centerX;
+    std::vector<float> m_centerY;
+    std::vector<float> m_centerZ;
+    std::vector<float> m_radius;
+    // kept so permute() doesn't allocate
+    std::vector<float> m_scratch;
+};
+
+// Oriented boxes
+class BoxPool {
+public:
+    BoxPool() = default;
+
+    size_t size() const;
+    void pushBack(const ColliderPose& pose);
+    void reserve(size_t count);
+    void swapRemove(size_t index);
+    void swap(size_t first, size_t second);
+    void permute(const std::vector<uint32_t>& order);
+
+    void setPose(size_t index, const ColliderPose& pose);
+    Aabb bounds(size_t index) const;
+
+    glm::vec3 center(size_t index) const;
+    glm::vec3 halfSize(size_t index) const;
+    glm::mat3 inverseRotation(size_t index) const;
+    OrientedBox orientedBox(size_t index) const;
+
+    std::optional<BatchHit> closestHit(size_t first, size_t count,
+        const glm::vec3& eyePos, const glm::vec3& eyeDir,
+        float maxDist) const;
+
+private:
+    std::array<std::vector<float>, 3> m_center;
+    std::array<std::vector<float>, 3> m_halfSize;
+    // Row major, so row i dotted with a vector is coordinate i of the
+    // vector in box space. Rotations are orthogonal, so this is computed
+    // once per pose as a transpose
+    std::array<std::vector<float>, 9> m_inverseRotation;
+    std::vector<float> m_scratch;
+};
+
+// Triangle meshes, hit tested against the actual triangles of their
+// model. Rays are brought into the space of the model instead of moving
+// the triangles around, so entities can share the same TriangleBvh
+class MeshPool {
+public:
+    MeshPool() = default;
+
+    size_t size() const;
+    void pushBack(const ColliderPose& pose);
+    void reserve(size_t count);
+    void swapRemove(size_t index);
+    void swap(size_t first, size_t second);
+    void permute(const std::vector<uint32_t>& order);
+
+    void setPose(size_t index, const ColliderPose& pose);
+    Aabb bounds(size_t index) const;
+
+    // box around the mesh, rotated and scaled with it
+    OrientedBox proxyBox(size_t index) const;
+
+    std::optional<BatchHit> closestHit(size_t first, size_t count,
+        const glm::vec3& eyePos, const glm::vec3& eyeDir,
+        float maxDist) const;
+
+private:
+    glm::mat3 inverseRotation(size_t index) const;
+
+    std::vector<const TriangleBvh*> m_meshes;
+    std::array<std::vector<float>, 3> m_pos;
+    std::array<std::vector<float>, 3> m_scale;
+    // row major, see BoxPool
+    std::array<std::vector<float>, 9> m_inverseRotation;
+    std::vector<const TriangleBvh*> m_meshScratch;
+    std::vector<float> m_scratch;
+};
\ No newline at end of file
@@ -0,0 +1,361 @@
+#include "ColliderStore.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+
+// Closest point of the box to the center of the sphere, in box space
+CollisionResult collideSphereBox(
+    const glm::vec3& sphereCenter, float radius, const OrientedBox& box)
+{
+    const glm::mat3& inverseRotation = box.inverseRotation;
+    const glm::vec3& halfSize = box.halfSize;
+    glm::vec3 center = inverseRotation * (sphereCenter - box.center);
+
+    glm::vec3 closest = glm::clamp(center, -halfSize, halfSize);
+    glm::vec3 offset = center - closest;
+    float dist = glm::length(offset);
+
+    float penetration;
+    // from the sphere to the box
+    glm::vec3 normal(0.0f);
+    if (dist > 0) {
+        penetration = radius - dist;
+        normal = -offset / dist;
+    } else {
+        // the center is inside the box, the sphere gets out through the
+        // closest face
+        glm::vec3 faceDist = halfSize - glm::abs(center);
+        int axis = 0;
+        if (faceDist.y < faceDist[axis]) {
+            axis = 1;
+        }
+        if (faceDist.z < faceDist[axis]) {
+            axis = 2;
+        }
+        penetration = radius + faceDist[axis];
+        normal[axis] = center[axis] < 0 ? 1.0f : -1.0f;
+    }
+
+    if (penetration <= 0) {
+        return std::nullopt;
+    }
+
+    // back to world space
+    return CollisionData { penetration,
+        glm::transpose(inverseRotation) * normal };
+}
+
+// Separating axis test. Two boxes don't touch if and only if their
+// projections are apart on one of their 3 + 3 face normals or on one of
+// the 9 cross products of their edges
+CollisionResult collideBoxBox(
+    const OrientedBox& first, const OrientedBox& second)
+{
+    // columns are the axes of each box in world space
+    glm::mat3 firstAxes = glm::transpose(first.inverseRotation);
+    glm::mat3 secondAxes = glm::transpose(second.inverseRotation);
+    glm::vec3 firstHalfSize = first.halfSize;
+    glm::vec3 secondHalfSize = second.halfSize;
+    glm::vec3 centerDelta = second.center - first.center;
+
+    std::array<glm::vec3, 15> axes;
+    size_t axisCount = 0;
+    for (int i = 0; i < 3; i++) {
+        axes[axisCount++] = firstAxes[i];
+        axes[axisCount++] = secondAxes[i];
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            axes[axisCount++] = glm::cross(firstAxes[i], secondAxes[j]);
+        }
+    }
+
+    CollisionData result { FLT_MAX, glm::vec3(0.0f) };
+    for (glm::vec3 axis : axes) {
+        // parallel edges, already covered by the face normals
+        float length = glm::length(axis);
+        if (length < 1e-6f) {
+            continue;
+        }
+        axis /= length;
+
+        float firstRadius = 0.0f;
+        float secondRadius = 0.0f;
+        for (int i = 0; i < 3; i++) {
+            firstRadius
+                += std::abs(glm::dot(axis, firstAxes[i])) * firstHalfSize[i];
+            secondRadius
+                += std::abs(glm::dot(axis, secondAxes[i])) * secondHalfSize[i];
+        }
+
+        float dist = glm::dot(axis, centerDelta);
+        float overlap = firstRadius + secondRadius - std::abs(dist);
+        if (overlap <= 0) {
+            return std::nullopt;
+        }
+
+        if (overlap < result.penetration) {
+            result.penetration = overlap;
+            result.normal = dist < 0 ? -axis : axis;
+        }
+    }
+
+    return result;
+}
+
+}
+
+template <typename Fn>
+decltype(auto) ColliderStore::visitPool(ColliderShape shape, Fn fn)
+{
+    switch (shape) {
+    case ColliderShape::Sphere:
+        return fn(m_spheres);
+    case ColliderShape::Box:
+        return fn(m_boxes);
+    default:
+        return fn(m_meshes);
+    }
+}
+
+template <typename Fn>
+decltype(auto) ColliderStore::visitPool(ColliderShape shape, Fn fn) const
+{
+    switch (shape) {
+    case ColliderShape::Sphere:
+        return fn(m_spheres);
+    case ColliderShape::Box:
+        return fn(m_boxes);
+    default:
+        return fn(m_meshes);
+    }
+}
+
+ColliderHandle ColliderStore::add(
+    ColliderShape shape, const ColliderPose& pose, uint32_t owner)
+{
+    ColliderHandle collider;
+    if (!m_freeSlots.empty()) {
+        collider = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    } else {
+        collider = m_slots.size();
+        m_slots.emplace_back();
+    }
+
+    auto poolIndex = (uint32_t)visitPool(shape, [&](auto& pool) {
+        pool.pushBack(pose);
+        return pool.size() - 1;
+    });
+    m_poolHandles[(size_t)shape].push_back(collider);
+    m_slots[collider] = { shape, poolIndex, owner };
+
+    return collider;
+}
+
+void ColliderStore::reserve(size_t count)
+{
+    m_slots.reserve(count);
+    m_freeSlots.reserve(count);
+    for (size_t shape = 0; shape < COLLIDER_SHAPE_COUNT; shape++) {
+        visitPool(
+            (ColliderShape)shape, [&](auto& pool) { pool.reserve(count); });
+        m_poolHandles[shape].reserve(count);
+    }
+    m_reorderScratch.reserve(count);
+}
+
+void ColliderStore::remove(ColliderHandle collider)
+{
+    Slot slot = m_slots[collider];
+    visitPool(slot.shape, [&](auto& pool) { pool.swapRemove(slot.poolIndex); });
+
+    // the last collider of the pool took its place
+    auto& handles = m_poolHandles[(size_t)slot.shape];
+    handles[slot.poolIndex] = handles.back();
+    handles.pop_back();
+    if (slot.poolIndex < handles.size()) {
+        m_slots[handles[slot.poolIndex]].poolIndex = slot.poolIndex;
+    }
+
+    m_freeSlots.push_back(collider);
+}
+
+void ColliderStore::setPose(ColliderHandle collider, const ColliderPose& pose)
+{
+    const Slot& slot = m_slots[collider];
+    visitPool(
+        slot.shape, [&](auto& pool) { pool.setPose(slot.poolIndex, pose); });
+}
+
+ColliderShape ColliderStore::shape(ColliderHandle collider) const
+{
+    return m_slots[collider].shape;
+}
+
+Aabb ColliderStore::bounds(ColliderHandle collider) const
+{
+    const Slot& slot = m_slots[collider];
+    return visitPool(slot.shape,
+        [&](const auto& pool) { return pool.bounds(slot.poolIndex); });
+}
+
+uint32_t ColliderStore::owner(ColliderHandle collider) const
+{
+    return m_slots[collider].owner;
+}
+
+void ColliderStore::setOwner(ColliderHandle collider, uint32_t owner)
+{
+    m_slots[collider].owner = owner;
+}
+
+size_t ColliderStore::size() const
+{
+    return m_slots.size() - m_freeSlots.size();
+}
+
+void ColliderStore::handles(std::vector<ColliderHandle>& result) const
+{
+    result.clear();
+    for (const auto& handles : m_poolHandles) {
+        result.insert(result.end(), handles.begin(), handles.end());
+    }
+}
+
+size_t ColliderStore::handleLimit() const
+{
+    return m_slots.size();
+}
+
+size_t ColliderStore::poolIndex(ColliderHandle collider) const
+{
+    return m_slots[collider].poolIndex;
+}
+
+size_t ColliderStore::poolSize(ColliderShape shape) const
+{
+    return m_poolHandles[(size_t)shape].size();
+}
+
+ColliderHandle ColliderStore::handleInPool(
+    ColliderShape shape, size_t index) const
+{
+    return m_poolHandles[(size_t)shape][index];
+}
+
+Aabb ColliderStore::boundsInPool(ColliderShape shape, size_t index) const
+{
+    return visitPool(
+        shape, [&](const auto& pool) { return pool.bounds(index); });
+}
+
+void ColliderStore::swapInPool(ColliderShape shape, size_t first, size_t second)
+{
+    visitPool(shape, [&](auto& pool) { pool.swap(first, second); });
+
+    auto& handles = m_poolHandles[(size_t)shape];
+    std::swap(handles[first], handles[second]);
+    m_slots[handles[first]].poolIndex = first;
+    m_slots[handles[second]].poolIndex = second;
+}
+
+void ColliderStore::reorderPool(
+    ColliderShape shape, const std::vector<uint32_t>& order)
+{
+    visitPool(shape, [&](auto& pool) { pool.permute(order); });
+
+    auto& handles = m_poolHandles[(size_t)shape];
+    m_reorderScratch.resize(handles.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        m_reorderScratch[i] = handles[order[i]];
+        m_slots[m_reorderScratch[i]].poolIndex = i;
+    }
+    std::copy(m_reorderScratch.begin(), m_reorderScratch.end(),
+        handles.begin());
+}
+
+std::optional<ColliderHit> ColliderStore::closestHitInPool(ColliderShape shape,
+    size_t first, size_t count, const glm::vec3& eyePos,
+    const glm::vec3& eyeDir, float maxDist) const
+{
+    auto hit = visitPool(shape, [&](const auto& pool) {
+        return pool.closestHit(first, count, eyePos, eyeDir, maxDist);
+    });
+    if (!hit.has_value()) {
+        return std::nullopt;
+    }
+
+    return ColliderHit { m_poolHandles[(size_t)shape][hit->index], hit->dist };
+}
+
+CollisionResult ColliderStore::collide(
+    ColliderHandle first, ColliderHandle second) const
+{
+    const Slot& firstSlot = m_slots[first];
+    const Slot& secondSlot = m_slots[second];
+    PairKernel kernel
+        = PAIR_KERNELS[(size_t)firstSlot.shape][(size_t)secondSlot.shape];
+
+    return kernel(*this, firstSlot.poolIndex, secondSlot.poolIndex);
+}
+
+CollisionResult ColliderStore::sphereSphere(
+    const ColliderStore& store, size_t first, size_t second)
+{
+    const SpherePool& spheres = store.m_spheres;
+    glm::vec3 centerDelta = spheres.center(second) - spheres.center(first);
+    float distanceCenters = glm::length(centerDelta);
+
+    float penetration
+        = spheres.radius(first) + spheres.radius(second) - distanceCenters;
+    if (penetration <= 0) {
+        return std::nullopt;
+    }
+
+    // any direction works for spheres with the same center
+    glm::vec3 normal = distanceCenters > 0 ? centerDelta / distanceCenters
+                                           : glm::vec3(0.0f, 1.0f, 0.0f);
+    return CollisionData { penetration, normal };
+}
+
+CollisionResult ColliderStore::sphereBox(
+    const ColliderStore& store, size_t first, size_t second)
+{
+    const SpherePool& spheres = store.m_spheres;
+    return collideSphereBox(spheres.center(first), spheres.radius(first),
+        store.m_boxes.orientedBox(second));
+}
+
+// Meshes only get their box here, the triangles are for shots
+CollisionResult ColliderStore::sphereMesh(
+    const ColliderStore& store, size_t first, size_t second)
+{
+    const SpherePool& spheres = store.m_spheres;
+    return collideSphereBox(spheres.center(first), spheres.radius(first),
+        store.m_meshes.proxyBox(second));
+}
+
+CollisionResult ColliderStore::boxBox(
+    const ColliderStore& store, size_t first, size_t second)
+{
+    return collideBoxBox(
+        store.m_boxes.orientedBox(first), store.m_boxes.orientedBox(second));
+}
+
+CollisionResult ColliderStore::boxMesh(
+    const ColliderStore& store, size_t first, size_t second)
+{
+    return collideBoxBox(
+        store.m_boxes.orientedBox(first), store.m_meshes.proxyBox(second));
+}
+
+CollisionResult ColliderStore::meshMesh(
+    const ColliderStore& store, size_t first, size_t second)
+{
+    return collideBoxBox(
+        store.m_meshes.proxyBox(first), store.m_meshes.proxyBox(second));
+}
\ No newline at end of file
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "ColliderPools.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+enum class ColliderShape : uint8_t {
+    Sphere,
+    Box,
+    // triangles of a model for raycasts, its box for everything else
+    Mesh,
+};
+
+constexpr size_t COLLIDER_SHAPE_COUNT = 3;
+
+// Stays valid until the collider is removed, even when the pools get
+// rearranged
+using ColliderHandle = uint32_t;
+constexpr ColliderHandle INVALID_COLLIDER = UINT32_MAX;
+
+struct CollisionData {
+    float penetration;
+    // normalized, points from the first collider to the second
+    glm::vec3 normal;
+};
+
+using CollisionResult = std::optional<CollisionData>;
+
+struct Contact {
+    ColliderHandle first;
+    ColliderHandle second;
+    CollisionData data;
+};
+
+struct ColliderHit {
+    ColliderHandle collider;
+    float dist;
+};
+
+// Every collider in the game, kept in one contiguous pool per shape.
+// Nothing here is virtual: the shape of a collider picks the pool, and
+// the shapes of a pair pick the narrowphase kernel out of PAIR_KERNELS.
+// A new shape needs a pool with the same interface as the others, a
+// case in visitPool() and a row and column of pair kernels
+class ColliderStore {
+public:
+    ColliderStore() = default;
+
+    // owner is whatever the collider belongs to, the store doesn't use it
+    ColliderHandle add(
+        ColliderShape shape, const ColliderPose& pose, uint32_t owner);
+    void remove(ColliderHandle collider);
+    // Makes room for count colliders of each shape
+    void reserve(size_t count);
+
+    void setPose(ColliderHandle collider, const ColliderPose& pose);
+    ColliderShape shape(ColliderHandle collider) const;
+    Aabb bounds(ColliderHandle collider) const;
+
+    uint32_t owner(ColliderHandle collider) const;
+    void setOwner(ColliderHandle collider, uint32_t owner);
+
+    size_t size() const;
+    // Replaces the content of result with the handles of every collider,
+    // ordered by shape then pool index
+    void handles(std::vector<ColliderHandle>& result) const;
+    // Upper bound of the handles, for lookup tables indexed by handle
+    size_t handleLimit() const;
+
+    size_t poolIndex(ColliderHandle collider) const;
+    size_t poolSize(ColliderShape shape) const;
+    ColliderHandle handleInPool(ColliderShape shape, size_t index) const;
+    Aabb boundsInPool(ColliderShape shape, size_t index) const;
+    // Swaps two colliders of the pool of shape. Handles stay valid
+    void swapInPool(ColliderShape shape, size_t first, size_t second);
+    // Moves the collider at order[i] in the pool of shape to index i, so
+    // colliders that are tested together can be stored together.
+    // Handles stay valid
+    void reorderPool(ColliderShape shape, const std::vector<uint32_t>& order);
+
+    // Closest collider hit by the ray before maxDist among
+    // [first, first + count) of the pool of shape
+    std::optional<ColliderHit> closestHitInPool(ColliderShape shape,
+        size_t first, size_t count, const glm::vec3& eyePos,
+        const glm::vec3& eyeDir, float maxDist) const;
+
+    CollisionResult collide(ColliderHandle first, ColliderHandle second) const;
+
+private:
+    struct Slot {
+        ColliderShape shape;
+        uint32_t poolIndex;
+        uint32_t owner;
+    };
+
+    // Pair kernels take pool indices. The first one is always of the
+    // shape of the row, the second of the column
+    using PairKernel = CollisionResult (*)(
+        const ColliderStore& store, size_t first, size_t second);
+
+    static CollisionResult sphereSphere(
+        const ColliderStore& store, size_t first, size_t second);
+    static CollisionResult sphereBox(
+        const ColliderStore& store, size_t first, size_t second);
+    static CollisionResult sphereMesh(
+        const ColliderStore& store, size_t first, size_t second);
+    static CollisionResult boxBox(
+        const ColliderStore& store, size_t first, size_t second);
+    static CollisionResult boxMesh(
+        const ColliderStore& store, size_t first, size_t second);
+    static CollisionResult meshMesh(
+        const ColliderStore& store, size_t first, size_t second);
+    // Same as kernel with the arguments the other way around
+    template <PairKernel kernel>
+    static CollisionResult flipped(
+        const ColliderStore& store, size_t first, size_t second)
+    {
+        CollisionResult result = kernel(store, second, first);
+        if (result.has_value()) {
+            result->normal = -result->normal;
+        }
+
+        return result;
+    }
+
+    static constexpr std::array<std::array<PairKernel, COLLIDER_SHAPE_COUNT>,
+        COLLIDER_SHAPE_COUNT>
+        PAIR_KERNELS = { {
+            // sphere against...
+            { { &sphereSphere, &sphereBox, &sphereMesh } },
+            // box against...
+            { { &flipped<&sphereBox>, &boxBox, &boxMesh } },
+            // mesh against...
+            { { &flipped<&sphereMesh>, &flipped<&boxMesh>, &meshMesh } },
+        } };
+
+    template <typename Fn> decltype(auto) visitPool(ColliderShape shape, Fn fn);
+    template <typename Fn>
+    decltype(auto) visitPool(ColliderShape shape, Fn fn) const;
+
+    std::vector<Slot> m_slots;
+    std::vector<ColliderHandle> m_freeSlots;
+    // handle of each collider of each pool
+    std::array<std::vector<ColliderHandle>, COLLIDER_SHAPE_COUNT>
+        m_poolHandles;
+    // kept so reorderPool() doesn't allocate
+    std::vector<ColliderHandle> m_reorderScratch;
+
+    SpherePool m_spheres;
+    BoxPool m_boxes;
+    MeshPool m_meshes;
+};
\ No newline at end of file
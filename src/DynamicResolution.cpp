@@ -0,0 +1,47 @@
+#include "DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// The rest of the budget is left for the UI, the present pass and
+// everything else that happens in the frame
+constexpr float SCENE_BUDGET_FRACTION = 0.8f;
+// Dropping resolution fast avoids missing frames, raising it
+// slowly avoids oscillating around the budget
+constexpr float DECREASE_RATE = 0.5f;
+constexpr float INCREASE_RATE = 0.05f;
+
+void DynamicResolution::setFrameBudget(float frameBudgetMs)
+{
+    m_frameBudgetMs = std::max(frameBudgetMs, 0.0f);
+    if (!enabled()) {
+        m_scale = MAX_SCALE;
+    }
+}
+
+bool DynamicResolution::enabled() const
+{
+    return m_frameBudgetMs > 0.0f;
+}
+
+float DynamicResolution::scale() const
+{
+    return m_scale;
+}
+
+void DynamicResolution::update(float sceneGpuMs)
+{
+    if (!enabled()) {
+        return;
+    }
+
+    // the cost of the pass is roughly proportional to the pixel
+    // count, which grows with the square of the scale
+    float targetMs = m_frameBudgetMs * SCENE_BUDGET_FRACTION;
+    float idealScale
+        = m_scale * std::sqrt(targetMs / std::max(sceneGpuMs, 0.01f));
+    idealScale = std::clamp(idealScale, MIN_SCALE, MAX_SCALE);
+
+    float rate = idealScale < m_scale ? DECREASE_RATE : INCREASE_RATE;
+    m_scale += (idealScale - m_scale) * rate;
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+// Picks the resolution scale of the 3D scene so that its GPU time
+// stays within a frame time budget, instead of dropping frames when
+// there is a lot going on
+class DynamicResolution {
+public:
+    static constexpr float MIN_SCALE = 0.5f;
+    static constexpr float MAX_SCALE = 1.0f;
+
+    // 0 disables it
+    void setFrameBudget(float frameBudgetMs);
+    bool enabled() const;
+
+    // Fraction of the full resolution, applied to both axes
+    float scale() const;
+
+    // sceneGpuMs is how long the scene pass took on the GPU
+    void update(float sceneGpuMs);
+
+private:
+    float m_frameBudgetMs = 0.0f;
+    float m_scale = MAX_SCALE;
+};
\ No newline at end of file
@@ -1,107 +1,26 @@
 #pragma once
 
+#include "Aabb.hpp"
+#include "ColliderStore.hpp"
 #include "Material.hpp"
 #include "Model.hpp"
+#include "Movement.hpp"
+#include "Physics.hpp"
 #include "Shader.hpp"
 
 #include <glm/glm.hpp>
 
 #include <functional>
-#include <memory>
 #include <optional>
-
-struct Intersection {
-    Intersection(const glm::vec3& coord, float dist)
-        : coord(coord)
-        , dist(dist)
-    {
-    }
-
-    glm::vec3 coord;
-    float dist;
-};
-
-using IntersectionResult = std::optional<Intersection>;
+#include <string>
 
 // Each coordinate represents the rotation along
 // the main axis
 using Rotation = glm::vec3;
 
-class CollisionObject {
-public:
-    enum class Type {
-        AABB,
-        SPHERE,
-    };
-
-    CollisionObject(const glm::vec3& pos);
-    virtual ~CollisionObject() = default;
-
-    virtual void move(const glm::vec3& newPos) = 0;
-
-    /*
-     * Returns the closest intersection between this collision object
-     * and the line described by eyePos and eyeDir
-     */
-    virtual IntersectionResult isIntersectedByLine(
-        glm::vec3 eyePos, glm::vec3 eyeDir) const
-        = 0;
-
-    void setRotation(const Rotation& rotation);
-
-    virtual void setSize(const glm::vec3& size) = 0;
-
-    Type type() const;
-    const glm::vec3& pos() const;
-
-protected:
-    Type m_type;
-    glm::vec3 m_pos;
-
-    // As the name suggests, AABBs are axis aligned. Because the collision
-    // object is invisible anyways, we aren't actually going to rotate it.
-    // Instead, we rotate the eyePos and eyeDir when calculating the
-    // intersection.
-    std::optional<Rotation> m_rotation;
-};
-
-class CollisionBox : public CollisionObject {
-public:
-    CollisionBox(const glm::vec3& pos, const glm::vec3& size);
-
-    void move(const glm::vec3& newPos) override;
-
-    IntersectionResult isIntersectedByLine(
-        glm::vec3 eyePos, glm::vec3 eyeDir) const override;
-
-    void setSize(const glm::vec3& size) override;
-
-private:
-    bool isPointInPlaneSection(const glm::vec3& point) const;
-
-    // TODO: we probably don't need aabb and size
-    // remove one of them in the future
-    std::array<glm::vec3, 2> m_aabb;
-    glm::vec3 m_size;
-};
-
-class CollisionSphere : public CollisionObject {
-public:
-    CollisionSphere(const glm::vec3& pos, float radius);
-
-    void move(const glm::vec3& newPos) override;
-
-    IntersectionResult isIntersectedByLine(
-        glm::vec3 eyePos, glm::vec3 eyeDir) const override;
-
-    void setSize(const glm::vec3& size) override;
-
-    float radius() const;
-
-private:
-    float m_radius;
-};
-
+// Everything needed to create an entity. The EntityManager splits it into
+// the components of its EntityStore when it's added, nothing keeps the
+// Entity itself around
 class Entity {
 public:
     enum class Type {
@@ -109,86 +28,46 @@ public:
         GONER, // when dead, die for good
     };
 
-    Entity(Model model, const Material& material, const Shader& shader,
+    // The model, material and shader are referenced, not copied, so they
+    // have to outlive the entity (they come from the ResourceManager)
+    Entity(const Model& model, const Material& material, const Shader& shader,
         const glm::vec3& pos);
-    virtual ~Entity() = default;
-
-    Entity(const Entity& entity) = delete;
-    Entity& operator=(const Entity& entity) = delete;
-
-    Entity(Entity&& entity) = default;
-    Entity& operator=(Entity&& entity) = default;
-
-    glm::mat4 modelMatrix() const;
-    glm::mat3 normalMatrix() const;
-    glm::mat4 buildHealthbarModelMatrix() const;
-
-    float getHealthPercentage() const;
-    glm::vec3 getHealthBarColor() const;
 
     void setRotation(float x, float y, float z);
-    void move(const glm::vec3& newPos);
-    // Moves relative to the referential
-    // Position after this should be referentialPos + newPos
-    void moveRelative(const glm::vec3& newPos);
 
-    void addCollisionObject(CollisionObject::Type type);
-    const CollisionObject* collisionObject() const;
-
-    bool isDestroyable() const;
-    void setDestroyable(bool destroyable);
+    // The collider itself lives in the ColliderStore of the
+    // EntityManager, which creates it when the entity is added
+    void setColliderShape(ColliderShape shape);
+    std::optional<ColliderShape> colliderShape() const;
 
     void setSize(const glm::vec3& size);
 
-    const std::string& getName() const;
+    // Where MOVER entities can respawn. Unset means the default volume
+    // of the EntityManager
+    void setSpawnVolume(const Aabb& volume);
+
     void setName(const std::string& name);
 
     void setStartingHealth(int health);
-    void setDamagedThisFrame();
-
-    void setMovementPattern(std::function<glm::vec3(float)> callback);
 
-    // returns whether entity should die
-    bool update(float timePassedSeconds);
+    // Moves around the position given to the constructor, which becomes
+    // the referential of the movement
+    void setMovement(const Movement& movement);
+    // Thrown from the position given to the constructor instead, and
+    // bounces around the arena. Replaces the movement
+    void setPhysics(const PhysicsBody& body);
 
-    bool shouldRenderHealthBar() const;
-
-    void render() const;
-    void renderHealthBar() const;
-
-    // This holds a reference position used for entity movement.
-    // For example, the point where the entity is circling or
-    // oscilating around
-    glm::vec3 referentialPos;
     bool destroyable = false;
     Type type = Type::GONER;
 
-    std::reference_wrapper<const Material> material;
-    std::reference_wrapper<const Shader> shader;
-
-    std::reference_wrapper<Material> healthbarMaterial;
-    std::reference_wrapper<const Shader> healthbarShader;
-
 private:
-    // both are meant to be called after a move, resize or rotation
-    void updateMatrices();
+    friend class EntityStore;
 
-    glm::mat4 m_modelMatrix;
-    glm::mat3 m_normalMatrix;
-    glm::mat4 m_healthbarModelMatrix;
-
-    std::unique_ptr<CollisionObject> m_collisionObject = nullptr;
-
-    // This function is used to determine the new position of this entity
-    // given the current time of the application
-    // If null, we are going to assume this entity isn't moving
-    std::function<glm::vec3(float)> m_calculateNewPos = nullptr;
-
-    std::string m_name;
-    int m_startingHealth = 1;
-    int m_currentHealth = 1;
-    bool m_damagedThisFrame = false;
+    std::reference_wrapper<const Model> m_model;
+    std::reference_wrapper<const Material> m_material;
+    std::reference_wrapper<const Shader> m_shader;
 
+    glm::vec3 m_pos;
     /*
      * This is basically the scale of the entity
      * The default sizes of the models are:
@@ -199,10 +78,11 @@ private:
     glm::vec3 m_size = glm::vec3(1.0f);
     std::optional<Rotation> m_rotation;
 
-    // This holds the actual position the entity is in
-    glm::vec3 m_currentPos;
+    std::optional<ColliderShape> m_colliderShape;
+    std::optional<Aabb> m_spawnVolume;
+    std::optional<Movement> m_movement;
+    std::optional<PhysicsBody> m_physics;
 
-    Model m_model;
-
-    Model m_healthbarQuad;
-};
+    std::string m_name;
+    int m_startingHealth = 1;
+};
\ No newline at end of file
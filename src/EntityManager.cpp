@@ -3,124 +3,550 @@
 #include "Entity.hpp"
 #include "Globals.hpp"
 
-void EntityManager::addEntity(Entity entity)
+#include <algorithm>
+
+namespace {
+
+// what respawns used before scenarios had their own spawn volume
+const Aabb DEFAULT_SPAWN_VOLUME
+    = { glm::vec3(-8.0f, 2.0f, -8.0f), glm::vec3(8.0f, 18.0f, -8.0f) };
+// dense scenarios might not have a free spot at all
+constexpr int MAX_RESPAWN_ATTEMPTS = 32;
+// cells this many times bigger than the average target, so most targets
+// are in a single cell
+constexpr float SPAWN_GRID_CELL_SCALE = 2.0f;
+// a pair costs a lot more than a pose, box pairs especially
+constexpr size_t PAIRS_PER_JOB = 32;
+constexpr size_t POSES_PER_JOB = 128;
+
+}
+
+EntityHandle EntityManager::addEntity(
+    const Entity& entity, EntityHandle parent)
 {
-    m_entities.push_back(std::move(entity));
+    EntityIndex index = m_entities.add(entity, m_entities.find(parent));
+    if (!entity.colliderShape().has_value()) {
+        return m_entities.handle(index);
+    }
+
+    ColliderHandle collider = m_colliders.add(
+        entity.colliderShape().value(), m_entities.colliderPose(index), index);
+    m_entities.colliders()[index].handle = collider;
+    m_spawnGrid.insert(collider, m_colliders.bounds(collider));
+    m_broadphase.add(collider, m_entities.moves(index));
+    m_bvhOutdated = true;
+
+    return m_entities.handle(index);
+}
+
+void EntityManager::removeEntity(EntityHandle entity)
+{
+    std::optional<EntityIndex> index = m_entities.find(entity);
+    if (index.has_value()) {
+        removeEntityAt(index.value());
+    }
+}
+
+bool EntityManager::isAlive(EntityHandle entity) const
+{
+    return m_entities.find(entity).has_value();
 }
 
 void EntityManager::removeAllTargets()
 {
-    m_entities.erase(
-        std::remove_if(m_entities.begin(), m_entities.end(),
-            [](const Entity& entity) { return entity.destroyable; }),
-        m_entities.end());
+    // backwards so the entities swapped in were already looked at
+    for (size_t i = m_entities.size(); i-- > 0;) {
+        if (m_entities.healths()[i].destroyable) {
+            removeEntityAt(i);
+        }
+    }
+}
+
+void EntityManager::reserve(size_t count)
+{
+    m_entities.reserve(count);
+    m_colliders.reserve(count);
+    m_broadphase.reserve(count);
+    m_spawnGrid.reserve(count);
+    m_deadEntities.reserve(count);
+    m_spawnPoints.reserve(count);
+    m_overlapCandidates.reserve(count);
+    m_blockedCandidates.reserve(count);
 }
 
 size_t EntityManager::targetCount() const
 {
-    return std::count_if(m_entities.begin(), m_entities.end(),
-        [](const Entity& entity) { return entity.destroyable; });
+    const auto& healths = m_entities.healths();
+    return std::count_if(healths.begin(), healths.end(),
+        [](const HealthComponent& health) { return health.destroyable; });
 }
 
-bool EntityManager::updateShotEntities(
-    const glm::vec3& eyePos, const glm::vec3& eyeDir)
+void EntityManager::rebuildBvh()
 {
-    auto closestEntityIt = m_entities.end();
-    float closestDist = FLT_MAX;
+    m_bvh.build(m_colliders);
+    m_bvhOutdated = false;
+    m_teleportsSinceRebuild = 0;
+}
 
-    for (auto it = m_entities.begin(); it != m_entities.end(); it++) {
-        const auto& entity = *it;
-        auto intersection
-            = entity.collisionObject()->isIntersectedByLine(eyePos, eyeDir);
+void EntityManager::prepareSpawning()
+{
+    rebuildSpawnGrid();
+    buildSpawnSamplers();
 
-        if (intersection.has_value()) {
-            if (intersection->dist < closestDist) {
-                closestDist = intersection->dist;
-                closestEntityIt = it;
-            }
+    for (size_t i = 0; i < m_entities.size(); i++) {
+        if (m_entities.spawnVolume(i).has_value()) {
+            moveEntityToFreePosition(i);
         }
     }
+}
+
+void EntityManager::setArena(const Aabb& arena)
+{
+    m_entities.setArena(arena);
+}
 
-    if (closestEntityIt != m_entities.end() && closestEntityIt->destroyable) {
-        closestEntityIt->setDamagedThisFrame();
-        return true;
+size_t EntityManager::updateShotEntities(
+    const glm::vec3& eyePos, const std::vector<glm::vec3>& eyeDirs)
+{
+    // where they were in the last frame rendered, same as the others
+    syncColliders(m_entities.catchUpGpuMovements(*g_jobSystem));
+
+    // a quarter of the entities teleporting is a rough guess at when
+    // the refitted tree gets worse than a fresh one
+    if (m_bvhOutdated
+        || m_teleportsSinceRebuild > m_bvh.colliderCount() / 4) {
+        rebuildBvh();
     }
 
-    return false;
+    m_bvh.closestHits(m_colliders, eyePos, eyeDirs, m_shotHits);
+
+    size_t hitCount = 0;
+    auto& healths = m_entities.healths();
+    for (const auto& hit : m_shotHits) {
+        if (!hit.has_value()) {
+            continue;
+        }
+
+        HealthComponent& health = healths[m_colliders.owner(hit->collider)];
+        if (health.destroyable) {
+            health.hitsThisFrame++;
+            hitCount++;
+        }
+    }
+
+    return hitCount;
+}
+
+const std::vector<std::optional<ColliderHit>>&
+EntityManager::lastShotHits() const
+{
+    return m_shotHits;
+}
+
+bool EntityManager::applyPickedHit(uint32_t id)
+{
+    if (id == 0 || id - 1 >= m_colliders.handleLimit()) {
+        return false;
+    }
+
+    // the entity might have been removed since the frame was rendered
+    ColliderHandle collider = id - 1;
+    uint32_t owner = m_colliders.owner(collider);
+    if (owner >= m_entities.size()
+        || m_entities.colliders()[owner].handle != collider) {
+        return false;
+    }
+
+    HealthComponent& health = m_entities.healths()[owner];
+    if (!health.destroyable) {
+        return false;
+    }
+
+    health.hitsThisFrame++;
+    return true;
 }
 
 void EntityManager::updateEntities(float timeElapsedSeconds)
 {
-    auto it = m_entities.begin();
-    while (it != m_entities.end()) {
-        bool died = it->update(timeElapsedSeconds);
-        if (!died) {
-            ++it;
-            continue;
-        }
+    advanceTo(timeElapsedSeconds);
+    // the colliders of GPU moved entities are only up to date for shots
+    if (m_entities.gpuMovement()) {
+        m_contacts.clear();
+    } else {
+        resolveContacts();
+    }
+}
 
-        if (it->type == Entity::Type::GONER) {
-            it = m_entities.erase(it);
-        } else if (it->type == Entity::Type::MOVER) {
-            moveEntityToFreePosition(*it);
-            ++it;
+void EntityManager::advanceTo(float timeElapsedSeconds)
+{
+    applyHits();
+
+    // backwards so removing one doesn't move the ones left to handle
+    for (size_t i = m_deadEntities.size(); i-- > 0;) {
+        EntityIndex entity = m_deadEntities[i];
+        if (m_entities.healths()[entity].type == Entity::Type::GONER) {
+            removeEntityAt(entity);
+        } else {
+            moveEntityToFreePosition(entity);
+            m_teleportsSinceRebuild++;
         }
     }
+
+    moveEntities(timeElapsedSeconds);
+}
+
+void EntityManager::setGpuMovement(bool enabled)
+{
+    m_entities.setGpuMovement(enabled);
 }
 
-const std::vector<Entity>& EntityManager::entities() const
+void EntityManager::updateMatrices()
+{
+    m_entities.updateMatrices(*g_jobSystem);
+}
+
+const EntityStore& EntityManager::entities() const
 {
     return m_entities;
 }
 
-CollisionResult EntityManager::areEntitiesColliding(
-    const Entity& e1, const Entity& e2)
+const std::vector<Contact>& EntityManager::contacts() const
+{
+    return m_contacts;
+}
+
+void EntityManager::applyHits()
 {
-    const CollisionObject* c1 = e1.collisionObject();
-    const CollisionObject* c2 = e2.collisionObject();
+    m_deadEntities.clear();
 
-    if ((c1->type() == CollisionObject::Type::SPHERE
-            && c2->type() == CollisionObject::Type::SPHERE)) {
-        // sphere on sphere collision
-        const auto* s1 = dynamic_cast<const CollisionSphere*>(c1);
-        const auto* s2 = dynamic_cast<const CollisionSphere*>(c2);
-        float distanceCenters = glm::distance(s1->pos(), s2->pos());
+    auto& healths = m_entities.healths();
+    for (size_t i = 0; i < healths.size(); i++) {
+        HealthComponent& health = healths[i];
+        if (health.hitsThisFrame == 0) {
+            continue;
+        }
 
-        float penetration = -(distanceCenters - s1->radius() - s2->radius());
-        if (penetration > 0) {
-            // collision happened
-            CollisionData result;
-            result.penetration = penetration;
-            result.normal = s2->pos() - s1->pos();
-            return result;
+        health.current -= health.hitsThisFrame;
+        health.hitsThisFrame = 0;
+        if (health.current <= 0) {
+            health.current = health.starting;
+            m_deadEntities.push_back(i);
         }
     }
+}
 
-    return std::nullopt;
+void EntityManager::moveEntities(float timeElapsedSeconds)
+{
+    syncColliders(m_entities.moveEntities(timeElapsedSeconds, *g_jobSystem));
 }
 
-// This is VERY naive, but still easily fast enough
-void EntityManager::moveEntityToFreePosition(Entity& entityToMove)
+void EntityManager::resolveContacts()
 {
-    while (true) {
-        float newX = g_rng->getFloatInRange(-8.0f, 8.0f);
-        float newY = g_rng->getFloatInRange(2.0f, 18.0f);
-        float newZ = -8.0f;
-        entityToMove.referentialPos = glm::vec3(newX, newY, newZ);
-        entityToMove.moveRelative(glm::vec3(0.0f, 0.0f,
-            0.0f)); // update position after changing referential
+    m_contacts.clear();
+    m_broadphase.findPairs(m_colliders, m_broadphasePairs);
 
-        bool validPos = true;
-        for (auto& entity : m_entities) {
-            if (entity.getName() != entityToMove.getName()
-                && areEntitiesColliding(entity, entityToMove)) {
-                validPos = false;
-                break;
+    // The narrow phase of every pair runs on the poses from before any
+    // push, then the pushes are applied in pair order, so the result
+    // doesn't depend on the number of threads
+    m_pairCollisions.resize(m_broadphasePairs.size());
+    g_jobSystem->parallelFor(m_broadphasePairs.size(), PAIRS_PER_JOB,
+        [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const auto& [first, second] = m_broadphasePairs[i];
+                m_pairCollisions[i] = m_colliders.collide(first, second);
             }
+        });
+
+    for (size_t i = 0; i < m_broadphasePairs.size(); i++) {
+        const auto& [first, second] = m_broadphasePairs[i];
+        const CollisionResult& collision = m_pairCollisions[i];
+        if (!collision.has_value()) {
+            continue;
         }
+        m_contacts.push_back({ first, second, collision.value() });
+
+        // only entities with a movement get pushed, walls and
+        // still targets stay where they are
+        EntityIndex firstEntity = m_colliders.owner(first);
+        EntityIndex secondEntity = m_colliders.owner(second);
+        bool firstMoves = m_entities.moves(firstEntity);
+        bool secondMoves = m_entities.moves(secondEntity);
+        float share = firstMoves && secondMoves ? 0.5f : 1.0f;
+        glm::vec3 push = collision->normal * collision->penetration * share;
 
-        if (validPos) {
+        // the normal points from first to second
+        if (firstMoves) {
+            displace(firstEntity, -push);
+        }
+        if (secondMoves) {
+            displace(secondEntity, push);
+        }
+    }
+}
+
+void EntityManager::syncCollider(EntityIndex entity)
+{
+    ColliderHandle collider = m_entities.colliders()[entity].handle;
+    if (collider == INVALID_COLLIDER) {
+        return;
+    }
+
+    m_colliders.setPose(collider, m_entities.colliderPose(entity));
+    m_spawnGrid.update(collider, m_colliders.bounds(collider));
+    if (!m_bvhOutdated) {
+        m_bvh.refit(m_colliders, collider);
+    }
+}
+
+void EntityManager::syncColliders(const std::vector<EntityIndex>& entities)
+{
+    // poses are independent, the grid and the tree aren't
+    g_jobSystem->parallelFor(
+        entities.size(), POSES_PER_JOB, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                ColliderHandle collider
+                    = m_entities.colliders()[entities[i]].handle;
+                if (collider != INVALID_COLLIDER) {
+                    m_colliders.setPose(
+                        collider, m_entities.colliderPose(entities[i]));
+                }
+            }
+        });
+
+    for (EntityIndex entity : entities) {
+        ColliderHandle collider = m_entities.colliders()[entity].handle;
+        if (collider == INVALID_COLLIDER) {
+            continue;
+        }
+
+        m_spawnGrid.update(collider, m_colliders.bounds(collider));
+        if (!m_bvhOutdated) {
+            m_bvh.refit(m_colliders, collider);
+        }
+    }
+}
+
+void EntityManager::removeCollider(EntityIndex entity)
+{
+    ColliderHandle& collider = m_entities.colliders()[entity].handle;
+    if (collider == INVALID_COLLIDER) {
+        return;
+    }
+
+    releaseSpawnPoint(entity);
+    m_spawnGrid.remove(collider);
+    m_broadphase.remove(collider);
+    if (!m_bvhOutdated) {
+        // it hands a collider to another leaf, which loosens the tree
+        // like a teleport does
+        m_bvh.remove(m_colliders, collider);
+        m_teleportsSinceRebuild++;
+    }
+    m_colliders.remove(collider);
+    collider = INVALID_COLLIDER;
+}
+
+void EntityManager::removeEntityAt(EntityIndex entity)
+{
+    removeCollider(entity);
+    m_entities.swapRemove(entity);
+
+    if (entity < m_entities.size()) {
+        ColliderHandle moved = m_entities.colliders()[entity].handle;
+        if (moved != INVALID_COLLIDER) {
+            m_colliders.setOwner(moved, entity);
+        }
+    }
+}
+
+void EntityManager::moveEntityToFreePosition(EntityIndex entity)
+{
+    releaseSpawnPoint(entity);
+    if (moveToSpawnPoint(entity)) {
+        return;
+    }
+
+    const Aabb& volume
+        = m_entities.spawnVolume(entity).value_or(DEFAULT_SPAWN_VOLUME);
+
+    // better overlapping something than looping forever
+    for (int attempt = 0; attempt < MAX_RESPAWN_ATTEMPTS; attempt++) {
+        placeAt(entity,
+            glm::vec3(g_rng->getFloatInRange(volume.min.x, volume.max.x),
+                g_rng->getFloatInRange(volume.min.y, volume.max.y),
+                g_rng->getFloatInRange(volume.min.z, volume.max.z)));
+
+        if (!overlapsAnything(entity)) {
             break;
         }
     }
 }
+
+// Spawn points are far enough apart for targets on them not to touch,
+// but something else (a wall, a moving target) can still be in the way
+bool EntityManager::moveToSpawnPoint(EntityIndex entity)
+{
+    ColliderHandle collider = m_entities.colliders()[entity].handle;
+    if (collider == INVALID_COLLIDER || collider >= m_spawnPoints.size()
+        || m_spawnPoints[collider].sampler < 0) {
+        return false;
+    }
+
+    SpawnPoint& spawnPoint = m_spawnPoints[collider];
+    SpawnSampler& sampler = m_spawnSamplers[spawnPoint.sampler];
+    m_blockedCandidates.clear();
+
+    for (int attempt = 0; attempt < MAX_RESPAWN_ATTEMPTS; attempt++) {
+        std::optional<uint32_t> candidate = sampler.acquire(*g_rng);
+        if (!candidate.has_value()) {
+            break;
+        }
+
+        placeAt(entity, sampler.candidate(candidate.value()));
+        if (!overlapsAnything(entity)) {
+            spawnPoint.candidate = candidate;
+            break;
+        }
+        // kept until the end so the same one isn't picked again
+        m_blockedCandidates.push_back(candidate.value());
+    }
+
+    for (uint32_t candidate : m_blockedCandidates) {
+        sampler.release(candidate);
+    }
+
+    return spawnPoint.candidate.has_value();
+}
+
+void EntityManager::placeAt(EntityIndex entity, const glm::vec3& pos)
+{
+    m_entities.place(entity, pos);
+    // where its movement puts it right now, if it has one
+    m_entities.applyMovement(entity);
+    syncCollider(entity);
+}
+
+void EntityManager::displace(EntityIndex entity, const glm::vec3& offset)
+{
+    m_entities.displace(entity, offset);
+    syncCollider(entity);
+}
+
+bool EntityManager::overlapsAnything(EntityIndex entity)
+{
+    ColliderHandle collider = m_entities.colliders()[entity].handle;
+    if (collider == INVALID_COLLIDER) {
+        return false;
+    }
+
+    m_spawnGrid.query(m_colliders.bounds(collider), m_overlapCandidates);
+    for (ColliderHandle other : m_overlapCandidates) {
+        if (other != collider && m_colliders.collide(collider, other)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void EntityManager::rebuildSpawnGrid()
+{
+    float totalSize = 0.0f;
+    size_t targets = 0;
+    for (size_t i = 0; i < m_entities.size(); i++) {
+        ColliderHandle collider = m_entities.colliders()[i].handle;
+        if (m_entities.healths()[i].destroyable
+            && collider != INVALID_COLLIDER) {
+            Aabb bounds = m_colliders.bounds(collider);
+            glm::vec3 size = bounds.max - bounds.min;
+            totalSize += std::max(size.x, std::max(size.y, size.z));
+            targets++;
+        }
+    }
+
+    float cellSize = targets == 0
+        ? 1.0f
+        : std::max(totalSize / targets * SPAWN_GRID_CELL_SCALE, 0.1f);
+    m_spawnGrid.reset(cellSize);
+    for (const auto& collider : m_entities.colliders()) {
+        if (collider.handle != INVALID_COLLIDER) {
+            m_spawnGrid.insert(
+                collider.handle, m_colliders.bounds(collider.handle));
+        }
+    }
+}
+
+void EntityManager::releaseSpawnPoint(EntityIndex entity)
+{
+    ColliderHandle collider = m_entities.colliders()[entity].handle;
+    if (collider == INVALID_COLLIDER || collider >= m_spawnPoints.size()) {
+        return;
+    }
+
+    SpawnPoint& spawnPoint = m_spawnPoints[collider];
+    if (spawnPoint.candidate.has_value()) {
+        m_spawnSamplers[spawnPoint.sampler].release(
+            spawnPoint.candidate.value());
+        spawnPoint.candidate = std::nullopt;
+    }
+}
+
+// Entities with the same spawn volume share a sampler, with points far
+// enough apart for the biggest of them
+void EntityManager::buildSpawnSamplers()
+{
+    // the last ones are reused when they match, restarting a scenario
+    // would generate the same samplers again otherwise
+    std::swap(m_spawnSamplers, m_oldSpawnSamplers);
+    m_spawnSamplers.clear();
+    m_spawnPoints.assign(m_colliders.handleLimit(), SpawnPoint());
+
+    std::vector<Aabb>& volumes = m_samplerVolumes;
+    std::vector<float>& separations = m_samplerSeparations;
+    volumes.clear();
+    separations.clear();
+    for (size_t i = 0; i < m_entities.size(); i++) {
+        ColliderHandle collider = m_entities.colliders()[i].handle;
+        if (!m_entities.spawnVolume(i).has_value()
+            || collider == INVALID_COLLIDER) {
+            continue;
+        }
+
+        const Aabb& volume = m_entities.spawnVolume(i).value();
+        auto it = std::find_if(
+            volumes.begin(), volumes.end(), [&volume](const Aabb& other) {
+                return other.min == volume.min && other.max == volume.max;
+            });
+        auto sampler = (int32_t)(it - volumes.begin());
+        if (it == volumes.end()) {
+            volumes.push_back(volume);
+            separations.push_back(0.0f);
+        }
+
+        // diameter of a sphere around the collider
+        ColliderPose pose = m_entities.colliderPose(i);
+        float diameter = m_colliders.shape(collider) == ColliderShape::Sphere
+            ? std::max(pose.size.x, std::max(pose.size.y, pose.size.z))
+            : glm::length(pose.size);
+        separations[sampler] = std::max(separations[sampler], diameter);
+        m_spawnPoints[collider].sampler = sampler;
+    }
+
+    m_spawnSamplers.reserve(volumes.size());
+    for (size_t i = 0; i < volumes.size(); i++) {
+        auto old = std::find_if(m_oldSpawnSamplers.begin(),
+            m_oldSpawnSamplers.end(), [&](const SpawnSampler& sampler) {
+                return sampler.volume().min == volumes[i].min
+                    && sampler.volume().max == volumes[i].max
+                    && sampler.minSeparation() == separations[i];
+            });
+
+        if (old != m_oldSpawnSamplers.end()) {
+            old->releaseAll();
+            m_spawnSamplers.push_back(std::move(*old));
+            m_oldSpawnSamplers.erase(old);
+        } else {
+            m_spawnSamplers.emplace_back(volumes[i], separations[i], *g_rng);
+        }
+    }
+}
\ No newline at end of file
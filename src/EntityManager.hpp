@@ -1,32 +1,139 @@
 #pragma once
 
+#include "Bvh.hpp"
+#include "ColliderStore.hpp"
 #include "Entity.hpp"
+#include "EntityStore.hpp"
+#include "SpatialHashGrid.hpp"
+#include "SpawnSampler.hpp"
+#include "SweepAndPrune.hpp"
 
-struct CollisionData {
-    float penetration;
-    glm::vec3 normal;
-};
-
-using CollisionResult = std::optional<CollisionData>;
+#include <optional>
+#include <vector>
 
 class EntityManager {
 public:
     EntityManager() = default;
 
-    void addEntity(Entity entity);
+    // The entity follows parent around if it's alive, see
+    // EntityStore::add()
+    EntityHandle addEntity(const Entity& entity, EntityHandle parent = {});
+    // Does nothing if the entity was removed already
+    void removeEntity(EntityHandle entity);
+    bool isAlive(EntityHandle entity) const;
     void removeAllTargets();
+    // Makes room for count entities, so filling a scenario up to that
+    // doesn't allocate
+    void reserve(size_t count);
     size_t targetCount() const;
+    // Meant to be called once all the entities of a scenario were added,
+    // otherwise the first shot pays for it
+    void rebuildBvh();
+    // Sets up respawning for the targets that were added, and moves the
+    // ones that spawn randomly to their first spawn point. Meant to be
+    // called once all the entities of a scenario were added
+    void prepareSpawning();
+    // What targets with a physics body bounce off
+    void setArena(const Aabb& arena);
 
-    // returns whether an entity was hit
-    bool updateShotEntities(const glm::vec3& eyePos, const glm::vec3& eyeDir);
+    // One ray per pellet of the shot, all tested in one go. Returns how
+    // many pellets hit an entity
+    size_t updateShotEntities(
+        const glm::vec3& eyePos, const std::vector<glm::vec3>& eyeDirs);
     void updateEntities(float timeElapsedSeconds);
+    // The first half of updateEntities(): applies the hits of the shots
+    // so far and moves the entities to where they are at
+    // timeElapsedSeconds, without pushing them apart. Shots fired between
+    // two updates are tested after this, at the time they were fired
+    void advanceTo(float timeElapsedSeconds);
+    // What each pellet of the last shot hit, same order as its eyeDirs
+    const std::vector<std::optional<ColliderHit>>& lastShotHits() const;
+    // Hits the entity with an id from the id buffer (collider handle
+    // + 1). Returns whether an entity was hit
+    bool applyPickedHit(uint32_t id);
+
+    // Lets model.vert evaluate the movements it can (see
+    // EntityStore::setGpuMovement). Moving entities don't push each other
+    // out while enabled
+    void setGpuMovement(bool enabled);
 
-    const std::vector<Entity>& entities() const;
+    // Matrices are only recomputed by this, it has to be called before
+    // rendering the entities
+    void updateMatrices();
+    const EntityStore& entities() const;
+    // Overlapping pairs with at least one moving entity, as of the last
+    // update. Moving entities were pushed out of them already
+    const std::vector<Contact>& contacts() const;
 
 private:
-    static CollisionResult areEntitiesColliding(
-        const Entity& e1, const Entity& e2);
-    void moveEntityToFreePosition(Entity& entityToMove);
+    // Systems, each only touches the components it needs
+
+    // Applies the hits of the last shots, fills m_deadEntities
+    void applyHits();
+    // Moves the entities with a movement
+    void moveEntities(float timeElapsedSeconds);
+    // Finds the contacts of the moving entities, then pushes them apart
+    void resolveContacts();
+
+    // Respawns the entity at a free spawn point of its volume, or at a
+    // random place of it where it doesn't overlap anything if there is
+    // none. Gives up after MAX_RESPAWN_ATTEMPTS, it then overlaps
+    // something
+    void moveEntityToFreePosition(EntityIndex entity);
+    bool moveToSpawnPoint(EntityIndex entity);
+    void placeAt(EntityIndex entity, const glm::vec3& pos);
+    // Moves the entity and its referential together, so its movement
+    // carries on from where it was pushed to. A physics body bounces off
+    // whatever pushed it, and children catch up on the next update
+    void displace(EntityIndex entity, const glm::vec3& offset);
+    bool overlapsAnything(EntityIndex entity);
+    void releaseSpawnPoint(EntityIndex entity);
+    void rebuildSpawnGrid();
+    void buildSpawnSamplers();
+    // Copies the pose of an entity that moved to its collider
+    void syncCollider(EntityIndex entity);
+    void syncColliders(const std::vector<EntityIndex>& entities);
+    void removeCollider(EntityIndex entity);
+    // The last entity takes its index, so its collider gets a new owner
+    void removeEntityAt(EntityIndex entity);
+
+    EntityStore m_entities;
+    // kept around so updates don't allocate
+    std::vector<EntityIndex> m_deadEntities;
+    // kept around so shots don't allocate
+    std::vector<std::optional<ColliderHit>> m_shotHits;
 
-    std::vector<Entity> m_entities;
+    ColliderStore m_colliders;
+    Bvh m_bvh;
+    // set when colliders were added or removed, the pools aren't laid out
+    // in tree order anymore then
+    bool m_bvhOutdated = true;
+    SpatialHashGrid m_spawnGrid;
+    // one per distinct spawn volume
+    std::vector<SpawnSampler> m_spawnSamplers;
+    // from before the last buildSpawnSamplers(), for it to reuse
+    std::vector<SpawnSampler> m_oldSpawnSamplers;
+    // kept around so scenario starts don't allocate
+    std::vector<Aabb> m_samplerVolumes;
+    std::vector<float> m_samplerSeparations;
+    struct SpawnPoint {
+        // -1 if the entity doesn't use a sampler
+        int32_t sampler = -1;
+        std::optional<uint32_t> candidate;
+    };
+    // indexed by collider handle
+    std::vector<SpawnPoint> m_spawnPoints;
+    // kept around so respawns don't allocate
+    std::vector<ColliderHandle> m_overlapCandidates;
+    std::vector<uint32_t> m_blockedCandidates;
+    SweepAndPrune m_broadphase;
+    // kept around so updates don't allocate
+    std::vector<ColliderPair> m_broadphasePairs;
+    // same order as m_broadphasePairs
+    std::vector<CollisionResult> m_pairCollisions;
+    std::vector<Contact> m_contacts;
+    // entities that teleported (respawned) since the last rebuild. Refitting
+    // after a teleport inflates boxes up to the root, so too many of them
+    // make shots slower than a rebuild would
+    size_t m_teleportsSinceRebuild = 0;
 };
\ No newline at end of file
@@ -0,0 +1,578 @@
+#include "EntityStore.hpp"
+
+#include "utils.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <utility>
+
+namespace {
+
+// a few dozen multiplications each
+constexpr size_t MATRICES_PER_JOB = 128;
+
+template <typename T> void swapRemoveFrom(std::vector<T>& vec, size_t index)
+{
+    vec[index] = std::move(vec.back());
+    vec.pop_back();
+}
+
+// Laid flat above the entity, only needs to be moved along with it
+glm::mat4 healthbarBaseMatrix()
+{
+    return glm::scale(anglesToRotationMatrix(Rotation(90.0f, 0.0f, 0.0f)),
+        glm::vec3(0.5f, 0.0f, 0.1f));
+}
+
+}
+
+EntityIndex EntityStore::add(
+    const Entity& entity, std::optional<EntityIndex> parent)
+{
+    auto index = (EntityIndex)size();
+
+    // a physics body only starts at its parent, it isn't its child after
+    // that so it doesn't count as one
+    bool child = parent.has_value() && !entity.m_physics.has_value();
+    if (child) {
+        // it has to be where the CPU puts it from now on
+        bool wasGpuMoved = gpuMoved(parent.value());
+        EntityIndex& firstChild = m_firstChildren[parent.value()];
+        if (firstChild != NO_ENTITY) {
+            m_previousSiblings[firstChild] = index;
+        }
+        m_nextSiblings.push_back(firstChild);
+        firstChild = index;
+        if (wasGpuMoved) {
+            applyMovement(parent.value());
+        }
+    }
+    glm::vec3 pos = entity.m_pos;
+    if (parent.has_value()) {
+        pos += m_transforms[parent.value()].pos;
+    }
+    if (child) {
+        m_hierarchyNodes.push_back((uint32_t)m_hierarchy.size());
+        m_hierarchy.push_back({ index, parent.value(), entity.m_pos });
+    } else {
+        m_hierarchyNodes.push_back(std::nullopt);
+        m_nextSiblings.push_back(NO_ENTITY);
+    }
+    m_previousSiblings.push_back(NO_ENTITY);
+    m_firstChildren.push_back(NO_ENTITY);
+
+    uint32_t slot;
+    if (m_freeSlots.empty()) {
+        slot = m_slots.size();
+        m_slots.push_back({ index, 0 });
+    } else {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        // the generation was bumped on removal already
+        m_slots[slot].entity = index;
+    }
+    m_entitySlots.push_back(slot);
+
+    glm::mat3 rotation(1.0f);
+    const std::optional<Rotation>& angles = entity.m_rotation;
+    if (angles.has_value()) {
+        rotation = glm::mat3(anglesToRotationMatrix(angles.value()));
+    }
+    m_transforms.push_back({ pos, pos, entity.m_size, rotation });
+    m_healths.push_back({ entity.m_startingHealth, entity.m_startingHealth,
+        0, entity.destroyable, entity.type });
+    if (entity.m_movement.has_value()) {
+        m_movements.push_back(
+            m_movementPools.add(entity.m_movement.value(), index));
+    } else {
+        m_movements.push_back(std::nullopt);
+    }
+    if (entity.m_physics.has_value()) {
+        m_bodies.push_back(m_physics.add(
+            entity.m_physics.value(), pos, entity.m_size * 0.5f, index));
+    } else {
+        m_bodies.push_back(std::nullopt);
+    }
+    m_colliders.push_back(
+        { INVALID_COLLIDER, entity.m_model.get().triangleBvh() });
+    m_renders.push_back({ &entity.m_model.get(), &entity.m_material.get(),
+        &entity.m_shader.get(), glm::mat4(1.0f), glm::mat3(1.0f),
+        glm::mat4(1.0f) });
+    m_moved.push_back(false);
+    m_spawnVolumes.push_back(entity.m_spawnVolume);
+    m_names.push_back(entity.m_name);
+
+    markMoved(index);
+    m_gpuMovementVersion++;
+    return index;
+}
+
+void EntityStore::swapRemove(EntityIndex entity)
+{
+    // the GPU movements are indexed by entity
+    m_gpuMovementVersion++;
+
+    // the movements have their own order, and their owner changes too
+    if (m_movements[entity].has_value()) {
+        std::optional<uint32_t> moved
+            = m_movementPools.swapRemove(m_movements[entity].value());
+        if (moved.has_value()) {
+            m_movements[moved.value()] = m_movements[entity];
+        }
+    }
+    if (m_bodies[entity].has_value()) {
+        std::optional<uint32_t> moved
+            = m_physics.swapRemove(m_bodies[entity].value());
+        if (moved.has_value()) {
+            m_bodies[moved.value()] = m_bodies[entity];
+        }
+    }
+    // the last entity is about to take the index of the one removed
+    if (entity + 1 < size() && m_movements.back().has_value()) {
+        m_movementPools.setOwner(m_movements.back().value(), entity);
+    }
+    if (entity + 1 < size() && m_bodies.back().has_value()) {
+        m_physics.setOwner(m_bodies.back().value(), entity);
+    }
+
+    // its children lose their parent and stay where they are
+    if (m_hierarchyNodes[entity].has_value()) {
+        detachFromParent(entity);
+    }
+    while (m_firstChildren[entity] != NO_ENTITY) {
+        detachFromParent(m_firstChildren[entity]);
+    }
+
+    // only the links to the last entity have to follow it
+    auto last = (EntityIndex)size() - 1;
+    if (last != entity && m_hierarchyNodes[last].has_value()) {
+        HierarchyNode& node = m_hierarchy[m_hierarchyNodes[last].value()];
+        node.entity = entity;
+        if (m_previousSiblings[last] != NO_ENTITY) {
+            m_nextSiblings[m_previousSiblings[last]] = entity;
+        } else {
+            m_firstChildren[node.parent] = entity;
+        }
+        if (m_nextSiblings[last] != NO_ENTITY) {
+            m_previousSiblings[m_nextSiblings[last]] = entity;
+        }
+    }
+    if (last != entity) {
+        for (EntityIndex child = m_firstChildren[last]; child != NO_ENTITY;
+            child = m_nextSiblings[child]) {
+            m_hierarchy[m_hierarchyNodes[child].value()].parent = entity;
+        }
+    }
+
+    uint32_t slot = m_entitySlots[entity];
+    m_slots[slot].generation++;
+    m_freeSlots.push_back(slot);
+    m_slots[m_entitySlots.back()].entity = entity;
+    swapRemoveFrom(m_entitySlots, entity);
+
+    swapRemoveFrom(m_transforms, entity);
+    swapRemoveFrom(m_healths, entity);
+    swapRemoveFrom(m_movements, entity);
+    swapRemoveFrom(m_bodies, entity);
+    swapRemoveFrom(m_hierarchyNodes, entity);
+    swapRemoveFrom(m_firstChildren, entity);
+    swapRemoveFrom(m_nextSiblings, entity);
+    swapRemoveFrom(m_previousSiblings, entity);
+    swapRemoveFrom(m_colliders, entity);
+    swapRemoveFrom(m_renders, entity);
+    swapRemoveFrom(m_moved, entity);
+    // its index in m_movedEntities is the old one
+    if (entity < m_moved.size() && m_moved[entity]) {
+        m_movedEntities.push_back(entity);
+    }
+    swapRemoveFrom(m_spawnVolumes, entity);
+    swapRemoveFrom(m_names, entity);
+}
+
+void EntityStore::reserve(size_t count)
+{
+    m_slots.reserve(count);
+    m_freeSlots.reserve(count);
+    m_entitySlots.reserve(count);
+    m_transforms.reserve(count);
+    m_healths.reserve(count);
+    m_movements.reserve(count);
+    m_movementPools.reserve(count);
+    m_bodies.reserve(count);
+    m_physics.reserve(count);
+    m_hierarchy.reserve(count);
+    m_hierarchyNodes.reserve(count);
+    m_firstChildren.reserve(count);
+    m_nextSiblings.reserve(count);
+    m_previousSiblings.reserve(count);
+    m_movementOffsets.reserve(count);
+    m_movementOwners.reserve(count);
+    m_colliders.reserve(count);
+    m_renders.reserve(count);
+    m_moved.reserve(count);
+    m_movedEntities.reserve(count);
+    m_spawnVolumes.reserve(count);
+    m_names.reserve(count);
+}
+
+size_t EntityStore::size() const
+{
+    return m_transforms.size();
+}
+
+EntityHandle EntityStore::handle(EntityIndex entity) const
+{
+    uint32_t slot = m_entitySlots[entity];
+    return { slot, m_slots[slot].generation };
+}
+
+std::optional<EntityIndex> EntityStore::find(EntityHandle handle) const
+{
+    if (handle.slot >= m_slots.size()) {
+        return std::nullopt;
+    }
+
+    const Slot& slot = m_slots[handle.slot];
+    if (slot.generation != handle.generation) {
+        return std::nullopt;
+    }
+
+    return slot.entity;
+}
+
+std::vector<TransformComponent>& EntityStore::transforms()
+{
+    return m_transforms;
+}
+
+const std::vector<TransformComponent>& EntityStore::transforms() const
+{
+    return m_transforms;
+}
+
+std::vector<HealthComponent>& EntityStore::healths()
+{
+    return m_healths;
+}
+
+const std::vector<HealthComponent>& EntityStore::healths() const
+{
+    return m_healths;
+}
+
+std::vector<ColliderComponent>& EntityStore::colliders()
+{
+    return m_colliders;
+}
+
+const std::vector<ColliderComponent>& EntityStore::colliders() const
+{
+    return m_colliders;
+}
+
+const std::vector<RenderComponent>& EntityStore::renders() const
+{
+    return m_renders;
+}
+
+bool EntityStore::moves(EntityIndex entity) const
+{
+    return m_movements[entity].has_value() || m_bodies[entity].has_value();
+}
+
+const std::vector<EntityIndex>& EntityStore::moveEntities(
+    float timeSeconds, JobSystem& jobs)
+{
+    m_movementTime = timeSeconds;
+    m_movementPools.evaluate(timeSeconds,
+        m_gpuMovement ? MovementFilter::CpuOnly : MovementFilter::All, jobs,
+        m_movementOffsets, m_movementOwners);
+
+    for (size_t i = 0; i < m_movementOwners.size(); i++) {
+        EntityIndex entity = m_movementOwners[i];
+        TransformComponent& transform = m_transforms[entity];
+        transform.pos = transform.referentialPos + m_movementOffsets[i];
+        markMoved(entity);
+    }
+
+    // the bodies are the only thing deciding where their entity is, so
+    // the referential follows
+    m_physics.advanceTo(timeSeconds, jobs);
+    const std::vector<uint32_t>& bodyOwners = m_physics.owners();
+    for (size_t i = 0; i < bodyOwners.size(); i++) {
+        EntityIndex entity = bodyOwners[i];
+        TransformComponent& transform = m_transforms[entity];
+        transform.pos = m_physics.position(i);
+        transform.referentialPos = transform.pos;
+        markMoved(entity);
+        m_movementOwners.push_back(entity);
+    }
+
+    moveChildren();
+    return m_movementOwners;
+}
+
+void EntityStore::applyMovement(EntityIndex entity)
+{
+    if (m_bodies[entity].has_value()) {
+        m_physics.restart(
+            m_bodies[entity].value(), m_transforms[entity].referentialPos);
+        return;
+    }
+    if (!m_movements[entity].has_value()) {
+        return;
+    }
+
+    TransformComponent& transform = m_transforms[entity];
+    transform.pos = transform.referentialPos
+        + m_movementPools.evaluate(
+            m_movements[entity].value(), m_movementTime);
+    markMoved(entity);
+}
+
+void EntityStore::place(EntityIndex entity, const glm::vec3& pos)
+{
+    TransformComponent& transform = m_transforms[entity];
+    transform.referentialPos = pos;
+    transform.pos = pos;
+    if (m_hierarchyNodes[entity].has_value()) {
+        HierarchyNode& node = m_hierarchy[m_hierarchyNodes[entity].value()];
+        node.localPos = pos - m_transforms[node.parent].pos;
+    }
+    markMoved(entity);
+}
+
+void EntityStore::displace(EntityIndex entity, const glm::vec3& offset)
+{
+    TransformComponent& transform = m_transforms[entity];
+    transform.referentialPos += offset;
+    transform.pos += offset;
+    if (m_hierarchyNodes[entity].has_value()) {
+        m_hierarchy[m_hierarchyNodes[entity].value()].localPos += offset;
+    }
+    if (m_bodies[entity].has_value()) {
+        m_physics.push(m_bodies[entity].value(), offset);
+    }
+    markMoved(entity);
+}
+
+void EntityStore::setArena(const Aabb& arena)
+{
+    m_physics.setArena(arena);
+}
+
+float EntityStore::movementTime() const
+{
+    return m_movementTime;
+}
+
+void EntityStore::setGpuMovement(bool enabled)
+{
+    if (enabled == m_gpuMovement) {
+        return;
+    }
+
+    m_gpuMovement = enabled;
+    m_gpuMovementVersion++;
+    // their matrices don't use the same position anymore
+    for (size_t i = 0; i < size(); i++) {
+        if (m_movements[i].has_value()) {
+            applyMovement(i);
+        }
+    }
+}
+
+bool EntityStore::gpuMovement() const
+{
+    return m_gpuMovement;
+}
+
+bool EntityStore::gpuMoved(EntityIndex entity) const
+{
+    return m_gpuMovement && m_movements[entity].has_value()
+        && m_firstChildren[entity] == NO_ENTITY
+        && m_movementPools.gpuEvaluated(m_movements[entity].value());
+}
+
+const std::vector<EntityIndex>& EntityStore::catchUpGpuMovements(
+    JobSystem& jobs)
+{
+    m_movementOwners.clear();
+    if (!m_gpuMovement) {
+        return m_movementOwners;
+    }
+
+    m_movementPools.evaluate(m_movementTime, MovementFilter::GpuOnly, jobs,
+        m_movementOffsets, m_movementOwners);
+
+    // no markMoved(), the matrices of these don't use their position
+    for (size_t i = 0; i < m_movementOwners.size(); i++) {
+        TransformComponent& transform = m_transforms[m_movementOwners[i]];
+        transform.pos = transform.referentialPos + m_movementOffsets[i];
+    }
+
+    return m_movementOwners;
+}
+
+uint64_t EntityStore::gpuMovementVersion() const
+{
+    return m_gpuMovementVersion;
+}
+
+void EntityStore::packGpuMovements(std::vector<GpuMovement>& movements) const
+{
+    movements.resize(size());
+    for (size_t i = 0; i < size(); i++) {
+        GpuMovement& packed = movements[i];
+        if (!gpuMoved(i)
+            || !m_movementPools.packForGpu(m_movements[i].value(), packed)) {
+            packed.params[0].w = -1.0f;
+        }
+    }
+}
+
+const std::optional<Aabb>& EntityStore::spawnVolume(EntityIndex entity) const
+{
+    return m_spawnVolumes[entity];
+}
+
+const std::string& EntityStore::name(EntityIndex entity) const
+{
+    return m_names[entity];
+}
+
+void EntityStore::markMoved(EntityIndex entity)
+{
+    // only moved by a respawn or a push, which changes its referential
+    if (gpuMoved(entity)) {
+        m_gpuMovementVersion++;
+    }
+
+    if (!m_moved[entity]) {
+        m_moved[entity] = true;
+        m_movedEntities.push_back(entity);
+    }
+}
+
+void EntityStore::updateMatrices(JobSystem& jobs)
+{
+    // drops the stale and repeated entries first, so every entity is
+    // only written by one job
+    size_t count = 0;
+    for (EntityIndex entity : m_movedEntities) {
+        if (entity < m_moved.size() && m_moved[entity]) {
+            m_moved[entity] = false;
+            m_movedEntities[count++] = entity;
+        }
+    }
+    m_movedEntities.resize(count);
+
+    jobs.parallelFor(count, MATRICES_PER_JOB, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            computeMatrices(m_movedEntities[i]);
+        }
+    });
+
+    m_movedEntities.clear();
+}
+
+void EntityStore::moveChildren()
+{
+    uint32_t kept = 0;
+    for (const HierarchyNode& node : m_hierarchy) {
+        if (node.entity == NO_ENTITY) {
+            continue;
+        }
+        m_hierarchyNodes[node.entity] = kept;
+        m_hierarchy[kept++] = node;
+
+        TransformComponent& transform = m_transforms[node.entity];
+        glm::vec3 referential = m_transforms[node.parent].pos + node.localPos;
+        glm::vec3 offset = referential - transform.referentialPos;
+        if (offset == glm::vec3(0.0f)) {
+            continue;
+        }
+
+        // keeps the offset of its own movement
+        transform.referentialPos = referential;
+        transform.pos += offset;
+        markMoved(node.entity);
+        // the ones moved by the CPU are in the list already
+        if (!m_movements[node.entity].has_value() || gpuMoved(node.entity)) {
+            m_movementOwners.push_back(node.entity);
+        }
+    }
+    m_hierarchy.resize(kept);
+}
+
+void EntityStore::detachFromParent(EntityIndex entity)
+{
+    HierarchyNode& node = m_hierarchy[m_hierarchyNodes[entity].value()];
+
+    EntityIndex previous = m_previousSiblings[entity];
+    EntityIndex next = m_nextSiblings[entity];
+    if (previous != NO_ENTITY) {
+        m_nextSiblings[previous] = next;
+    } else {
+        m_firstChildren[node.parent] = next;
+        // the GPU might move it again
+        if (next == NO_ENTITY) {
+            markMoved(node.parent);
+        }
+    }
+    if (next != NO_ENTITY) {
+        m_previousSiblings[next] = previous;
+    }
+    m_previousSiblings[entity] = NO_ENTITY;
+    m_nextSiblings[entity] = NO_ENTITY;
+
+    // erasing it would shift every node after it, the order matters
+    node.entity = NO_ENTITY;
+    m_hierarchyNodes[entity] = std::nullopt;
+}
+
+void EntityStore::computeMatrices(EntityIndex entity)
+{
+    static const glm::mat4 healthbarBase = healthbarBaseMatrix();
+
+    const TransformComponent& transform = m_transforms[entity];
+    RenderComponent& render = m_renders[entity];
+    const glm::vec3& size = transform.size;
+    // the vertex shaders add the offset of GPU movements themselves
+    const glm::vec3& pos
+        = gpuMoved(entity) ? transform.referentialPos : transform.pos;
+
+    // T * R * S without multiplying it out, scaling only scales the
+    // columns of the rotation
+    glm::mat3 rotationScale = transform.rotation;
+    rotationScale[0] *= size.x;
+    rotationScale[1] *= size.y;
+    rotationScale[2] *= size.z;
+    render.modelMatrix = glm::mat4(rotationScale);
+    render.modelMatrix[3] = glm::vec4(pos, 1.0f);
+
+    // The inverse transpose of R * S is R * S^-1. This is that times
+    // det(S), which is the same once normalized but still works for
+    // planes, which have a size of 0 along one axis
+    render.normalMatrix = transform.rotation;
+    render.normalMatrix[0] *= size.y * size.z;
+    render.normalMatrix[1] *= size.x * size.z;
+    render.normalMatrix[2] *= size.x * size.y;
+
+    render.healthbarMatrix = healthbarBase;
+    render.healthbarMatrix[3]
+        = glm::vec4(pos + glm::vec3(0.0f, size.y / 2 + 0.1f, 0.0f), 1.0f);
+}
+
+ColliderPose EntityStore::colliderPose(EntityIndex entity) const
+{
+    const TransformComponent& transform = m_transforms[entity];
+
+    ColliderPose pose;
+    pose.pos = transform.pos;
+    pose.size = transform.size;
+    pose.mesh = m_colliders[entity].mesh;
+    pose.rotation = transform.rotation;
+
+    return pose;
+}
\ No newline at end of file
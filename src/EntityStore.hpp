@@ -0,0 +1,228 @@
+#pragma once
+
+#include "Aabb.hpp"
+#include "ColliderStore.hpp"
+#include "Entity.hpp"
+#include "JobSystem.hpp"
+#include "Material.hpp"
+#include "Model.hpp"
+#include "Movement.hpp"
+#include "Physics.hpp"
+#include "Shader.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Index of an entity in the component arrays of the EntityStore. Changes
+// when another entity is removed, see EntityStore::swapRemove()
+using EntityIndex = uint32_t;
+// for links to an entity that aren't set
+constexpr EntityIndex NO_ENTITY = UINT32_MAX;
+
+// Refers to an entity for as long as it exists, whatever happens to the
+// others. The slot is reused once the entity is removed, but with a new
+// generation, so a handle to a removed entity is never mistaken for the
+// entity that came after it
+struct EntityHandle {
+    uint32_t slot = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool operator==(const EntityHandle& other) const = default;
+};
+
+struct TransformComponent {
+    // This holds the actual position the entity is in
+    glm::vec3 pos;
+    // This holds a reference position used for entity movement.
+    // For example, the point where the entity is circling or
+    // oscilating around
+    glm::vec3 referentialPos;
+    glm::vec3 size;
+    // computed once from the angles of the entity, nothing rotates
+    glm::mat3 rotation;
+};
+
+struct HealthComponent {
+    int starting;
+    int current;
+    // one point of damage per hit, applied on the next update
+    int hitsThisFrame;
+    bool destroyable;
+    // what happens once current gets to 0
+    Entity::Type type;
+};
+
+struct ColliderComponent {
+    ColliderHandle handle;
+    // null unless the model has triangles (for mesh hitboxes)
+    const TriangleBvh* mesh;
+};
+
+struct RenderComponent {
+    const Model* model;
+    const Material* material;
+    const Shader* shader;
+    // Only up to date after EntityStore::updateMatrices()
+    glm::mat4 modelMatrix;
+    glm::mat3 normalMatrix;
+    glm::mat4 healthbarMatrix;
+};
+
+// Every entity as a structure of arrays, one array per component, all
+// indexed by EntityIndex. Updates only walk the arrays they need: a
+// shot only reads health, moving only reads transforms and movement
+// patterns, and only the renderer reads the matrices and the resources
+class EntityStore {
+public:
+    EntityStore() = default;
+
+    // The collider isn't created here, the handle is INVALID_COLLIDER.
+    // With a parent, the position of the entity is relative to the
+    // parent's and it follows the parent around (see moveEntities()).
+    // Entities with a physics body only start there, they aren't
+    // children of the parent afterwards
+    EntityIndex add(const Entity& entity,
+        std::optional<EntityIndex> parent = std::nullopt);
+    // Moves the last entity to index, so the entity that was last has a
+    // new index afterwards. Handles to the removed entity become stale.
+    // Its children stay where they are, without a parent
+    void swapRemove(EntityIndex entity);
+    // Makes room for count entities, so adding up to that many doesn't
+    // allocate (apart from long names)
+    void reserve(size_t count);
+
+    size_t size() const;
+
+    EntityHandle handle(EntityIndex entity) const;
+    // nullopt if the handle is stale or was never valid
+    std::optional<EntityIndex> find(EntityHandle handle) const;
+
+    std::vector<TransformComponent>& transforms();
+    const std::vector<TransformComponent>& transforms() const;
+    std::vector<HealthComponent>& healths();
+    const std::vector<HealthComponent>& healths() const;
+    std::vector<ColliderComponent>& colliders();
+    const std::vector<ColliderComponent>& colliders() const;
+    const std::vector<RenderComponent>& renders() const;
+
+    // Whether it has a movement or a physics body
+    bool moves(EntityIndex entity) const;
+    // Moves every entity with a movement to its referential plus the
+    // offset of the movement at timeSeconds, except the ones moved by the
+    // GPU, and steps the physics bodies up to timeSeconds. Then moves
+    // the children along with their parent. Returns the entities moved
+    const std::vector<EntityIndex>& moveEntities(
+        float timeSeconds, JobSystem& jobs);
+    // Puts the entity where its movement was at the last moveEntities().
+    // A physics body is thrown again from the referential instead
+    void applyMovement(EntityIndex entity);
+    // Moves the entity and its referential to pos, which is in world
+    // space even for children
+    void place(EntityIndex entity, const glm::vec3& pos);
+    // Moves the entity and its referential by offset, its physics body
+    // along with them
+    void displace(EntityIndex entity, const glm::vec3& offset);
+    // What the physics bodies bounce off
+    void setArena(const Aabb& arena);
+    // The time of the last moveEntities(), which is also what the GPU
+    // evaluates movements at
+    float movementTime() const;
+
+    // When enabled, the movements that movement.glsl knows about are
+    // evaluated by model.vert instead: the matrices of those entities
+    // stay at their referential and their transform isn't updated until
+    // catchUpGpuMovements()
+    void setGpuMovement(bool enabled);
+    bool gpuMovement() const;
+    bool gpuMoved(EntityIndex entity) const;
+    // Moves the entities moved by the GPU to where they were last
+    // rendered, for hit tests. Returns the entities moved
+    const std::vector<EntityIndex>& catchUpGpuMovements(JobSystem& jobs);
+    // Changes whenever the GPU movements have to be uploaded again
+    uint64_t gpuMovementVersion() const;
+    // Indexed by EntityIndex, with a kind of -1 for the entities that
+    // aren't moved by the GPU
+    void packGpuMovements(std::vector<GpuMovement>& movements) const;
+
+    const std::optional<Aabb>& spawnVolume(EntityIndex entity) const;
+    const std::string& name(EntityIndex entity) const;
+
+    // To call after changing the transform of the entity. Its matrices
+    // are only recomputed by the next updateMatrices()
+    void markMoved(EntityIndex entity);
+    // Recomputes the matrices of the entities that moved since the last
+    // call. Meant to be called right before rendering, so updates that
+    // happen more often than frames don't pay for matrices nobody reads
+    void updateMatrices(JobSystem& jobs);
+    ColliderPose colliderPose(EntityIndex entity) const;
+
+private:
+    void computeMatrices(EntityIndex entity);
+    // Moves the children whose parent moved, in one pass over
+    // m_hierarchy, and adds them to m_movementOwners. Drops the nodes
+    // of removed children on the way
+    void moveChildren();
+    // Takes the entity out of the children of its parent, and its node
+    // out of m_hierarchy
+    void detachFromParent(EntityIndex entity);
+
+    struct Slot {
+        EntityIndex entity;
+        uint32_t generation;
+    };
+
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_freeSlots;
+    // slot of each entity, to update it when the entity is moved
+    std::vector<uint32_t> m_entitySlots;
+
+    std::vector<TransformComponent> m_transforms;
+    std::vector<HealthComponent> m_healths;
+    // where the movement of each entity is in m_movementPools, if it
+    // has one
+    std::vector<std::optional<MovementSlot>> m_movements;
+    MovementPools m_movementPools;
+    float m_movementTime = 0.0f;
+    bool m_gpuMovement = false;
+    uint64_t m_gpuMovementVersion = 0;
+    // where the body of each entity is in m_physics, if it has one
+    std::vector<std::optional<uint32_t>> m_bodies;
+    PhysicsBodies m_physics;
+    struct HierarchyNode {
+        // NO_ENTITY once it was detached, until moveChildren() drops it
+        EntityIndex entity;
+        EntityIndex parent;
+        // of its referential, from the position of the parent
+        glm::vec3 localPos;
+    };
+    // Every entity that has a parent, parents before their children so
+    // the position of a parent is final by the time its children are
+    // placed. Entities keep the order they were added in, which is
+    // already that order since parents have to exist first
+    std::vector<HierarchyNode> m_hierarchy;
+    // where each entity is in m_hierarchy, if it has a parent
+    std::vector<std::optional<uint32_t>> m_hierarchyNodes;
+    // children of each entity as a list linked through the children, so
+    // removals only touch the entities involved. The GPU can't move
+    // entities that have some since it doesn't move them along
+    std::vector<EntityIndex> m_firstChildren;
+    std::vector<EntityIndex> m_nextSiblings;
+    std::vector<EntityIndex> m_previousSiblings;
+    // kept around so moving doesn't allocate
+    std::vector<glm::vec3> m_movementOffsets;
+    std::vector<EntityIndex> m_movementOwners;
+    std::vector<ColliderComponent> m_colliders;
+    std::vector<RenderComponent> m_renders;
+    std::vector<uint8_t> m_moved;
+    // Might hold indices that are out of range or not moved anymore
+    // after removals, updateMatrices() skips them
+    std::vector<EntityIndex> m_movedEntities;
+
+    // only read when respawning or debugging
+    std::vector<std::optional<Aabb>> m_spawnVolumes;
+    std::vector<std::string> m_names;
+};
\ No newline at end of file
@@ -0,0 +1,44 @@
+#include "FramePacer.hpp"
+
+#include <algorithm>
+
+// 100ms, waiting longer than this isn't expected but isn't an error either
+constexpr GLuint64 WAIT_TIMEOUT_NS = 100'000'000;
+
+FramePacer::~FramePacer()
+{
+    for (GLsync fence : m_fences) {
+        glDeleteSync(fence);
+    }
+}
+
+void FramePacer::waitForFrameSlot()
+{
+    while (m_fences.size() >= (size_t)m_maxFramesInFlight) {
+        GLsync fence = m_fences.front();
+        m_fences.pop_front();
+
+        GLenum status = GL_TIMEOUT_EXPIRED;
+        while (status == GL_TIMEOUT_EXPIRED) {
+            status = glClientWaitSync(
+                fence, GL_SYNC_FLUSH_COMMANDS_BIT, WAIT_TIMEOUT_NS);
+        }
+
+        glDeleteSync(fence);
+    }
+}
+
+void FramePacer::onFrameSubmitted()
+{
+    m_fences.push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+}
+
+void FramePacer::setMaxFramesInFlight(int frames)
+{
+    m_maxFramesInFlight = std::clamp(frames, 1, MAX_FRAMES_IN_FLIGHT_LIMIT);
+}
+
+int FramePacer::maxFramesInFlight() const
+{
+    return m_maxFramesInFlight;
+}
\ No newline at end of file
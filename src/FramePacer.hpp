@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <deque>
+
+// Can't be larger than CAMERA_UBO_SLOTS, otherwise the CPU could
+// overwrite camera data the GPU is still using
+constexpr int MAX_FRAMES_IN_FLIGHT_LIMIT = 3;
+
+// Keeps the CPU from getting more than a set number of frames ahead of
+// the GPU. With vsync off the driver happily queues several frames, and
+// every queued frame is input latency when the GPU is the bottleneck.
+// A fence is placed after each frame and, before input is sampled, we
+// wait on the one from maxFramesInFlight frames ago
+class FramePacer {
+public:
+    FramePacer() = default;
+    ~FramePacer();
+
+    FramePacer(const FramePacer& pacer) = delete;
+    FramePacer& operator=(const FramePacer& pacer) = delete;
+
+    // Blocks until there are less than maxFramesInFlight frames
+    // queued on the GPU
+    void waitForFrameSlot();
+    // Should be called after all the commands of the frame were issued
+    void onFrameSubmitted();
+
+    void setMaxFramesInFlight(int frames);
+    int maxFramesInFlight() const;
+
+private:
+    std::deque<GLsync> m_fences;
+    int m_maxFramesInFlight = 1;
+};
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "Framebuffer.hpp"
+
+#include <array>
+#include <cassert>
+
+Framebuffer::~Framebuffer()
+{
+    release();
+}
+
+void Framebuffer::resize(int width, int height)
+{
+    if (width == m_width && height == m_height
+        && (m_idRenderbuffer != 0) == m_idAttachment) {
+        return;
+    }
+
+    release();
+    m_width = width;
+    m_height = height;
+
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+
+    glGenTextures(1, &m_colorTexture);
+    glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA,
+        GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+        m_colorTexture, 0);
+
+    if (m_idAttachment) {
+        glGenRenderbuffers(1, &m_idRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_idRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_R32UI, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1,
+            GL_RENDERBUFFER, m_idRenderbuffer);
+
+        const std::array<GLenum, 2> drawBuffers
+            = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(drawBuffers.size(), drawBuffers.data());
+    }
+
+    glGenRenderbuffers(1, &m_depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbuffer);
+    glRenderbufferStorage(
+        GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+        GL_RENDERBUFFER, m_depthRenderbuffer);
+
+    assert(glCheckFramebufferStatus(GL_FRAMEBUFFER)
+        == GL_FRAMEBUFFER_COMPLETE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::setIdAttachment(bool enabled)
+{
+    m_idAttachment = enabled;
+}
+
+void Framebuffer::bind() const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glViewport(0, 0, m_width, m_height);
+}
+
+void Framebuffer::bindDefault()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::bindIdsForReading() const
+{
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+    glReadBuffer(GL_COLOR_ATTACHMENT1);
+}
+
+void Framebuffer::clearIds() const
+{
+    const std::array<GLuint, 4> zero = {};
+    glClearBufferuiv(GL_COLOR, 1, zero.data());
+}
+
+GLuint Framebuffer::colorTexture() const
+{
+    return m_colorTexture;
+}
+
+int Framebuffer::width() const
+{
+    return m_width;
+}
+
+int Framebuffer::height() const
+{
+    return m_height;
+}
+
+void Framebuffer::release()
+{
+    if (m_fbo == 0) {
+        return;
+    }
+
+    glDeleteFramebuffers(1, &m_fbo);
+    glDeleteTextures(1, &m_colorTexture);
+    glDeleteRenderbuffers(1, &m_idRenderbuffer);
+    glDeleteRenderbuffers(1, &m_depthRenderbuffer);
+    m_fbo = 0;
+    m_colorTexture = 0;
+    m_idRenderbuffer = 0;
+    m_depthRenderbuffer = 0;
+}
\ No newline at end of file
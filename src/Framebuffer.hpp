@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Offscreen render target with a color texture that can be sampled
+// afterwards and a depth buffer. Can also have a second, integer color
+// attachment for the id of what was drawn to each pixel
+class Framebuffer {
+public:
+    Framebuffer() = default;
+    ~Framebuffer();
+
+    Framebuffer(const Framebuffer& framebuffer) = delete;
+    Framebuffer& operator=(const Framebuffer& framebuffer) = delete;
+
+    // (Re)creates the attachments if the size changed
+    void resize(int width, int height);
+    // Takes effect on the next resize()
+    void setIdAttachment(bool enabled);
+
+    void bind() const;
+    static void bindDefault();
+    // For glReadPixels, ids are GL_RED_INTEGER / GL_UNSIGNED_INT
+    void bindIdsForReading() const;
+    // Sets every id to 0, glClear doesn't work on integer attachments
+    void clearIds() const;
+
+    GLuint colorTexture() const;
+    int width() const;
+    int height() const;
+
+private:
+    void release();
+
+    GLuint m_fbo = 0;
+    GLuint m_colorTexture = 0;
+    GLuint m_idRenderbuffer = 0;
+    GLuint m_depthRenderbuffer = 0;
+    bool m_idAttachment = false;
+    int m_width = 0;
+    int m_height = 0;
+};
\ No newline at end of file
@@ -20,23 +20,184 @@
 #include <nlohmann/json.hpp>
 #include <stb_image.h>
 
+#include <algorithm>
 #include <cmath>
+#include <ctime>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <stdexcept>
 #include <string>
 
 using json = nlohmann::json;
 
+static_assert(MAX_FRAMES_IN_FLIGHT_LIMIT <= CAMERA_UBO_SLOTS);
+
 // globals
+JobSystem* g_jobSystem;
 RNG* g_rng;
 ResourceManager* g_resourceManager;
 SoundPlayer* g_soundPlayer;
 
+namespace {
+
+// Throws on anything invalid, which skips the scenario file
+Movement parseMovement(const json& data)
+{
+    std::string type = data["type"];
+
+    if (caseInsensitiveEquals(type, "lissajous")) {
+        LissajousMovement movement;
+        movement.amplitude = readVec3FromJSONString(data["amplitude"]);
+        if (data.contains("frequency")) {
+            movement.frequency = readVec3FromJSONString(data["frequency"]);
+        }
+        if (data.contains("phase")) {
+            movement.phase = readVec3FromJSONString(data["phase"]);
+        }
+        return movement;
+    }
+
+    if (caseInsensitiveEquals(type, "circle")) {
+        CircleMovement movement;
+        movement.radius = data["radius"];
+        movement.speed = data["speed"];
+        if (data.contains("phase")) {
+            movement.phase = data["phase"];
+        }
+        if (data.contains("plane")) {
+            std::string plane = data["plane"];
+            if (caseInsensitiveEquals(plane, "xz")) {
+                movement.secondAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+            } else if (caseInsensitiveEquals(plane, "yz")) {
+                movement.firstAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+            } else if (!caseInsensitiveEquals(plane, "xy")) {
+                throw std::invalid_argument("unknown plane " + plane);
+            }
+        }
+        return movement;
+    }
+
+    if (caseInsensitiveEquals(type, "pingpong")) {
+        PingPongMovement movement;
+        movement.from = readVec3FromJSONString(data["from"]);
+        movement.to = readVec3FromJSONString(data["to"]);
+        movement.period = data["period"];
+        if (movement.period <= 0.0f) {
+            throw std::invalid_argument("period has to be positive");
+        }
+        return movement;
+    }
+
+    if (caseInsensitiveEquals(type, "path")) {
+        PathMovement movement;
+        if (data.contains("curve")
+            && caseInsensitiveEquals(data["curve"], "bezier")) {
+            movement.curve = PathMovement::Curve::Bezier;
+        }
+        std::vector<glm::vec3> points;
+        for (const auto& point : data["points"]) {
+            points.push_back(readVec3FromJSONString(point));
+        }
+        movement.points
+            = std::make_shared<const std::vector<glm::vec3>>(std::move(points));
+        movement.duration = data["duration"];
+        if (data.contains("loop")) {
+            movement.loop = data["loop"];
+        }
+
+        // Bezier curves need at least one full segment
+        size_t minPoints = movement.curve == PathMovement::Curve::Bezier
+            ? (movement.loop ? 3 : 4)
+            : 2;
+        if (movement.points->size() < minPoints
+            || movement.duration <= 0.0f) {
+            throw std::invalid_argument("path too short");
+        }
+        return movement;
+    }
+
+    if (caseInsensitiveEquals(type, "randomwalk")) {
+        RandomWalkMovement movement;
+        movement.radius = readVec3FromJSONString(data["radius"]);
+        movement.speed = data["speed"];
+        if (data.contains("seed")) {
+            movement.seed = data["seed"];
+        }
+        return movement;
+    }
+
+    throw std::invalid_argument("unknown movement type " + type);
+}
+
+PhysicsBody parsePhysics(const json& data)
+{
+    PhysicsBody body;
+    if (data.contains("velocity")) {
+        body.velocity = readVec3FromJSONString(data["velocity"]);
+    }
+    if (data.contains("gravity")) {
+        body.gravity = readVec3FromJSONString(data["gravity"]);
+    }
+    if (data.contains("restitution")) {
+        body.restitution = data["restitution"];
+    }
+    if (body.restitution < 0.0f || body.restitution > 1.0f) {
+        throw std::invalid_argument("restitution has to be in [0, 1]");
+    }
+    return body;
+}
+
+// Resolves everything the target refers to. Random spawn targets start in
+// the middle of their volume, spawning moves them to a free spot anyway.
+// They have no name, nothing reads it and it would be copied on every spawn
+Entity compileTargetPrefab(const Target& target)
+{
+    const Model* model;
+    ColliderShape colliderShape;
+    if (target.shape == Target::Shape::Box) {
+        model = &g_resourceManager->getModel("cube");
+        colliderShape = ColliderShape::Box;
+    } else {
+        model = &g_resourceManager->getModel("ball");
+        colliderShape = ColliderShape::Sphere;
+    }
+    if (!target.modelPath.empty()) {
+        model = &g_resourceManager->getModel(target.modelPath);
+    }
+    if (target.meshHitbox) {
+        colliderShape = ColliderShape::Mesh;
+    }
+
+    glm::vec3 pos = target.randomSpawn
+        ? (target.minCoords + target.maxCoords) * 0.5f
+        : target.spawnCoords;
+
+    Entity entity(*model, g_resourceManager->getMaterial("targets"),
+        g_resourceManager->getShader("targets"), pos);
+    entity.setColliderShape(colliderShape);
+    entity.setSize(target.scale);
+    entity.destroyable = true;
+    entity.type = target.type;
+    entity.setStartingHealth(target.health);
+    if (target.randomSpawn) {
+        entity.setSpawnVolume({ target.minCoords, target.maxCoords });
+    }
+    if (target.physics.has_value()) {
+        entity.setPhysics(target.physics.value());
+    } else if (target.movement.has_value()) {
+        entity.setMovement(target.movement.value());
+    }
+    return entity;
+}
+
+}
+
 Game::Game()
     : m_window(SCR_WIDTH, SCR_HEIGHT, "OpenAim", FULLSCREEN)
     , m_camera({ 0.0f, 1.5f, 8.0f }, { 0.0, 1.0, 0.0 }, -90.0, 0.0)
+    , m_aimAtLastUpdate(m_camera)
     , m_inputManager(m_window)
     , m_nuklear(m_window.ptr())
     , m_lastX((float)m_window.width / 2)
@@ -67,7 +228,9 @@ Game::Game()
         "./resources/shaders/healthbar.vert",
         "./resources/shaders/healthbar.frag");
 
-    m_resourceManager.addCubemap("skybox",
+    // the files are decoded in parallel, nothing is there until
+    // loadQueued() though
+    m_resourceManager.queueCubemap("skybox",
         { "./resources/textures/skybox/right.bmp",
             "./resources/textures/skybox/left.bmp",
             "./resources/textures/skybox/top.bmp",
@@ -75,13 +238,29 @@ Game::Game()
             "./resources/textures/skybox/front.bmp",
             "./resources/textures/skybox/back.bmp" });
 
-    m_resourceManager.addTexture(
+    m_resourceManager.queueTexture(
         "bricks", "./resources/textures/bricks.png", Texture::Type::Diffuse);
-    m_resourceManager.addTexture("crosshair",
+    m_resourceManager.queueTexture("crosshair",
         "./resources/textures/crosshair.png", Texture::Type::Diffuse);
-    m_resourceManager.addTexture("white_pixel",
+    m_resourceManager.queueTexture("white_pixel",
         "./resources/textures/white_pixel.png", Texture::Type::Diffuse);
 
+    m_resourceManager.queueModel("cube", "./resources/objects/cube/cube.obj");
+    m_resourceManager.queueModel("ball", "./resources/objects/ball/ball.obj");
+    m_resourceManager.queueModel(
+        "plane", "./resources/objects/plane/plane.obj");
+
+    // weapons refer to sounds by file name
+    for (const auto& entry :
+        std::filesystem::directory_iterator("./resources/sounds")) {
+        if (entry.path().extension() == ".ogg") {
+            m_resourceManager.queueSound(
+                entry.path().stem().string(), entry.path().string());
+        }
+    }
+
+    m_resourceManager.loadQueued(m_jobSystem);
+
     m_resourceManager.addMaterial("targets");
     m_resourceManager.getMaterial("targets")
         .addTexture(m_resourceManager.getTexture("white_pixel"))
@@ -101,15 +280,8 @@ Game::Game()
     m_resourceManager.getMaterial("healthbar")
         .addTexture(m_resourceManager.getTexture("white_pixel"));
 
-    m_resourceManager.addModel("cube", "./resources/objects/cube/cube.obj");
-    m_resourceManager.addModel("ball", "./resources/objects/ball/ball.obj");
-    m_resourceManager.addModel("plane", "./resources/objects/plane/plane.obj");
-
-    m_resourceManager.addSound("pistol", "./resources/sounds/pistol.ogg");
-    m_resourceManager.addSound(
-        "machine_gun", "./resources/sounds/machine_gun.ogg");
-
     // set/create globals
+    g_jobSystem = &m_jobSystem;
     g_rng = &m_rng;
     g_resourceManager = &m_resourceManager;
     m_soundPlayer = std::make_unique<SoundPlayer>();
@@ -130,7 +302,17 @@ Game::Game()
         g_resourceManager->getShader("skybox"));
 
     buildPlayArea();
+    parseWeaponsFromFile("./resources/weapons");
     parseScenariosFromFile("./resources/scenarios");
+
+    // enough for the play area and any scenario, so switching between
+    // them doesn't grow anything
+    size_t maxTargets = 0;
+    for (const auto& scenario : m_scenarios) {
+        maxTargets = std::max(maxTargets, scenario.prefabs.size());
+    }
+    m_entityManager.reserve(m_entityManager.entities().size() + maxTargets);
+    m_targetHandles.reserve(maxTargets);
 }
 
 void Game::mainLoop()
@@ -142,11 +324,25 @@ void Game::mainLoop()
         render();
         mainLoopEnd();
     }
+
+    if (m_latencyTracker.frameToFrame().count() > 0) {
+        std::time_t now = std::time(nullptr);
+        std::array<char, 32> timestamp;
+        std::strftime(timestamp.data(), timestamp.size(), "%Y%m%d_%H%M%S",
+            std::localtime(&now));
+        m_latencyTracker.writeReport(
+            std::string("latency_report_") + timestamp.data() + ".txt");
+    }
 }
 
 void Game::mainLoopBegin()
 {
-    m_timeNow = (float)glfwGetTime();
+    // input is sampled right after this, so it's as recent as possible
+    // by the time the GPU can actually take a new frame
+    m_framePacer.waitForFrameSlot();
+    InputManager::pollEvents();
+
+    m_timeNow = glfwGetTime();
     m_deltaTime = m_timeNow - m_lastUpdate;
 
     if (m_state != Game::State::Running) {
@@ -157,7 +353,7 @@ void Game::mainLoopBegin()
     if (!m_challengeState.happening) {
         return;
     }
-    m_challengeState.timeRemainingSeconds -= m_deltaTime;
+    m_challengeState.timeRemainingSeconds -= (float)m_deltaTime;
 
     if ((m_currentScenario
             && m_currentScenario->winCondition
@@ -172,6 +368,8 @@ void Game::mainLoopBegin()
 
 void Game::processInput()
 {
+    m_inputManager.sampleInput();
+
     // high priority keys
     if (m_inputManager.isKeyToggled(GLFW_KEY_F1)) {
         glfwSetWindowShouldClose(m_window.ptr(), true);
@@ -191,6 +389,14 @@ void Game::processInput()
         return;
     }
 
+    // tagging the frame that first sees the click
+    if (m_inputManager.isMouseButtonToggled(GLFW_MOUSE_BUTTON_LEFT)) {
+        m_latencyTracker.onClickConsumed(
+            m_inputManager.getMouseButtonPressTime(GLFW_MOUSE_BUTTON_LEFT));
+    }
+
+    m_aimAtLastUpdate = m_camera;
+
     // mouse input
     if (m_inputManager.didCursorMove()) {
         auto [xpos, ypos] = m_inputManager.getCursorPos();
@@ -216,16 +422,18 @@ void Game::processInput()
     // camera keyboard processing
     // uncomment this to allow flying around
     if (m_inputManager.isKeyPressed(GLFW_KEY_W)) {
-        m_camera.processKeyboard(CameraMovement::FORWARD, m_deltaTime);
+        m_camera.processKeyboard(
+            CameraMovement::FORWARD, (float)m_deltaTime);
     }
     if (m_inputManager.isKeyPressed(GLFW_KEY_S)) {
-        m_camera.processKeyboard(CameraMovement::BACKWARD, m_deltaTime);
+        m_camera.processKeyboard(
+            CameraMovement::BACKWARD, (float)m_deltaTime);
     }
     if (m_inputManager.isKeyPressed(GLFW_KEY_A)) {
-        m_camera.processKeyboard(CameraMovement::LEFT, m_deltaTime);
+        m_camera.processKeyboard(CameraMovement::LEFT, (float)m_deltaTime);
     }
     if (m_inputManager.isKeyPressed(GLFW_KEY_D)) {
-        m_camera.processKeyboard(CameraMovement::RIGHT, m_deltaTime);
+        m_camera.processKeyboard(CameraMovement::RIGHT, (float)m_deltaTime);
     }
 }
 
@@ -235,30 +443,123 @@ void Game::updateEntities()
         return;
     }
 
+    resolvePicks();
     updateShotEntities();
-    m_entityManager.updateEntities(m_totalTimeSeconds);
+    m_entityManager.updateEntities((float)m_totalTimeSeconds);
 }
 
 void Game::updateShotEntities()
 {
-    if (!m_inputManager.isMouseButtonPressed(GLFW_MOUSE_BUTTON_LEFT)) {
-        return;
+    std::optional<double> pressTimeMs;
+    if (m_inputManager.isMouseButtonToggled(GLFW_MOUSE_BUTTON_LEFT)) {
+        pressTimeMs = 1000.0
+            * m_inputManager.getMouseButtonPressTime(GLFW_MOUSE_BUTTON_LEFT);
     }
-
-    bool isHoldingMouseButton
-        = !m_inputManager.isMouseButtonToggled(GLFW_MOUSE_BUTTON_LEFT);
-    if (!m_weapon.tryShoot(glfwGetTime() * 1000, isHoldingMouseButton)) {
-        return;
+    m_weapon.dueShots(m_lastUpdate * 1000.0, m_timeNow * 1000.0,
+        m_inputManager.isMouseButtonPressed(GLFW_MOUSE_BUTTON_LEFT),
+        pressTimeMs, m_shotTimesMs);
+
+    // The id buffer only exists for the frame about to be rendered, so
+    // the modes reading it resolve every shot at frame time, colliders
+    // included so the cross check compares the same state
+    bool atShotTime = m_hitTestMode == HitTestMode::Colliders;
+
+    double updateSeconds = m_timeNow - m_lastUpdate;
+    for (double shotMs : m_shotTimesMs) {
+        // how far into this update the shot was due
+        double secondsAgo = atShotTime ? m_timeNow - shotMs / 1000.0 : 0.0;
+        auto progress = updateSeconds > 0.0
+            ? (float)(1.0 - secondsAgo / updateSeconds)
+            : 1.0f;
+
+        // the targets and the aim as they were at that time, so shots
+        // land the same whatever the frame rate is
+        m_entityManager.advanceTo((float)(m_totalTimeSeconds - secondsAgo));
+        m_weapon.fire(shotMs);
+        fireShot(Camera::interpolate(m_aimAtLastUpdate, m_camera,
+            std::clamp(progress, 0.0f, 1.0f)));
+
+        // kicks the rest of the update's aim too
+        glm::vec2 recoil = m_weapon.recoil();
+        m_camera.rotate(recoil.x, recoil.y);
+        m_aimAtLastUpdate.rotate(recoil.x, recoil.y);
     }
+}
 
-    if (m_entityManager.updateShotEntities(
-            m_camera.position, m_camera.front())) {
+void Game::fireShot(const Camera& aim)
+{
+    m_weapon.pelletDirections(
+        aim.front(), aim.right(), aim.up(), m_pelletDirections);
+    auto shot = (uint32_t)m_totalShots;
+
+    // a shot counts as a hit for accuracy if any of its pellets hit
+    if (m_hitTestMode != HitTestMode::IdBuffer
+        && m_entityManager.updateShotEntities(
+               aim.position, m_pelletDirections)
+            > 0) {
         m_shotsHit++;
     }
 
+    if (m_hitTestMode != HitTestMode::Colliders) {
+        for (size_t i = 0; i < m_pelletDirections.size(); i++) {
+            ColliderHandle expected = INVALID_COLLIDER;
+            if (m_hitTestMode == HitTestMode::CrossCheck) {
+                const auto& hit = m_entityManager.lastShotHits()[i];
+                expected = hit.has_value() ? hit->collider : INVALID_COLLIDER;
+            }
+
+            uint32_t tag = m_nextPickTag++;
+            m_pendingPicks[tag] = { shot, expected };
+            m_shotPicksLeft[shot]++;
+            m_renderer.requestPick(tag, m_pelletDirections[i]);
+        }
+    }
+
     m_totalShots++;
 }
 
+void Game::resolvePicks()
+{
+    m_pickResults.clear();
+    m_renderer.pollPicks(m_pickResults);
+
+    for (const auto& result : m_pickResults) {
+        auto it = m_pendingPicks.find(result.tag);
+        // from before a reset
+        if (it == m_pendingPicks.end()) {
+            continue;
+        }
+        PendingPick pick = it->second;
+        m_pendingPicks.erase(it);
+
+        if (m_hitTestMode == HitTestMode::CrossCheck) {
+            // ids are the collider handle + 1, which wraps to 0 for no hit
+            uint32_t expectedId = pick.expected + 1;
+            m_pickChecks++;
+            if (result.id != expectedId) {
+                // the counts are on screen, only the first one is logged
+                // and the rest summed up on reset
+                if (m_pickMismatches == 0) {
+                    std::cerr << "Hit test mismatch: colliders hit "
+                              << expectedId << ", id buffer " << result.id
+                              << "\n";
+                }
+                m_pickMismatches++;
+            }
+        } else if (m_hitTestMode == HitTestMode::IdBuffer
+            && m_entityManager.applyPickedHit(result.id)
+            && m_pickedShotHits.insert(pick.shot).second) {
+            m_shotsHit++;
+        }
+
+        auto left = m_shotPicksLeft.find(pick.shot);
+        if (--left->second == 0) {
+            m_shotPicksLeft.erase(left);
+            m_pickedShotHits.erase(pick.shot);
+        }
+    }
+}
+
 void Game::render()
 {
     glClearColor(0.3, 0.3, 0.3, 1.0);
@@ -267,15 +568,28 @@ void Game::render()
     Scene scene(m_camera, m_window.width, m_window.height);
     scene.globalLightSource = m_globalLightSource;
     scene.skybox = *m_skybox;
+    m_entityManager.updateMatrices();
     scene.entities = m_entityManager.entities();
     scene.sprites = m_sprites;
+    if (m_lateLatch) {
+        scene.latchCamera = [this]() { return latchCamera(); };
+    }
 
     m_renderer.renderScene(scene);
 
     // this signals the beggining of the nuklear rendering when created
     // and the end when destructed (by going out of scope)
     NuklearRenderScope scope;
+    renderUI();
 
+    // done after building the UI to have the latest mouse movement
+    // possible, the UI itself is drawn on top when scope is destructed
+    m_renderer.composite(
+        scene, m_renderer.lateWarp() ? latchCamera() : m_camera);
+}
+
+void Game::renderUI()
+{
     if (m_state == Game::State::Menu) {
         std::optional<MenuData> menuData
             = m_nuklear.renderMainMenu(m_scenarios);
@@ -297,10 +611,18 @@ void Game::render()
     } else if (m_challengeState.happening) {
         m_nuklear.renderChallengeData(m_shotsHit, m_totalShots,
             m_challengeState.timeRemainingSeconds,
-            1 / (m_timeNow - m_lastFrame));
+            (float)(1 / (m_timeNow - m_lastFrame)));
     } else {
-        m_nuklear.renderStats(m_shotsHit, m_totalShots, m_totalTimeSeconds,
-            1 / (m_timeNow - m_lastFrame));
+        m_nuklear.renderStats(m_shotsHit, m_totalShots,
+            (float)m_totalTimeSeconds, (float)(1 / (m_timeNow - m_lastFrame)));
+    }
+
+    if (m_showLatencyOverlay) {
+        m_nuklear.renderLatencyOverlay(m_latencyTracker);
+    }
+
+    if (m_hitTestMode == HitTestMode::CrossCheck) {
+        m_nuklear.renderHitTestCheck(m_pickChecks, m_pickMismatches);
     }
 
     if (m_state == Game::State::Paused) {
@@ -310,6 +632,31 @@ void Game::render()
             if (settings->sensitivity.has_value()) {
                 m_camera.setMouseSensitivity(settings->sensitivity.value());
             }
+            m_lateLatch = settings->lateLatch;
+            m_renderer.setLateWarp(settings->lateWarp);
+            m_showLatencyOverlay = settings->latencyOverlay;
+            m_entityManager.setGpuMovement(settings->gpuMovement);
+            m_hitTestMode = settings->hitTestMode;
+            m_renderer.setIdBuffer(
+                m_hitTestMode != HitTestMode::Colliders);
+            if (settings->maxFramesInFlight.has_value()) {
+                m_framePacer.setMaxFramesInFlight(
+                    (int)settings->maxFramesInFlight.value());
+            }
+            if (settings->workerThreads.has_value()) {
+                auto threads
+                    = (unsigned)std::max(settings->workerThreads.value(), 0.0f);
+                // restarting the workers isn't free, and the settings get
+                // applied whether they changed or not
+                if (JobSystem::resolveThreadCount(threads)
+                    != m_jobSystem.threadCount()) {
+                    m_jobSystem.setThreadCount(threads);
+                }
+            }
+            if (settings->frameTimeBudget.has_value()) {
+                m_renderer.setFrameTimeBudget(
+                    settings->frameTimeBudget.value());
+            }
             if (settings->maxFps.has_value()) {
                 float fps = settings->maxFps.value();
                 if (fps == 0) {
@@ -334,15 +681,31 @@ void Game::render()
     }
 }
 
-void Game::mainLoopEnd()
+Camera Game::latchCamera()
 {
-    m_inputManager.consolidateKeyStates();
-    glfwPollEvents();
+    Camera camera = m_camera;
+    if (m_state != Game::State::Running || m_ignoreCursorMovement) {
+        return camera;
+    }
 
+    // events polled here are only sampled by the game next frame, so the
+    // same movement will be applied to m_camera then
+    InputManager::pollEvents();
+    auto [xpos, ypos] = m_inputManager.getLatestCursorPos();
+    camera.processMouseMovement(xpos - m_lastX, m_lastY - ypos);
+
+    return camera;
+}
+
+void Game::mainLoopEnd()
+{
     if (!m_fpsCapped || m_timeNow - m_lastFrame >= 1 / m_fpsLimit) {
         glfwSwapBuffers(m_window.ptr());
+        m_latencyTracker.onFramePresented(glfwGetTime());
         m_lastFrame = m_timeNow;
     }
+    m_framePacer.onFrameSubmitted();
+    m_latencyTracker.poll();
 
     m_lastUpdate = m_timeNow;
     m_prevState = m_state;
@@ -377,7 +740,7 @@ void Game::buildPlayArea()
     Entity floor(g_resourceManager->getModel("plane"),
         m_resourceManager.getMaterial("bricks"),
         m_resourceManager.getShader("textured"), glm::vec3(0));
-    floor.addCollisionObject(CollisionObject::Type::AABB);
+    floor.setColliderShape(ColliderShape::Box);
     floor.setSize(glm::vec3(20.0f, 0.0f, 20.0f));
     floor.setName("Floor");
     m_entityManager.addEntity(std::move(floor));
@@ -386,7 +749,7 @@ void Game::buildPlayArea()
         m_resourceManager.getMaterial("bricks"),
         m_resourceManager.getShader("textured"),
         glm::vec3(0.0f, 10.0f, -10.0f));
-    frontWall.addCollisionObject(CollisionObject::Type::AABB);
+    frontWall.setColliderShape(ColliderShape::Box);
     frontWall.setRotation(90, 0, 0);
     frontWall.setSize(glm::vec3(20.0f, 0.0f, 20.0f));
     frontWall.setName("Front Wall");
@@ -396,7 +759,7 @@ void Game::buildPlayArea()
         m_resourceManager.getMaterial("bricks"),
         m_resourceManager.getShader("textured"),
         glm::vec3(-10.0f, 10.0f, 0.0f));
-    leftWall.addCollisionObject(CollisionObject::Type::AABB);
+    leftWall.setColliderShape(ColliderShape::Box);
     leftWall.setRotation(90, 90, 0);
     leftWall.setSize(glm::vec3(20.0f, 0.0f, 20.0f));
     leftWall.setName("Left Wall");
@@ -405,7 +768,7 @@ void Game::buildPlayArea()
     Entity rightWall(g_resourceManager->getModel("plane"),
         m_resourceManager.getMaterial("bricks"),
         m_resourceManager.getShader("textured"), glm::vec3(10.0f, 10.0f, 0.0f));
-    rightWall.addCollisionObject(CollisionObject::Type::AABB);
+    rightWall.setColliderShape(ColliderShape::Box);
     rightWall.setRotation(90, -90, 0);
     rightWall.setSize(glm::vec3(20.0f, 0.0f, 20.0f));
     rightWall.setName("Right Wall");
@@ -414,7 +777,7 @@ void Game::buildPlayArea()
     Entity ceiling(g_resourceManager->getModel("plane"),
         m_resourceManager.getMaterial("bricks"),
         m_resourceManager.getShader("textured"), glm::vec3(0.0f, 20.0f, 0.0f));
-    ceiling.addCollisionObject(CollisionObject::Type::AABB);
+    ceiling.setColliderShape(ColliderShape::Box);
     ceiling.setRotation(180, 0, 0);
     ceiling.setSize(glm::vec3(20.0f, 0.0f, 20.0f));
     ceiling.setName("Ceiling");
@@ -423,23 +786,95 @@ void Game::buildPlayArea()
     Entity backWall(g_resourceManager->getModel("plane"),
         m_resourceManager.getMaterial("bricks"),
         m_resourceManager.getShader("textured"), glm::vec3(0.0f, 10.0f, 10.0f));
-    backWall.addCollisionObject(CollisionObject::Type::AABB);
+    backWall.setColliderShape(ColliderShape::Box);
     backWall.setRotation(90, 180, 0);
     backWall.setSize(glm::vec3(20.0f, 0.0f, 20.0f));
     backWall.setName("Back Wall");
     m_entityManager.addEntity(std::move(backWall));
+
+    // inside of the walls above
+    m_entityManager.setArena(
+        { glm::vec3(-10.0f, 0.0f, -10.0f), glm::vec3(10.0f, 20.0f, 10.0f) });
 }
 
 void Game::reset()
 {
     m_shotsHit = 0;
     m_totalShots = 0;
+    m_pendingPicks.clear();
+    m_shotPicksLeft.clear();
+    m_pickedShotHits.clear();
+    if (m_pickMismatches > 0) {
+        std::cerr << "Hit test mismatches: " << m_pickMismatches << " of "
+                  << m_pickChecks << " pellets\n";
+    }
+    m_pickChecks = 0;
+    m_pickMismatches = 0;
     m_totalTimeSeconds = 0;
     m_challengeState = {};
     m_currentScenario = nullptr;
     m_entityManager.removeAllTargets();
 }
 
+void Game::parseWeaponsFromFile(const std::string& weaponFolder)
+{
+    for (const auto& entry :
+        std::filesystem::directory_iterator(weaponFolder)) {
+        if (entry.path().extension() != ".json") {
+            continue;
+        }
+
+        try {
+            std::ifstream f(entry.path());
+            json data = json::parse(f);
+
+            WeaponDefinition weapon;
+
+            weapon.name = entry.path().stem().string();
+
+            weapon.shotDelayMs = data["shotDelayMs"];
+            // automatic weapons would fire every shot they can at once
+            if (weapon.shotDelayMs <= 0.0f) {
+                throw std::invalid_argument("shotDelayMs has to be positive");
+            }
+            weapon.sound = data["sound"];
+
+            if (data.contains("automatic")) {
+                weapon.automatic = data["automatic"];
+            }
+
+            if (data.contains("soundMode")
+                && caseInsensitiveEquals(data["soundMode"], "continuous")) {
+                weapon.soundMode = WeaponDefinition::SoundMode::Continuous;
+            }
+
+            if (data.contains("pellets")) {
+                weapon.pellets = std::max((int)data["pellets"], 1);
+            }
+
+            if (data.contains("spread")) {
+                weapon.spreadDegrees = data["spread"];
+            }
+
+            if (data.contains("recoil")) {
+                for (const auto& kick : data["recoil"]) {
+                    weapon.recoilPattern.emplace_back(
+                        readVec3FromJSONString(kick));
+                }
+            }
+
+            if (data.contains("recoilResetMs")) {
+                weapon.recoilResetMs = data["recoilResetMs"];
+            }
+
+            m_weapons[weapon.name] = std::move(weapon);
+        } catch (...) {
+            // probably some JSON format error
+            // just skips the file
+        }
+    }
+}
+
 void Game::parseScenariosFromFile(const std::string& scenarioFolder)
 {
     for (const auto& entry :
@@ -457,13 +892,15 @@ void Game::parseScenariosFromFile(const std::string& scenarioFolder)
             std::string filename = entry.path().filename().string();
             scenario.name = filename.substr(0, filename.find('.'));
 
-            std::string weaponType = data["weapon"];
-
-            if (caseInsensitiveEquals(weaponType, "pistol")) {
-                scenario.weaponType = Weapon::Type::Pistol;
-            } else if (caseInsensitiveEquals(weaponType, "machine_gun")) {
-                scenario.weaponType = Weapon::Type::Machine_Gun;
+            std::string weapon = data["weapon"];
+            auto weaponIt = std::find_if(m_weapons.begin(), m_weapons.end(),
+                [&weapon](const auto& entry) {
+                    return caseInsensitiveEquals(entry.first, weapon);
+                });
+            if (weaponIt == m_weapons.end()) {
+                continue;
             }
+            scenario.weapon = weaponIt->first;
 
             scenario.playerPos = readVec3FromJSONString(data["playerPos"]);
 
@@ -488,6 +925,18 @@ void Game::parseScenariosFromFile(const std::string& scenarioFolder)
                     newTarget.shape = Target::Shape::Ball;
                 }
 
+                if (target.contains("model")) {
+                    newTarget.modelPath = target["model"];
+                    // throws if it can't be loaded, which skips the file
+                    if (!m_resourceManager.hasModel(newTarget.modelPath)) {
+                        m_resourceManager.addModel(
+                            newTarget.modelPath, newTarget.modelPath);
+                    }
+                }
+
+                newTarget.meshHitbox = target.contains("hitbox")
+                    && caseInsensitiveEquals(target["hitbox"], "mesh");
+
                 newTarget.randomSpawn
                     = target.contains("randomSpawn") && target["randomSpawn"];
                 if (newTarget.randomSpawn) {
@@ -508,22 +957,43 @@ void Game::parseScenariosFromFile(const std::string& scenarioFolder)
                     newTarget.type = Entity::Type::GONER;
                 }
 
-                if (target.contains("moves")) {
-                    newTarget.moves = target["moves"];
-                    if (newTarget.moves) {
-                        newTarget.movementAmplitude
-                            = target["movementAmplitude"];
-                        newTarget.movementSpeed = target["movementSpeed"];
-                    }
+                if (target.contains("movement")) {
+                    newTarget.movement = parseMovement(target["movement"]);
+                } else if (target.contains("moves") && target["moves"]) {
+                    // from before "movement", a horizontal oscillation
+                    float amplitude = target["movementAmplitude"];
+                    float speed = target["movementSpeed"];
+                    LissajousMovement movement;
+                    movement.amplitude = glm::vec3(amplitude, 0.0f, 0.0f);
+                    movement.frequency = glm::vec3(speed);
+                    newTarget.movement = movement;
+                }
+
+                if (target.contains("physics")) {
+                    newTarget.physics = parsePhysics(target["physics"]);
                 }
 
                 if (target.contains("health")) {
                     newTarget.health = target["health"];
                 }
 
+                if (target.contains("parent")) {
+                    size_t parent = target["parent"];
+                    if (parent >= scenario.targets.size()) {
+                        throw std::invalid_argument(
+                            "parent has to be an earlier target");
+                    }
+                    newTarget.parent = parent;
+                }
+
                 scenario.targets.push_back(newTarget);
             }
 
+            scenario.prefabs.reserve(scenario.targets.size());
+            for (const auto& target : scenario.targets) {
+                scenario.prefabs.push_back(compileTargetPrefab(target));
+            }
+
             m_scenarios.push_back(std::move(scenario));
         } catch (...) {
             // probably some JSON format error
@@ -536,53 +1006,24 @@ void Game::createScenario(size_t index)
 {
     m_currentScenario = &m_scenarios[index];
 
-    m_weapon.type = m_currentScenario->weaponType;
+    m_weapon.setDefinition(m_weapons.at(m_currentScenario->weapon));
     m_camera.position = m_currentScenario->playerPos;
     m_camera.lookForward();
 
-    for (size_t i = 0; i < m_currentScenario->targets.size(); i++) {
-        const auto& target = m_currentScenario->targets[i];
-
-        glm::vec3 spawnPoint;
-        if (target.randomSpawn) {
-            spawnPoint = glm::vec3(
-                g_rng->getFloatInRange(target.minCoords.x, target.maxCoords.x),
-                g_rng->getFloatInRange(target.minCoords.y, target.maxCoords.y),
-                g_rng->getFloatInRange(target.minCoords.z, target.maxCoords.z));
-        } else {
-            spawnPoint = target.spawnCoords;
-        }
-
-        const Model* model;
-        CollisionObject::Type collisionObjType;
-        if (target.shape == Target::Shape::Box) {
-            model = &g_resourceManager->getModel("cube");
-            collisionObjType = CollisionObject::Type::AABB;
-        } else {
-            model = &g_resourceManager->getModel("ball");
-            collisionObjType = CollisionObject::Type::SPHERE;
-        }
-
-        Entity entity(*model, m_resourceManager.getMaterial("targets"),
-            m_resourceManager.getShader("targets"), spawnPoint);
-        entity.addCollisionObject(collisionObjType);
-        entity.setSize(target.scale);
-        entity.destroyable = true;
-        entity.type = target.type;
-        entity.setName("Ball " + std::to_string(i));
-        entity.setStartingHealth(target.health);
-        if (target.moves) {
-            float amplitude = target.movementAmplitude;
-            float speed = target.movementSpeed;
-            entity.setMovementPattern(
-                [amplitude, speed](float timePassedSeconds) {
-                    return glm::vec3(
-                        amplitude * std::cos(speed * timePassedSeconds), 0.0f,
-                        0.0f);
-                });
-        }
-        m_entityManager.addEntity(std::move(entity));
+    // no lookups or allocations here, the storage was reserved for the
+    // biggest scenario
+    m_targetHandles.clear();
+    for (size_t i = 0; i < m_currentScenario->prefabs.size(); i++) {
+        const std::optional<size_t>& parent
+            = m_currentScenario->targets[i].parent;
+        m_targetHandles.push_back(
+            m_entityManager.addEntity(m_currentScenario->prefabs[i],
+                parent.has_value() ? m_targetHandles[parent.value()]
+                                   : EntityHandle {}));
     }
+
+    m_entityManager.prepareSpawning();
+    m_entityManager.rebuildBvh();
 }
 
 void messageCallback(GLenum /*unused*/, GLenum type, GLuint /*unused*/,
@@ -2,7 +2,10 @@
 
 #include "Camera.hpp"
 #include "EntityManager.hpp"
+#include "FramePacer.hpp"
 #include "InputManager.hpp"
+#include "JobSystem.hpp"
+#include "LatencyTracker.hpp"
 #include "NuklearWrapper.hpp"
 #include "RNG.hpp"
 #include "Renderer.hpp"
@@ -13,6 +16,11 @@
 #include "Weapon.hpp"
 #include "Window.hpp"
 
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
 // settings
 constexpr auto SCR_WIDTH = 1920;
 constexpr auto SCR_HEIGHT = 1080;
@@ -42,33 +50,59 @@ private:
     void mainLoopBegin();
     void processInput();
     void updateEntities();
+    // Fires every shot due since the last update, each one at the time
+    // it was due
     void updateShotEntities();
+    void fireShot(const Camera& aim);
+    // Applies (or checks, depending on the hit test mode) the ids read
+    // back for earlier shots
+    void resolvePicks();
     void render();
+    void renderUI();
     void mainLoopEnd();
 
+    // Returns m_camera with the mouse movement that happened since input
+    // was sampled applied. Doesn't change the simulation state
+    Camera latchCamera();
+
     void togglePaused();
     void changeState(State newState);
 
     void buildPlayArea();
     void reset();
 
+    void parseWeaponsFromFile(const std::string& weaponFolder);
     void parseScenariosFromFile(const std::string& scenarioFolder);
     void createScenario(size_t index);
 
     Window m_window;
     Camera m_camera;
+    // m_camera before this update's mouse movement, shots fired during
+    // the update aim in between
+    Camera m_aimAtLastUpdate;
     EntityManager m_entityManager;
     std::vector<Sprite> m_sprites;
     Renderer m_renderer;
+    FramePacer m_framePacer;
     InputManager m_inputManager;
     LightSource m_globalLightSource;
     std::unique_ptr<Skybox> m_skybox;
     Weapon m_weapon;
+    // by name, which is the name of their file
+    std::map<std::string, WeaponDefinition> m_weapons;
+    std::vector<glm::vec3> m_pelletDirections;
+    // kept around so shooting doesn't allocate
+    std::vector<double> m_shotTimesMs;
     NuklearWrapper m_nuklear;
+    LatencyTracker m_latencyTracker;
+    bool m_showLatencyOverlay = false;
     std::vector<Scenario> m_scenarios;
     Scenario* m_currentScenario = nullptr;
+    // of the targets of the current scenario, for their children
+    std::vector<EntityHandle> m_targetHandles;
 
     // globals
+    JobSystem m_jobSystem;
     RNG m_rng;
     ResourceManager m_resourceManager;
     std::unique_ptr<SoundPlayer> m_soundPlayer;
@@ -79,15 +113,20 @@ private:
     bool m_ignoreCursorMovement = true;
     float m_lastX;
     float m_lastY;
+    // Whether the view matrix used for rendering gets the latest mouse
+    // movement right before the entities are drawn
+    bool m_lateLatch = true;
 
     // timing
     // Time elapsed since the app started running
     // without considering time spent paused
-    float m_totalTimeSeconds = 0.0f;
-    float m_deltaTime = 0.0f;
-    float m_lastFrame = 0.0f;
-    float m_timeNow = 0.0f;
-    float m_lastUpdate = 0.0f;
+    // doubles so they keep sub-millisecond precision however long the
+    // app runs, they're narrowed where they're handed to the systems
+    double m_totalTimeSeconds = 0.0;
+    double m_deltaTime = 0.0;
+    double m_lastFrame = 0.0;
+    double m_timeNow = 0.0;
+    double m_lastUpdate = 0.0;
     bool m_fpsCapped = true;
     float m_fpsLimit = 300.0f;
 
@@ -95,6 +134,25 @@ private:
     int m_shotsHit = 0;
     int m_totalShots = 0;
 
+    // picking
+    struct PendingPick {
+        uint32_t shot;
+        // what the colliders hit, only for cross checks
+        ColliderHandle expected;
+    };
+
+    HitTestMode m_hitTestMode = HitTestMode::Colliders;
+    // by tag
+    std::unordered_map<uint32_t, PendingPick> m_pendingPicks;
+    // how many of those each shot has, by shot
+    std::unordered_map<uint32_t, uint32_t> m_shotPicksLeft;
+    // shots with picks still pending that already counted as a hit
+    std::unordered_set<uint32_t> m_pickedShotHits;
+    uint32_t m_nextPickTag = 0;
+    std::vector<PickResult> m_pickResults;
+    size_t m_pickChecks = 0;
+    size_t m_pickMismatches = 0;
+
     // challenge tracking
     ChallengeState m_challengeState;
 
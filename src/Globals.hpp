@@ -1,9 +1,11 @@
 #pragma once
 
+#include "JobSystem.hpp"
 #include "RNG.hpp"
 #include "ResourceManager.hpp"
 #include "SoundPlayer.hpp"
 
+extern JobSystem* g_jobSystem;
 extern RNG* g_rng;
 extern ResourceManager* g_resourceManager;
 extern SoundPlayer* g_soundPlayer;
@@ -0,0 +1,99 @@
+#include "GpuPicker.hpp"
+
+#include <cstdint>
+
+namespace {
+
+// a blocking wait only happens on requests that are already late, this
+// is just so a lost context doesn't hang the game
+constexpr GLuint64 FORCED_WAIT_TIMEOUT_NS = 100'000'000;
+
+}
+
+GpuPicker::GpuPicker()
+{
+    for (auto& slot : m_slots) {
+        glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glBufferData(
+            GL_PIXEL_PACK_BUFFER, sizeof(uint32_t), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+GpuPicker::~GpuPicker()
+{
+    for (auto& slot : m_slots) {
+        if (slot.fence != nullptr) {
+            glDeleteSync(slot.fence);
+        }
+        glDeleteBuffers(1, &slot.pbo);
+    }
+}
+
+bool GpuPicker::request(uint32_t tag, int x, int y)
+{
+    for (auto& slot : m_slots) {
+        if (slot.fence != nullptr) {
+            continue;
+        }
+
+        // with a pack buffer bound this only queues the copy
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glReadPixels(x, y, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.tag = tag;
+        slot.age = 0;
+        return true;
+    }
+
+    return false;
+}
+
+void GpuPicker::poll(std::vector<PickResult>& results)
+{
+    for (auto& slot : m_slots) {
+        if (slot.fence == nullptr) {
+            continue;
+        }
+
+        slot.age++;
+        GLbitfield flags = 0;
+        GLuint64 timeout = 0;
+        if (slot.age >= MAX_LATENCY_FRAMES) {
+            flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+            timeout = FORCED_WAIT_TIMEOUT_NS;
+        }
+
+        GLenum status = glClientWaitSync(slot.fence, flags, timeout);
+        bool signaled = status == GL_ALREADY_SIGNALED
+            || status == GL_CONDITION_SATISFIED;
+        if (!signaled && slot.age < MAX_LATENCY_FRAMES) {
+            continue;
+        }
+
+        // the id of a request that never completed is lost, 0 is as good
+        // a guess as any
+        uint32_t id = signaled ? readSlot(slot) : 0;
+        results.push_back({ slot.tag, id });
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+    }
+}
+
+uint32_t GpuPicker::readSlot(const Slot& slot)
+{
+    uint32_t id = 0;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    auto* data = static_cast<const uint32_t*>(glMapBufferRange(
+        GL_PIXEL_PACK_BUFFER, 0, sizeof(uint32_t), GL_MAP_READ_BIT));
+    if (data != nullptr) {
+        id = *data;
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    return id;
+}
\ No newline at end of file
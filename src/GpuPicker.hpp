@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// How shots decide what they hit
+enum class HitTestMode {
+    // rays against the colliders, on the CPU
+    Colliders,
+    // the id buffer of the frame shown when shooting
+    IdBuffer,
+    // colliders, but the id buffer is also read and compared to them
+    CrossCheck,
+};
+
+struct PickResult {
+    // whatever was passed to request()
+    uint32_t tag;
+    // 0 if nothing was drawn there
+    uint32_t id;
+};
+
+// Reads single ids back from an id attachment without stalling. Each
+// request copies a texel to a pixel buffer and puts a fence after it,
+// the result is picked up once the fence is signaled. Requests older
+// than MAX_LATENCY_FRAMES are waited on, so a result never takes more
+// than that many frames to come back
+class GpuPicker {
+public:
+    static constexpr size_t MAX_LATENCY_FRAMES = 3;
+
+    GpuPicker();
+    ~GpuPicker();
+
+    GpuPicker(const GpuPicker& picker) = delete;
+    GpuPicker& operator=(const GpuPicker& picker) = delete;
+
+    // Reads the id at (x, y) of the current read framebuffer. Returns
+    // false if too many requests are in flight already
+    bool request(uint32_t tag, int x, int y);
+
+    // Meant to be called once per frame. Appends the requests that
+    // completed to results
+    void poll(std::vector<PickResult>& results);
+
+private:
+    static constexpr size_t SLOT_COUNT = 64;
+
+    struct Slot {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+        uint32_t tag = 0;
+        // polls since the request
+        size_t age = 0;
+    };
+
+    static uint32_t readSlot(const Slot& slot);
+
+    std::array<Slot, SLOT_COUNT> m_slots;
+};
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "GpuTimer.hpp"
+
+GpuTimer::GpuTimer()
+{
+    glGenQueries(QUERY_COUNT, m_queries.data());
+}
+
+GpuTimer::~GpuTimer()
+{
+    glDeleteQueries(QUERY_COUNT, m_queries.data());
+}
+
+void GpuTimer::begin()
+{
+    // if the GPU is this far behind, skipping a measurement is fine
+    m_measuring = !m_pending[m_next];
+    if (!m_measuring) {
+        return;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next]);
+}
+
+void GpuTimer::end()
+{
+    if (!m_measuring) {
+        return;
+    }
+
+    glEndQuery(GL_TIME_ELAPSED);
+    m_pending[m_next] = true;
+    m_next = (m_next + 1) % QUERY_COUNT;
+}
+
+std::optional<float> GpuTimer::poll()
+{
+    std::optional<float> result = std::nullopt;
+
+    // from oldest to newest, queries finish in order so we can stop
+    // at the first one that isn't available yet
+    for (size_t i = 0; i < QUERY_COUNT; i++) {
+        size_t index = (m_next + i) % QUERY_COUNT;
+        if (!m_pending[index]) {
+            continue;
+        }
+
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(
+            m_queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_FALSE) {
+            break;
+        }
+
+        GLuint64 elapsedNs = 0;
+        glGetQueryObjectui64v(m_queries[index], GL_QUERY_RESULT, &elapsedNs);
+        m_pending[index] = false;
+        result = elapsedNs / 1'000'000.0f;
+    }
+
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <optional>
+
+// Measures how long the GPU takes to execute the commands between
+// begin() and end(). Results are only read once they are available,
+// a few frames later, so measuring never stalls the pipeline
+class GpuTimer {
+public:
+    GpuTimer();
+    ~GpuTimer();
+
+    GpuTimer(const GpuTimer& timer) = delete;
+    GpuTimer& operator=(const GpuTimer& timer) = delete;
+
+    void begin();
+    void end();
+
+    // Returns the most recent measurement that became available since
+    // the last call, in milliseconds
+    std::optional<float> poll();
+
+private:
+    static constexpr size_t QUERY_COUNT = 4;
+
+    std::array<GLuint, QUERY_COUNT> m_queries;
+    std::array<bool, QUERY_COUNT> m_pending = {};
+    // query used by the next begin(), which is also the oldest one
+    size_t m_next = 0;
+    // false if every query was still pending on begin()
+    bool m_measuring = false;
+};
\ No newline at end of file
@@ -2,6 +2,19 @@
 
 #include <GLFW/glfw3.h>
 
+namespace {
+
+void sampleState(InputState& state)
+{
+    // a new press toggles even if the previous one was still held
+    state.prev = state.pressedSinceSample ? false : state.current;
+    state.current = state.latest || state.pressedSinceSample;
+    state.pressTime = state.latestPressTime;
+    state.pressedSinceSample = false;
+}
+
+}
+
 std::vector<InputManager*> InputManager::s_instances;
 
 InputManager::InputManager(Window& window)
@@ -35,6 +48,11 @@ bool InputManager::isMouseButtonToggled(int button)
     return m_mouseBtns.at(button).current && !m_mouseBtns.at(button).prev;
 }
 
+double InputManager::getMouseButtonPressTime(int button) const
+{
+    return m_mouseBtns.at(button).pressTime;
+}
+
 std::pair<float, float> InputManager::getCursorPos()
 {
     // double xpos = 0;
@@ -44,16 +62,28 @@ std::pair<float, float> InputManager::getCursorPos()
     return m_cursorPos;
 }
 
-void InputManager::consolidateKeyStates()
+std::pair<float, float> InputManager::getLatestCursorPos() const
+{
+    return m_latestCursorPos;
+}
+
+void InputManager::sampleInput()
 {
     for (auto& key : m_keys) {
-        key.prev = key.current;
+        sampleState(key);
     }
     for (auto& button : m_mouseBtns) {
-        button.prev = button.current;
+        sampleState(button);
     }
 
-    m_cursorMoved = false;
+    m_cursorMoved = m_cursorMovedSinceSample;
+    m_cursorMovedSinceSample = false;
+    m_cursorPos = m_latestCursorPos;
+}
+
+void InputManager::pollEvents()
+{
+    glfwPollEvents();
 }
 
 void InputManager::setupInputCallbacks(GLFWwindow* window)
@@ -65,36 +95,48 @@ void InputManager::setupInputCallbacks(GLFWwindow* window)
     glfwSetCharCallback(window, nullptr);
 }
 
-void InputManager::setKeyPressed(int key, bool pressed)
+void InputManager::setKeyPressed(int key, bool pressed, double time)
 {
-    m_keys.at(key).current = pressed;
+    auto& state = m_keys.at(key);
+    if (pressed && !state.latest) {
+        state.latestPressTime = time;
+        state.pressedSinceSample = true;
+    }
+    state.latest = pressed;
 }
 
-void InputManager::setMouseButtonPressed(int key, bool pressed)
+void InputManager::setMouseButtonPressed(int key, bool pressed, double time)
 {
-    m_mouseBtns.at(key).current = pressed;
+    auto& state = m_mouseBtns.at(key);
+    if (pressed && !state.latest) {
+        state.latestPressTime = time;
+        state.pressedSinceSample = true;
+    }
+    state.latest = pressed;
 }
 
 void InputManager::setCursorPos(double xpos, double ypos)
 {
-    m_cursorMoved = true;
-    m_cursorPos.first = xpos;
-    m_cursorPos.second = ypos;
+    m_cursorMovedSinceSample = true;
+    m_latestCursorPos.first = xpos;
+    m_latestCursorPos.second = ypos;
 }
 
 void InputManager::keyCallback(
     GLFWwindow* /*window*/, int key, int /*scancode*/, int action, int /*mods*/)
 {
+    double time = glfwGetTime();
     for (auto* instance : InputManager::s_instances) {
-        instance->setKeyPressed(key, action != GLFW_RELEASE);
+        instance->setKeyPressed(key, action != GLFW_RELEASE, time);
     }
 }
 
 void InputManager::mouseButtonCallback(
     GLFWwindow* /*window*/, int button, int action, int /*mods*/)
 {
+    double time = glfwGetTime();
     for (auto* instance : InputManager::s_instances) {
-        instance->setMouseButtonPressed(button, action != GLFW_RELEASE);
+        instance->setMouseButtonPressed(button, action != GLFW_RELEASE, time);
     }
 }
 
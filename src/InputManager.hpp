@@ -13,10 +13,22 @@
 // or mouse button. prev is the state of the key on the previous
 // frame, and current is the state in the current frame (pressed
 // or not pressed). prev is generally used to know if a button was
-// held between multiple frames and prevent spam
+// held between multiple frames and prevent spam.
+// latest is whatever GLFW last reported, which only becomes current
+// when the input is sampled. This lets events be polled in the middle
+// of a frame without the game losing any presses. pressedSinceSample
+// keeps a press that was released before the sample, so it's still
+// seen (and toggled) for a frame
 struct InputState {
     bool prev = false;
     bool current = false;
+    bool latest = false;
+    bool pressedSinceSample = false;
+
+    // glfwGetTime() of the press event, follows the same
+    // sampling as current and latest
+    double pressTime = 0.0;
+    double latestPressTime = 0.0;
 };
 
 class InputManager {
@@ -36,11 +48,22 @@ public:
     // Same idea as isKeyToggled
     bool isMouseButtonToggled(int button);
 
+    // When the current press of this button happened
+    double getMouseButtonPressTime(int button) const;
+
     std::pair<float, float> getCursorPos();
 
-    // Should be called after all input processing to update
-    // the keys that were pressed this frame
-    void consolidateKeyStates();
+    // Cursor position as last reported by GLFW, possibly newer than
+    // the one sampled for this frame
+    std::pair<float, float> getLatestCursorPos() const;
+
+    // Should be called once per frame before any input processing.
+    // Makes the latest reported state the current one
+    void sampleInput();
+
+    // Fetches pending events from GLFW without changing the
+    // sampled state
+    static void pollEvents();
 
     // MUST be called after all instances are created,
     // otherwise the callback won't be set
@@ -51,11 +74,13 @@ private:
     std::array<InputState, GLFW_KEY_LAST + 1> m_keys;
     std::array<InputState, GLFW_MOUSE_BUTTON_LAST + 1> m_mouseBtns;
     std::pair<double, double> m_cursorPos = { -1, -1 };
+    std::pair<double, double> m_latestCursorPos = { -1, -1 };
     static std::vector<InputManager*> s_instances;
     bool m_cursorMoved = false;
+    bool m_cursorMovedSinceSample = false;
 
-    void setKeyPressed(int key, bool pressed);
-    void setMouseButtonPressed(int key, bool pressed);
+    void setKeyPressed(int key, bool pressed, double time);
+    void setMouseButtonPressed(int key, bool pressed, double time);
     void setCursorPos(double xpos, double ypos);
 
     static void keyCallback(
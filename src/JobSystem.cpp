@@ -0,0 +1,207 @@
+#include "JobSystem.hpp"
+
+#include <algorithm>
+#include <optional>
+
+namespace {
+
+// queue of the thread, the one that created the system (or any other
+// thread that isn't a worker) uses the first
+thread_local const JobSystem* t_jobSystem = nullptr;
+thread_local unsigned t_queueIndex = 0;
+
+}
+
+bool JobCounter::done() const
+{
+    return m_pending.load(std::memory_order_acquire) == 0;
+}
+
+JobSystem::JobSystem(unsigned threadCount)
+{
+    startWorkers(threadCount);
+}
+
+JobSystem::~JobSystem()
+{
+    stopWorkers();
+}
+
+void JobSystem::setThreadCount(unsigned threadCount)
+{
+    stopWorkers();
+    startWorkers(threadCount);
+}
+
+bool JobSystem::JobRing::empty() const
+{
+    return m_count == 0;
+}
+
+void JobSystem::JobRing::pushBack(const QueuedJob& job)
+{
+    if (m_count == m_slots.size()) {
+        // unrolls the ring into the start of the bigger one
+        std::vector<QueuedJob> slots;
+        slots.reserve(std::max<size_t>(m_slots.size() * 2, 64));
+        for (size_t i = 0; i < m_count; i++) {
+            slots.push_back(m_slots[(m_head + i) % m_slots.size()]);
+        }
+        slots.resize(slots.capacity());
+        m_slots = std::move(slots);
+        m_head = 0;
+    }
+
+    m_slots[(m_head + m_count) % m_slots.size()] = job;
+    m_count++;
+}
+
+JobSystem::QueuedJob JobSystem::JobRing::popBack()
+{
+    m_count--;
+    return m_slots[(m_head + m_count) % m_slots.size()];
+}
+
+JobSystem::QueuedJob JobSystem::JobRing::popFront()
+{
+    QueuedJob job = m_slots[m_head];
+    m_head = (m_head + 1) % m_slots.size();
+    m_count--;
+    return job;
+}
+
+unsigned JobSystem::threadCount() const
+{
+    return (unsigned)m_queues.size();
+}
+
+void JobSystem::submit(const Job& job, JobCounter& counter)
+{
+    counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+
+    WorkQueue& queue = *m_queues[queueIndex()];
+    {
+        std::lock_guard lock(queue.mutex);
+        queue.jobs.pushBack({ job, &counter });
+    }
+    m_queuedJobs.fetch_add(1, std::memory_order_release);
+
+    if (!m_workers.empty()) {
+        // so a worker can't miss it between checking and going to sleep
+        std::lock_guard lock(m_sleepMutex);
+        m_wake.notify_one();
+    }
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+    unsigned index = queueIndex();
+    while (!counter.done()) {
+        // the jobs left might all be running on other threads
+        if (!runJob(index)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+unsigned JobSystem::resolveThreadCount(unsigned threadCount)
+{
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+
+    return std::clamp(threadCount, 1u, MAX_JOB_THREADS);
+}
+
+void JobSystem::startWorkers(unsigned threadCount)
+{
+    threadCount = resolveThreadCount(threadCount);
+
+    for (unsigned i = 0; i < threadCount; i++) {
+        m_queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    m_stopping = false;
+    for (unsigned i = 1; i < threadCount; i++) {
+        m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+void JobSystem::stopWorkers()
+{
+    {
+        std::lock_guard lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+    m_queues.clear();
+}
+
+void JobSystem::workerLoop(unsigned index)
+{
+    t_jobSystem = this;
+    t_queueIndex = index;
+
+    while (!m_stopping) {
+        if (runJob(index)) {
+            continue;
+        }
+
+        std::unique_lock lock(m_sleepMutex);
+        m_wake.wait(lock, [this] {
+            return m_stopping
+                || m_queuedJobs.load(std::memory_order_acquire) > 0;
+        });
+    }
+}
+
+bool JobSystem::runJob(unsigned index)
+{
+    if (m_queuedJobs.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+
+    std::optional<QueuedJob> queued;
+
+    // newest of our own first, it's the most likely to still be in cache.
+    // Without workers nothing is gained from it, oldest first then runs
+    // the jobs in submission order
+    {
+        WorkQueue& queue = *m_queues[index];
+        std::lock_guard lock(queue.mutex);
+        if (!queue.jobs.empty()) {
+            queued = m_queues.size() == 1 ? queue.jobs.popFront()
+                                          : queue.jobs.popBack();
+        }
+    }
+
+    // then the oldest of the others, which are the biggest when jobs
+    // split themselves up
+    for (size_t i = 1; !queued.has_value() && i < m_queues.size(); i++) {
+        WorkQueue& queue = *m_queues[(index + i) % m_queues.size()];
+        std::lock_guard lock(queue.mutex);
+        if (!queue.jobs.empty()) {
+            queued = queue.jobs.popFront();
+        }
+    }
+
+    if (!queued.has_value()) {
+        return false;
+    }
+
+    m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    const Job& job = queued->job;
+    job.run(job.context, job.begin, job.end);
+    queued->counter->m_pending.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+unsigned JobSystem::queueIndex() const
+{
+    return t_jobSystem == this ? t_queueIndex : 0;
+}
\ No newline at end of file
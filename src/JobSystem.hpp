@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// thread counts past this are clamped
+constexpr unsigned MAX_JOB_THREADS = 64;
+
+// A function run on [begin, end) of whatever context points to. Plain
+// data, and the queues keep their capacity, so submitting one only
+// allocates when a queue holds more jobs than it ever did
+struct Job {
+    void (*run)(const void* context, size_t begin, size_t end);
+    const void* context;
+    size_t begin = 0;
+    size_t end = 0;
+};
+
+// Counts the jobs submitted with it that didn't finish yet. Whatever
+// depends on them waits for it with JobSystem::wait()
+class JobCounter {
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool done() const;
+
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> m_pending = 0;
+};
+
+// Fixed pool of worker threads, each with its own queue. A thread takes
+// the jobs it submitted from the back of its queue, and steals from the
+// front of the others' once it's empty. The thread that created the
+// system is one of its threads, it runs jobs while it waits for them.
+// Jobs only ever write to their own range, so results don't depend on
+// how many threads there are
+class JobSystem {
+public:
+    // 0 for one thread per core. With 1 there are no workers, jobs run
+    // in submission order on the thread that waits for them
+    explicit JobSystem(unsigned threadCount = 0);
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Replaces the workers. Must not be called while jobs are pending
+    void setThreadCount(unsigned threadCount);
+    unsigned threadCount() const;
+    // How many threads asking for threadCount gives
+    static unsigned resolveThreadCount(unsigned threadCount);
+
+    void submit(const Job& job, JobCounter& counter);
+    // Runs jobs (not necessarily the counter's) until the counter is done
+    void wait(JobCounter& counter);
+
+    // Submits func(begin, end) for [0, count) in ranges of chunkSize.
+    // func has to stay alive until the counter is done
+    template <typename Func>
+    void parallelFor(size_t count, size_t chunkSize, JobCounter& counter,
+        const Func& func);
+    // Same, but returns once every range ran. Runs everything on this
+    // thread when it's a single range
+    template <typename Func>
+    void parallelFor(size_t count, size_t chunkSize, const Func& func);
+
+private:
+    struct QueuedJob {
+        Job job;
+        JobCounter* counter;
+    };
+
+    // Ring buffer that only grows when it's full, popped from both ends
+    class JobRing {
+    public:
+        bool empty() const;
+        void pushBack(const QueuedJob& job);
+        QueuedJob popBack();
+        QueuedJob popFront();
+
+    private:
+        std::vector<QueuedJob> m_slots;
+        size_t m_head = 0;
+        size_t m_count = 0;
+    };
+
+    // one per thread, on its own cache line
+    struct alignas(64) WorkQueue {
+        std::mutex mutex;
+        JobRing jobs;
+    };
+
+    void startWorkers(unsigned threadCount);
+    void stopWorkers();
+    void workerLoop(unsigned index);
+    // Runs one job from the thread's queue, or stolen from another.
+    // Returns false if there were none
+    bool runJob(unsigned index);
+    // Index of the calling thread's queue
+    unsigned queueIndex() const;
+
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+    std::vector<std::thread> m_workers;
+    std::atomic<size_t> m_queuedJobs = 0;
+    std::atomic<bool> m_stopping = false;
+    // idle workers sleep on this until jobs get queued
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+};
+
+template <typename Func>
+void JobSystem::parallelFor(
+    size_t count, size_t chunkSize, JobCounter& counter, const Func& func)
+{
+    auto run = [](const void* context, size_t begin, size_t end) {
+        (*static_cast<const Func*>(context))(begin, end);
+    };
+
+    for (size_t begin = 0; begin < count; begin += chunkSize) {
+        size_t end = begin + chunkSize < count ? begin + chunkSize : count;
+        submit({ run, &func, begin, end }, counter);
+    }
+}
+
+template <typename Func>
+void JobSystem::parallelFor(size_t count, size_t chunkSize, const Func& func)
+{
+    if (count <= chunkSize) {
+        if (count > 0) {
+            func(0, count);
+        }
+        return;
+    }
+
+    JobCounter counter;
+    parallelFor(count, chunkSize, counter, func);
+    wait(counter);
+}
\ No newline at end of file
@@ -0,0 +1,204 @@
+#include "LatencyTracker.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+void Histogram::add(float valueMs)
+{
+    size_t bucket = std::min(
+        (size_t)std::max(valueMs / BUCKET_WIDTH_MS, 0.0f), BUCKET_COUNT - 1);
+    m_buckets[bucket]++;
+
+    if (m_count == 0) {
+        m_min = valueMs;
+        m_max = valueMs;
+    } else {
+        m_min = std::min(m_min, valueMs);
+        m_max = std::max(m_max, valueMs);
+    }
+
+    m_count++;
+    m_sum += valueMs;
+}
+
+void Histogram::clear()
+{
+    *this = {};
+}
+
+size_t Histogram::count() const
+{
+    return m_count;
+}
+
+float Histogram::mean() const
+{
+    return m_count > 0 ? m_sum / m_count : 0.0f;
+}
+
+float Histogram::min() const
+{
+    return m_min;
+}
+
+float Histogram::max() const
+{
+    return m_max;
+}
+
+float Histogram::percentile(float p) const
+{
+    if (m_count == 0) {
+        return 0.0f;
+    }
+
+    auto target = (size_t)std::ceil(p * m_count);
+    size_t accumulated = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        accumulated += m_buckets[i];
+        if (accumulated >= target) {
+            return std::min((i + 1) * BUCKET_WIDTH_MS, m_max);
+        }
+    }
+
+    return m_max;
+}
+
+const std::array<size_t, Histogram::BUCKET_COUNT>& Histogram::buckets() const
+{
+    return m_buckets;
+}
+
+LatencyTracker::~LatencyTracker()
+{
+    for (auto& frame : m_pendingFrames) {
+        glDeleteQueries(1, &frame.query);
+    }
+    if (!m_freeQueries.empty()) {
+        glDeleteQueries((GLsizei)m_freeQueries.size(), m_freeQueries.data());
+    }
+}
+
+void LatencyTracker::onClickConsumed(double clickTime)
+{
+    m_consumedClickTimes.push_back(clickTime);
+}
+
+void LatencyTracker::onFramePresented(double now)
+{
+    if (m_lastPresentTime >= 0) {
+        m_frameToFrame.add((now - m_lastPresentTime) * 1000);
+    }
+    m_lastPresentTime = now;
+
+    if (m_consumedClickTimes.empty()) {
+        return;
+    }
+
+    for (double clickTime : m_consumedClickTimes) {
+        m_clickToSubmit.add((now - clickTime) * 1000);
+    }
+
+    // the GL_TIMESTAMP read doesn't wait for the GPU, so this is only
+    // off by how long the call takes
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    m_gpuToCpuOffset = now - gpuNow * 1e-9;
+
+    GLuint query = 0;
+    if (m_freeQueries.empty()) {
+        glGenQueries(1, &query);
+    } else {
+        query = m_freeQueries.back();
+        m_freeQueries.pop_back();
+    }
+    // written once every command before it, the frame included, is done
+    glQueryCounter(query, GL_TIMESTAMP);
+
+    m_pendingFrames.push_back({ query, std::move(m_consumedClickTimes) });
+    m_consumedClickTimes.clear();
+}
+
+void LatencyTracker::poll()
+{
+    auto it = m_pendingFrames.begin();
+    while (it != m_pendingFrames.end()) {
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(it->query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            ++it;
+            continue;
+        }
+
+        GLuint64 gpuDone = 0;
+        glGetQueryObjectui64v(it->query, GL_QUERY_RESULT, &gpuDone);
+        double done = gpuDone * 1e-9 + m_gpuToCpuOffset;
+        for (double clickTime : it->clickTimes) {
+            m_clickToGpuComplete.add((done - clickTime) * 1000);
+        }
+
+        m_freeQueries.push_back(it->query);
+        it = m_pendingFrames.erase(it);
+    }
+}
+
+void LatencyTracker::clear()
+{
+    m_clickToSubmit.clear();
+    m_clickToGpuComplete.clear();
+    m_frameToFrame.clear();
+}
+
+void LatencyTracker::writeReport(const std::string& path) const
+{
+    std::ofstream out(path);
+    if (!out) {
+        return;
+    }
+
+    const auto writeHistogram
+        = [&out](const std::string& name, const Histogram& histogram) {
+              out << name << "\n";
+              out << std::fixed << std::setprecision(2)
+                  << "  samples: " << histogram.count() << "\n"
+                  << "  mean: " << histogram.mean() << " ms\n"
+                  << "  min: " << histogram.min() << " ms\n"
+                  << "  p50: " << histogram.percentile(0.5f) << " ms\n"
+                  << "  p90: " << histogram.percentile(0.9f) << " ms\n"
+                  << "  p99: " << histogram.percentile(0.99f) << " ms\n"
+                  << "  max: " << histogram.max() << " ms\n";
+
+              // only non empty buckets, otherwise this gets huge
+              const auto& buckets = histogram.buckets();
+              for (size_t i = 0; i < buckets.size(); i++) {
+                  if (buckets[i] == 0) {
+                      continue;
+                  }
+                  out << "  [" << i * Histogram::BUCKET_WIDTH_MS << ", "
+                      << (i + 1) * Histogram::BUCKET_WIDTH_MS
+                      << ") ms: " << buckets[i] << "\n";
+              }
+              out << "\n";
+          };
+
+    writeHistogram("Click to submit", m_clickToSubmit);
+    writeHistogram("Click to GPU complete", m_clickToGpuComplete);
+    writeHistogram("Frame to frame", m_frameToFrame);
+}
+
+const Histogram& LatencyTracker::clickToSubmit() const
+{
+    return m_clickToSubmit;
+}
+
+const Histogram& LatencyTracker::clickToGpuComplete() const
+{
+    return m_clickToGpuComplete;
+}
+
+const Histogram& LatencyTracker::frameToFrame() const
+{
+    return m_frameToFrame;
+}
\ No newline at end of file
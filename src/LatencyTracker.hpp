@@ -0,0 +1,84 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+// Fixed bucket histogram for latencies in milliseconds. Anything above
+// the last bucket is counted in it
+class Histogram {
+public:
+    static constexpr float BUCKET_WIDTH_MS = 0.5f;
+    static constexpr size_t BUCKET_COUNT = 200;
+
+    void add(float valueMs);
+    void clear();
+
+    size_t count() const;
+    float mean() const;
+    float min() const;
+    float max() const;
+    // p in [0, 1]. Returns the upper bound of the bucket that contains
+    // the percentile, so it's only as precise as BUCKET_WIDTH_MS
+    float percentile(float p) const;
+
+    const std::array<size_t, BUCKET_COUNT>& buckets() const;
+
+private:
+    std::array<size_t, BUCKET_COUNT> m_buckets = {};
+    size_t m_count = 0;
+    double m_sum = 0.0;
+    float m_min = 0.0f;
+    float m_max = 0.0f;
+};
+
+// Measures how long it takes for a mouse click to show up on screen.
+// Only clicks are tracked, mouse movement isn't. The frame that first
+// consumes a click is tagged and a GL_TIMESTAMP query is inserted after
+// it is swapped. Once the query is available, its GPU time is converted
+// to the CPU clock, so the completion time doesn't depend on when the
+// query gets polled
+class LatencyTracker {
+public:
+    LatencyTracker() = default;
+    ~LatencyTracker();
+
+    LatencyTracker(const LatencyTracker& tracker) = delete;
+    LatencyTracker& operator=(const LatencyTracker& tracker) = delete;
+
+    // clickTime is when the click was received, in glfwGetTime() seconds
+    void onClickConsumed(double clickTime);
+    // Should be called right after swapping buffers
+    void onFramePresented(double now);
+    // Checks the queries of the tagged frames without blocking
+    void poll();
+
+    void clear();
+    void writeReport(const std::string& path) const;
+
+    const Histogram& clickToSubmit() const;
+    const Histogram& clickToGpuComplete() const;
+    const Histogram& frameToFrame() const;
+
+private:
+    struct PendingFrame {
+        GLuint query;
+        std::vector<double> clickTimes;
+    };
+
+    Histogram m_clickToSubmit;
+    Histogram m_clickToGpuComplete;
+    Histogram m_frameToFrame;
+
+    // clicks consumed by a frame that wasn't presented yet
+    std::vector<double> m_consumedClickTimes;
+    std::vector<PendingFrame> m_pendingFrames;
+    // queries of frames that are done, reused for the next ones
+    std::vector<GLuint> m_freeQueries;
+    double m_lastPresentTime = -1.0;
+    // glfwGetTime() minus the GPU clock, both in seconds. Measured again
+    // at every present since the two clocks drift apart
+    double m_gpuToCpuOffset = 0.0;
+};
\ No newline at end of file
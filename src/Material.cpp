@@ -2,29 +2,38 @@
 
 #include <stb_image.h>
 
+ImageData::ImageData(const std::string& path)
+{
+    pixels.reset(stbi_load(path.c_str(), &width, &height, &components, 0));
+    assert(pixels != nullptr);
+}
+
+void ImageData::Free::operator()(unsigned char* pixels) const
+{
+    stbi_image_free(pixels);
+}
+
 Texture::Texture(const std::string& path, Texture::Type type)
+    : Texture(ImageData(path), type)
+{
+}
+
+Texture::Texture(const ImageData& image, Texture::Type type)
     : m_type(type)
 {
     glGenTextures(1, &m_id);
 
-    int width = 0;
-    int height = 0;
-    int nrComponents = 0;
-    unsigned char* data
-        = stbi_load(path.c_str(), &width, &height, &nrComponents, 0);
-    assert(data != nullptr);
-
-    // default and when nrComponents == 1
+    // default and when components == 1
     GLenum format = GL_RED;
-    if (nrComponents == 3) {
+    if (image.components == 3) {
         format = GL_RGB;
-    } else if (nrComponents == 4) {
+    } else if (image.components == 4) {
         format = GL_RGBA;
     }
 
     glBindTexture(GL_TEXTURE_2D, m_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,
-        GL_UNSIGNED_BYTE, data);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0,
+        format, GL_UNSIGNED_BYTE, image.pixels.get());
     glGenerateMipmap(GL_TEXTURE_2D);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -45,22 +54,21 @@ void Texture::bind() const
 }
 
 Cubemap::Cubemap(const std::array<std::string, 6>& paths)
+    : Cubemap(std::array<ImageData, 6> { ImageData(paths[0]),
+        ImageData(paths[1]), ImageData(paths[2]), ImageData(paths[3]),
+        ImageData(paths[4]), ImageData(paths[5]) })
+{
+}
+
+Cubemap::Cubemap(const std::array<ImageData, 6>& faces)
 {
     glGenTextures(1, &m_id);
     glBindTexture(GL_TEXTURE_CUBE_MAP, m_id);
 
-    int width = 0;
-    int height = 0;
-    int nrComponents = 0;
-
-    for (size_t i = 0; i < paths.size(); i++) {
-        unsigned char* data
-            = stbi_load(paths.at(i).c_str(), &width, &height, &nrComponents, 0);
-        assert(data != nullptr);
-
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width,
-            height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        stbi_image_free(data);
+    for (size_t i = 0; i < faces.size(); i++) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB,
+            faces[i].width, faces[i].height, 0, GL_RGB, GL_UNSIGNED_BYTE,
+            faces[i].pixels.get());
     }
 
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -5,13 +5,33 @@
 #include <glad/glad.h>
 
 #include <array>
+#include <memory>
+#include <string>
 #include <vector>
 
+// Pixels of an image file. Decoding is the slow part of loading a
+// texture, and it can be done on any thread
+struct ImageData {
+    ImageData() = default;
+    explicit ImageData(const std::string& path);
+
+    struct Free {
+        void operator()(unsigned char* pixels) const;
+    };
+
+    std::unique_ptr<unsigned char, Free> pixels;
+    int width = 0;
+    int height = 0;
+    int components = 0;
+};
+
 class Texture {
 public:
     enum class Type { Diffuse, Specular, Normal, Height, Last };
 
     Texture(const std::string& path, Texture::Type type);
+    // Creates the texture, on the thread with the context
+    Texture(const ImageData& image, Texture::Type type);
     virtual ~Texture() = default;
 
     Texture::Type type() const;
@@ -28,6 +48,7 @@ protected:
 class Cubemap : public Texture {
 public:
     Cubemap(const std::array<std::string, 6>& paths);
+    explicit Cubemap(const std::array<ImageData, 6>& faces);
 
     void bind() const override;
 };
@@ -7,6 +7,21 @@
 #include <iostream>
 
 Model::Model(const std::string& path)
+    : Model(load(path))
+{
+}
+
+Model::Model(ModelData data)
+    : m_triangleBvh(std::move(data.triangleBvh))
+    , m_bounds(data.bounds)
+    , m_directory(std::move(data.directory))
+{
+    for (auto& mesh : data.meshes) {
+        m_meshes.emplace_back(mesh.vertices, mesh.indices);
+    }
+}
+
+ModelData Model::load(const std::string& path)
 {
     Assimp::Importer importer;
     const aiScene* scene = importer.ReadFile(path,
@@ -16,11 +31,19 @@ Model::Model(const std::string& path)
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE
         || !scene->mRootNode) {
         throw std::string("ERROR::ASSIMP:: ") + importer.GetErrorString();
-        return;
     }
 
-    m_directory = path.substr(0, path.find_last_of('/'));
-    processNode(scene->mRootNode, scene);
+    ModelData data;
+    data.directory = path.substr(0, path.find_last_of('/'));
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    processNode(scene->mRootNode, scene, data, positions, indices);
+    for (const auto& position : positions) {
+        data.bounds.min = glm::min(data.bounds.min, position);
+        data.bounds.max = glm::max(data.bounds.max, position);
+    }
+    data.triangleBvh = std::make_shared<const TriangleBvh>(positions, indices);
+    return data;
 }
 
 void Model::render() const
@@ -30,7 +53,18 @@ void Model::render() const
     }
 }
 
-void Model::processNode(aiNode* node, const aiScene* scene)
+const TriangleBvh* Model::triangleBvh() const
+{
+    return m_triangleBvh.get();
+}
+
+const Aabb& Model::bounds() const
+{
+    return m_bounds;
+}
+
+void Model::processNode(aiNode* node, const aiScene* scene, ModelData& data,
+    std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
 {
     // process each mesh located at the current node
     for (unsigned int i = 0; i < node->mNumMeshes; i++) {
@@ -38,16 +72,17 @@ void Model::processNode(aiNode* node, const aiScene* scene)
         // the scene. the scene contains all the data, node is just to keep
         // stuff organized (like relations between nodes).
         aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        m_meshes.push_back(Model::processMesh(mesh));
+        data.meshes.push_back(Model::processMesh(mesh));
+        appendTriangles(mesh, positions, indices);
     }
     // after we've processed all of the meshes (if any) we then recursively
     // process each of the children nodes
     for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        processNode(node->mChildren[i], scene);
+        processNode(node->mChildren[i], scene, data, positions, indices);
     }
 }
 
-Mesh Model::processMesh(aiMesh* mesh)
+ModelData::MeshData Model::processMesh(aiMesh* mesh)
 {
     std::vector<Vertex> vertices;
     std::vector<GLuint> indices;
@@ -95,5 +130,26 @@ Mesh Model::processMesh(aiMesh* mesh)
         }
     }
 
-    return { vertices, indices };
+    return { std::move(vertices), std::move(indices) };
+}
+
+void Model::appendTriangles(const aiMesh* mesh,
+    std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
+{
+    auto firstVertex = (uint32_t)positions.size();
+    for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+        positions.emplace_back(
+            mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+    }
+
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+        const aiFace& face = mesh->mFaces[i];
+        // lines and points left over after triangulation can't be hit
+        if (face.mNumIndices != 3) {
+            continue;
+        }
+        for (unsigned int j = 0; j < 3; j++) {
+            indices.push_back(firstVertex + face.mIndices[j]);
+        }
+    }
 }
@@ -1,25 +1,63 @@
 #pragma once
 
+#include "Aabb.hpp"
 #include "Material.hpp"
 #include "Mesh.hpp"
 #include "Shader.hpp"
+#include "TriangleBvh.hpp"
 
 #include <assimp/scene.h>
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
+// What a model file decodes to, before anything is given to OpenGL.
+// Building it is the slow part of loading a model, and it can be done on
+// any thread
+struct ModelData {
+    struct MeshData {
+        std::vector<Vertex> vertices;
+        std::vector<GLuint> indices;
+    };
+
+    std::vector<MeshData> meshes;
+    std::shared_ptr<const TriangleBvh> triangleBvh;
+    // of every vertex, in model space
+    Aabb bounds;
+    std::string directory;
+};
+
 class Model {
 public:
     Model(const std::string& path);
+    // Creates the buffers of the meshes, on the thread with the context
+    explicit Model(ModelData data);
+
+    // Throws if the file can't be imported
+    static ModelData load(const std::string& path);
 
     void render() const;
 
+    // Triangles of every mesh of the model, for mesh hitboxes. Stays
+    // valid as long as any copy of the model is alive
+    const TriangleBvh* triangleBvh() const;
+    // In model space, for culling
+    const Aabb& bounds() const;
+
 private:
-    void processNode(aiNode* node, const aiScene* scene);
-    static Mesh processMesh(aiMesh* mesh);
+    static void processNode(aiNode* node, const aiScene* scene,
+        ModelData& data, std::vector<glm::vec3>& positions,
+        std::vector<uint32_t>& indices);
+    static ModelData::MeshData processMesh(aiMesh* mesh);
+    static void appendTriangles(const aiMesh* mesh,
+        std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices);
 
     std::vector<Mesh> m_meshes;
+    // shared by the copies, entities each get their own copy of the model
+    std::shared_ptr<const TriangleBvh> m_triangleBvh;
+    Aabb m_bounds;
     std::string m_directory;
     bool m_gammaCorrection;
 };
@@ -0,0 +1,767 @@
+#include "Movement.hpp"
+
+#include "Simd.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <type_traits>
+
+namespace {
+
+constexpr float PI = glm::pi<float>();
+constexpr float TWO_PI = 2.0f * PI;
+// the kernels only take a few nanoseconds per movement
+constexpr size_t MOVEMENTS_PER_JOB = 256;
+
+// x - floor(x), through an int conversion that vectorizes where
+// std::floor doesn't (SSE2). Only valid while x fits in an int
+float fract(float x)
+{
+    auto truncated = (float)(int32_t)x;
+    // truncation rounds negative numbers up
+    truncated -= truncated > x ? 1.0f : 0.0f;
+    return x - truncated;
+}
+
+// goes from 0 to 1 and back to 0 once per unit of x
+float triangleWave(float x)
+{
+    return 1.0f - std::abs(2.0f * fract(x) - 1.0f);
+}
+
+template <typename T>
+T catmullRom(const T& p0, const T& p1, const T& p2, const T& p3, float t)
+{
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return 0.5f
+        * (2.0f * p1 + (p2 - p0) * t
+            + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2
+            + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+glm::vec3 bezier(const glm::vec3& p0, const glm::vec3& p1,
+    const glm::vec3& p2, const glm::vec3& p3, float t)
+{
+    float u = 1.0f - t;
+    return u * u * u * p0 + 3.0f * u * u * t * p1 + 3.0f * u * t * t * p2
+        + t * t * t * p3;
+}
+
+uint32_t hash(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Random value for a point of the lattice of the random walk. Catmull-Rom
+// overshoots by at most a quarter, so values in [-0.8, 0.8] keep the
+// walk in [-1, 1]
+float latticeValue(uint32_t seed, uint32_t axis, uint32_t point)
+{
+    uint32_t bits = hash(seed ^ hash(axis * 0x9e3779b9u + point));
+    return ((float)(bits >> 8) / (float)0xffffff * 2.0f - 1.0f) * 0.8f;
+}
+
+// One overload per kind, the scalar loops and the ends of the SIMD ones
+// go through them
+
+glm::vec3 evaluateMovement(const LissajousMovement& movement, float time)
+{
+    glm::vec3 angle = movement.frequency * time + movement.phase;
+    glm::vec3 cosines(fastCos(angle.x), fastCos(angle.y), fastCos(angle.z));
+    return movement.amplitude * cosines;
+}
+
+glm::vec3 evaluateMovement(const CircleMovement& movement, float time)
+{
+    float angle = movement.speed * time + movement.phase;
+    return movement.radius
+        * (fastCos(angle) * movement.firstAxis
+            + fastSin(angle) * movement.secondAxis);
+}
+
+glm::vec3 evaluateMovement(const PingPongMovement& movement, float time)
+{
+    float progress = triangleWave(time / movement.period);
+    return movement.from + (movement.to - movement.from) * progress;
+}
+
+glm::vec3 evaluateMovement(const PathMovement& path, float time)
+{
+    const std::vector<glm::vec3>& points = *path.points;
+    size_t count = points.size();
+    size_t segments;
+    if (path.curve == PathMovement::Curve::CatmullRom) {
+        segments = path.loop ? count : count - 1;
+    } else {
+        // a loop shares its first point with the last segment
+        segments = path.loop ? count / 3 : (count - 1) / 3;
+    }
+    if (count == 0 || segments == 0) {
+        return count == 0 ? glm::vec3(0.0f) : points[0];
+    }
+
+    // an open path takes as long to come back
+    float progress = path.loop ? fract(time / path.duration)
+                               : triangleWave(time / (2.0f * path.duration));
+    float along = progress * segments;
+    size_t segment = std::min((size_t)along, segments - 1);
+    float t = along - segment;
+
+    if (path.curve == PathMovement::Curve::Bezier) {
+        size_t first = segment * 3;
+        return bezier(points[first], points[first + 1], points[first + 2],
+            points[(first + 3) % count], t);
+    }
+
+    auto point = [&](size_t index, int offset) {
+        if (path.loop) {
+            return points[(index + count + offset) % count];
+        }
+        // the ends are repeated so the curve stops on them
+        auto clamped = std::clamp((int64_t)index + offset, (int64_t)0,
+            (int64_t)count - 1);
+        return points[clamped];
+    };
+    return catmullRom(point(segment, -1), point(segment, 0),
+        point(segment, 1), point(segment, 2), t);
+}
+
+glm::vec3 evaluateMovement(const RandomWalkMovement& movement, float time)
+{
+    float along = std::max(time * movement.speed, 0.0f);
+    auto point = (uint32_t)along;
+    float t = along - point;
+
+    glm::vec3 offset;
+    for (uint32_t axis = 0; axis < 3; axis++) {
+        offset[axis] = catmullRom(latticeValue(movement.seed, axis, point - 1),
+            latticeValue(movement.seed, axis, point),
+            latticeValue(movement.seed, axis, point + 1),
+            latticeValue(movement.seed, axis, point + 2), t);
+    }
+    return movement.radius * offset;
+}
+
+// The same steps as fract(), fastCos() and fastSin() on registers, for
+// the kinds kept in a FloatPool
+
+#ifdef OPENAIM_SIMD_AVX2
+__m256 fract8(__m256 x)
+{
+    __m256 truncated = _mm256_cvtepi32_ps(_mm256_cvttps_epi32(x));
+    // truncation rounds negative numbers up
+    truncated = _mm256_sub_ps(truncated,
+        _mm256_and_ps(_mm256_cmp_ps(truncated, x, _CMP_GT_OQ),
+            _mm256_set1_ps(1.0f)));
+    return _mm256_sub_ps(x, truncated);
+}
+
+__m256 cos8(__m256 x)
+{
+    __m256 half = _mm256_set1_ps(0.5f);
+    __m256 twoPi = _mm256_set1_ps(TWO_PI);
+    __m256 signBit = _mm256_set1_ps(-0.0f);
+    x = _mm256_mul_ps(
+        _mm256_sub_ps(
+            fract8(_mm256_add_ps(_mm256_div_ps(x, twoPi), half)), half),
+        twoPi);
+
+    x = _mm256_andnot_ps(signBit, x);
+    __m256 flipped
+        = _mm256_cmp_ps(x, _mm256_set1_ps(PI / 2.0f), _CMP_GT_OQ);
+    x = _mm256_blendv_ps(
+        x, _mm256_sub_ps(_mm256_set1_ps(PI), x), flipped);
+
+    __m256 x2 = _mm256_mul_ps(x, x);
+    __m256 result = _mm256_set1_ps(-1.0f / 3628800.0f);
+    for (float coefficient : { 1.0f / 40320.0f, -1.0f / 720.0f,
+             1.0f / 24.0f, -1.0f / 2.0f, 1.0f }) {
+        result = _mm256_add_ps(
+            _mm256_mul_ps(result, x2), _mm256_set1_ps(coefficient));
+    }
+    return _mm256_xor_ps(result, _mm256_and_ps(flipped, signBit));
+}
+
+__m256 sin8(__m256 x)
+{
+    return cos8(_mm256_sub_ps(x, _mm256_set1_ps(PI / 2.0f)));
+}
+
+void storeOffsets8(__m256 x, __m256 y, __m256 z, glm::vec3* offsets)
+{
+    alignas(32) std::array<std::array<float, 8>, 3> axes;
+    _mm256_store_ps(axes[0].data(), x);
+    _mm256_store_ps(axes[1].data(), y);
+    _mm256_store_ps(axes[2].data(), z);
+    for (size_t i = 0; i < 8; i++) {
+        offsets[i] = glm::vec3(axes[0][i], axes[1][i], axes[2][i]);
+    }
+}
+#endif
+
+#ifdef OPENAIM_SIMD_SSE
+// SSE2 has no blendv
+__m128 select4(__m128 mask, __m128 ifSet, __m128 otherwise)
+{
+    return _mm_or_ps(_mm_and_ps(mask, ifSet), _mm_andnot_ps(mask, otherwise));
+}
+
+__m128 fract4(__m128 x)
+{
+    __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    // truncation rounds negative numbers up
+    truncated = _mm_sub_ps(truncated,
+        _mm_and_ps(_mm_cmpgt_ps(truncated, x), _mm_set1_ps(1.0f)));
+    return _mm_sub_ps(x, truncated);
+}
+
+__m128 cos4(__m128 x)
+{
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 twoPi = _mm_set1_ps(TWO_PI);
+    __m128 signBit = _mm_set1_ps(-0.0f);
+    x = _mm_mul_ps(
+        _mm_sub_ps(fract4(_mm_add_ps(_mm_div_ps(x, twoPi), half)), half),
+        twoPi);
+
+    x = _mm_andnot_ps(signBit, x);
+    __m128 flipped = _mm_cmpgt_ps(x, _mm_set1_ps(PI / 2.0f));
+    x = select4(flipped, _mm_sub_ps(_mm_set1_ps(PI), x), x);
+
+    __m128 x2 = _mm_mul_ps(x, x);
+    __m128 result = _mm_set1_ps(-1.0f / 3628800.0f);
+    for (float coefficient : { 1.0f / 40320.0f, -1.0f / 720.0f,
+             1.0f / 24.0f, -1.0f / 2.0f, 1.0f }) {
+        result
+            = _mm_add_ps(_mm_mul_ps(result, x2), _mm_set1_ps(coefficient));
+    }
+    return _mm_xor_ps(result, _mm_and_ps(flipped, signBit));
+}
+
+__m128 sin4(__m128 x)
+{
+    return cos4(_mm_sub_ps(x, _mm_set1_ps(PI / 2.0f)));
+}
+
+void storeOffsets4(__m128 x, __m128 y, __m128 z, glm::vec3* offsets)
+{
+    alignas(16) std::array<std::array<float, 4>, 3> axes;
+    _mm_store_ps(axes[0].data(), x);
+    _mm_store_ps(axes[1].data(), y);
+    _mm_store_ps(axes[2].data(), z);
+    for (size_t i = 0; i < 4; i++) {
+        offsets[i] = glm::vec3(axes[0][i], axes[1][i], axes[2][i]);
+    }
+}
+#endif
+
+// The kinds movement.glsl knows about. Packed the way it reads them, the
+// kind always goes in params[0].w
+
+template <typename Params> constexpr bool GPU_EVALUATED = false;
+template <> constexpr bool GPU_EVALUATED<LissajousMovement> = true;
+template <> constexpr bool GPU_EVALUATED<CircleMovement> = true;
+template <> constexpr bool GPU_EVALUATED<PingPongMovement> = true;
+
+void packMovement(const LissajousMovement& movement, GpuMovement& packed)
+{
+    packed.params[0] = glm::vec4(movement.amplitude, 0.0f);
+    packed.params[1] = glm::vec4(movement.frequency, 0.0f);
+    packed.params[2] = glm::vec4(movement.phase, 0.0f);
+}
+
+void packMovement(const CircleMovement& movement, GpuMovement& packed)
+{
+    packed.params[0]
+        = glm::vec4(movement.radius, movement.speed, movement.phase, 0.0f);
+    packed.params[1] = glm::vec4(movement.firstAxis, 0.0f);
+    packed.params[2] = glm::vec4(movement.secondAxis, 0.0f);
+}
+
+void packMovement(const PingPongMovement& movement, GpuMovement& packed)
+{
+    packed.params[0] = glm::vec4(movement.from, 0.0f);
+    packed.params[1] = glm::vec4(movement.to, 0.0f);
+    packed.params[2] = glm::vec4(movement.period, 0.0f, 0.0f, 0.0f);
+}
+
+}
+
+template <typename P>
+const P& MovementPools::Pool<P>::get(size_t index) const
+{
+    return params[index];
+}
+
+template <typename P>
+void MovementPools::Pool<P>::push(const Params& movement, uint32_t owner)
+{
+    params.push_back(movement);
+    owners.push_back(owner);
+}
+
+template <typename P> void MovementPools::Pool<P>::swapRemove(size_t index)
+{
+    params[index] = std::move(params.back());
+    params.pop_back();
+    owners[index] = owners.back();
+    owners.pop_back();
+}
+
+template <typename P> void MovementPools::Pool<P>::reserve(size_t count)
+{
+    params.reserve(count);
+    owners.reserve(count);
+}
+
+template <typename P>
+void MovementPools::Pool<P>::evaluate(
+    size_t first, size_t count, float time, glm::vec3* offsets) const
+{
+    for (size_t i = 0; i < count; i++) {
+        offsets[i] = evaluateMovement(params[first + i], time);
+    }
+}
+
+template <typename P> P MovementPools::FloatPool<P>::get(size_t index) const
+{
+    std::array<float, FLOAT_COUNT> floats;
+    for (size_t i = 0; i < FLOAT_COUNT; i++) {
+        floats[i] = params[i][index];
+    }
+    return std::bit_cast<Params>(floats);
+}
+
+template <typename P>
+void MovementPools::FloatPool<P>::push(
+    const Params& movement, uint32_t owner)
+{
+    auto floats = std::bit_cast<std::array<float, FLOAT_COUNT>>(movement);
+    for (size_t i = 0; i < FLOAT_COUNT; i++) {
+        params[i].push_back(floats[i]);
+    }
+    owners.push_back(owner);
+}
+
+template <typename P>
+void MovementPools::FloatPool<P>::swapRemove(size_t index)
+{
+    for (std::vector<float>& floats : params) {
+        floats[index] = floats.back();
+        floats.pop_back();
+    }
+    owners[index] = owners.back();
+    owners.pop_back();
+}
+
+template <typename P>
+void MovementPools::FloatPool<P>::reserve(size_t count)
+{
+    for (std::vector<float>& floats : params) {
+        floats.reserve(count);
+    }
+    owners.reserve(count);
+}
+
+// The kernels of the FloatPools, what doesn't fill a register goes
+// through evaluateMovement()
+
+template <>
+void MovementPools::FloatPool<LissajousMovement>::evaluate(
+    size_t first, size_t count, float time, glm::vec3* offsets) const
+{
+    constexpr size_t AMPLITUDE
+        = offsetof(LissajousMovement, amplitude) / sizeof(float);
+    constexpr size_t FREQUENCY
+        = offsetof(LissajousMovement, frequency) / sizeof(float);
+    constexpr size_t PHASE = offsetof(LissajousMovement, phase) / sizeof(float);
+
+    size_t i = 0;
+
+#ifdef OPENAIM_SIMD_AVX2
+    {
+        __m256 t = _mm256_set1_ps(time);
+        auto load = [&](size_t param) {
+            return _mm256_loadu_ps(&params[param][first + i]);
+        };
+
+        for (; i + 8 <= count; i += 8) {
+            __m256 axes[3];
+            for (size_t axis = 0; axis < 3; axis++) {
+                __m256 angle = _mm256_add_ps(
+                    _mm256_mul_ps(load(FREQUENCY + axis), t),
+                    load(PHASE + axis));
+                axes[axis]
+                    = _mm256_mul_ps(load(AMPLITUDE + axis), cos8(angle));
+            }
+            storeOffsets8(axes[0], axes[1], axes[2], &offsets[i]);
+        }
+    }
+#endif
+
+#ifdef OPENAIM_SIMD_SSE
+    {
+        __m128 t = _mm_set1_ps(time);
+        auto load = [&](size_t param) {
+            return _mm_loadu_ps(&params[param][first + i]);
+        };
+
+        for (; i + 4 <= count; i += 4) {
+            __m128 axes[3];
+            for (size_t axis = 0; axis < 3; axis++) {
+                __m128 angle = _mm_add_ps(
+                    _mm_mul_ps(load(FREQUENCY + axis), t), load(PHASE + axis));
+                axes[axis] = _mm_mul_ps(load(AMPLITUDE + axis), cos4(angle));
+            }
+            storeOffsets4(axes[0], axes[1], axes[2], &offsets[i]);
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        offsets[i] = evaluateMovement(get(first + i), time);
+    }
+}
+
+template <>
+void MovementPools::FloatPool<CircleMovement>::evaluate(
+    size_t first, size_t count, float time, glm::vec3* offsets) const
+{
+    constexpr size_t RADIUS = offsetof(CircleMovement, radius) / sizeof(float);
+    constexpr size_t SPEED = offsetof(CircleMovement, speed) / sizeof(float);
+    constexpr size_t PHASE = offsetof(CircleMovement, phase) / sizeof(float);
+    constexpr size_t FIRST_AXIS
+        = offsetof(CircleMovement, firstAxis) / sizeof(float);
+    constexpr size_t SECOND_AXIS
+        = offsetof(CircleMovement, secondAxis) / sizeof(float);
+
+    size_t i = 0;
+
+#ifdef OPENAIM_SIMD_AVX2
+    {
+        __m256 t = _mm256_set1_ps(time);
+        auto load = [&](size_t param) {
+            return _mm256_loadu_ps(&params[param][first + i]);
+        };
+
+        for (; i + 8 <= count; i += 8) {
+            __m256 angle = _mm256_add_ps(
+                _mm256_mul_ps(load(SPEED), t), load(PHASE));
+            __m256 radius = load(RADIUS);
+            __m256 cosine = _mm256_mul_ps(radius, cos8(angle));
+            __m256 sine = _mm256_mul_ps(radius, sin8(angle));
+
+            __m256 axes[3];
+            for (size_t axis = 0; axis < 3; axis++) {
+                axes[axis] = _mm256_add_ps(
+                    _mm256_mul_ps(cosine, load(FIRST_AXIS + axis)),
+                    _mm256_mul_ps(sine, load(SECOND_AXIS + axis)));
+            }
+            storeOffsets8(axes[0], axes[1], axes[2], &offsets[i]);
+        }
+    }
+#endif
+
+#ifdef OPENAIM_SIMD_SSE
+    {
+        __m128 t = _mm_set1_ps(time);
+        auto load = [&](size_t param) {
+            return _mm_loadu_ps(&params[param][first + i]);
+        };
+
+        for (; i + 4 <= count; i += 4) {
+            __m128 angle
+                = _mm_add_ps(_mm_mul_ps(load(SPEED), t), load(PHASE));
+            __m128 radius = load(RADIUS);
+            __m128 cosine = _mm_mul_ps(radius, cos4(angle));
+            __m128 sine = _mm_mul_ps(radius, sin4(angle));
+
+            __m128 axes[3];
+            for (size_t axis = 0; axis < 3; axis++) {
+                axes[axis]
+                    = _mm_add_ps(_mm_mul_ps(cosine, load(FIRST_AXIS + axis)),
+                        _mm_mul_ps(sine, load(SECOND_AXIS + axis)));
+            }
+            storeOffsets4(axes[0], axes[1], axes[2], &offsets[i]);
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        offsets[i] = evaluateMovement(get(first + i), time);
+    }
+}
+
+template <>
+void MovementPools::FloatPool<PingPongMovement>::evaluate(
+    size_t first, size_t count, float time, glm::vec3* offsets) const
+{
+    constexpr size_t FROM = offsetof(PingPongMovement, from) / sizeof(float);
+    constexpr size_t TO = offsetof(PingPongMovement, to) / sizeof(float);
+    constexpr size_t PERIOD
+        = offsetof(PingPongMovement, period) / sizeof(float);
+
+    size_t i = 0;
+
+#ifdef OPENAIM_SIMD_AVX2
+    {
+        __m256 t = _mm256_set1_ps(time);
+        __m256 one = _mm256_set1_ps(1.0f);
+        __m256 signBit = _mm256_set1_ps(-0.0f);
+        auto load = [&](size_t param) {
+            return _mm256_loadu_ps(&params[param][first + i]);
+        };
+
+        for (; i + 8 <= count; i += 8) {
+            // triangleWave()
+            __m256 wave = _mm256_sub_ps(
+                _mm256_mul_ps(_mm256_set1_ps(2.0f),
+                    fract8(_mm256_div_ps(t, load(PERIOD)))),
+                one);
+            __m256 progress
+                = _mm256_sub_ps(one, _mm256_andnot_ps(signBit, wave));
+
+            __m256 axes[3];
+            for (size_t axis = 0; axis < 3; axis++) {
+                __m256 from = load(FROM + axis);
+                axes[axis] = _mm256_add_ps(from,
+                    _mm256_mul_ps(
+                        _mm256_sub_ps(load(TO + axis), from), progress));
+            }
+            storeOffsets8(axes[0], axes[1], axes[2], &offsets[i]);
+        }
+    }
+#endif
+
+#ifdef OPENAIM_SIMD_SSE
+    {
+        __m128 t = _mm_set1_ps(time);
+        __m128 one = _mm_set1_ps(1.0f);
+        __m128 signBit = _mm_set1_ps(-0.0f);
+        auto load = [&](size_t param) {
+            return _mm_loadu_ps(&params[param][first + i]);
+        };
+
+        for (; i + 4 <= count; i += 4) {
+            // triangleWave()
+            __m128 wave = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(2.0f),
+                                         fract4(_mm_div_ps(t, load(PERIOD)))),
+                one);
+            __m128 progress = _mm_sub_ps(one, _mm_andnot_ps(signBit, wave));
+
+            __m128 axes[3];
+            for (size_t axis = 0; axis < 3; axis++) {
+                __m128 from = load(FROM + axis);
+                axes[axis] = _mm_add_ps(from,
+                    _mm_mul_ps(_mm_sub_ps(load(TO + axis), from), progress));
+            }
+            storeOffsets4(axes[0], axes[1], axes[2], &offsets[i]);
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        offsets[i] = evaluateMovement(get(first + i), time);
+    }
+}
+
+template <typename Fn>
+decltype(auto) MovementPools::visitPool(uint8_t kind, Fn fn)
+{
+    switch (kind) {
+    case 0:
+        return fn(m_lissajous);
+    case 1:
+        return fn(m_circles);
+    case 2:
+        return fn(m_pingPongs);
+    case 3:
+        return fn(m_paths);
+    default:
+        return fn(m_randomWalks);
+    }
+}
+
+template <typename Fn>
+decltype(auto) MovementPools::visitPool(uint8_t kind, Fn fn) const
+{
+    switch (kind) {
+    case 0:
+        return fn(m_lissajous);
+    case 1:
+        return fn(m_circles);
+    case 2:
+        return fn(m_pingPongs);
+    case 3:
+        return fn(m_paths);
+    default:
+        return fn(m_randomWalks);
+    }
+}
+
+MovementSlot MovementPools::add(const Movement& movement, uint32_t owner)
+{
+    auto kind = (uint8_t)movement.index();
+    return visitPool(kind, [&](auto& pool) {
+        using Params = typename std::decay_t<decltype(pool)>::Params;
+        pool.push(std::get<Params>(movement), owner);
+        return MovementSlot { kind, (uint32_t)pool.owners.size() - 1 };
+    });
+}
+
+std::optional<uint32_t> MovementPools::swapRemove(MovementSlot slot)
+{
+    return visitPool(slot.kind, [&](auto& pool) -> std::optional<uint32_t> {
+        pool.swapRemove(slot.index);
+
+        if (slot.index == pool.owners.size()) {
+            return std::nullopt;
+        }
+        return pool.owners[slot.index];
+    });
+}
+
+void MovementPools::setOwner(MovementSlot slot, uint32_t owner)
+{
+    visitPool(slot.kind, [&](auto& pool) { pool.owners[slot.index] = owner; });
+}
+
+void MovementPools::clear()
+{
+    m_lissajous = {};
+    m_circles = {};
+    m_pingPongs = {};
+    m_paths = {};
+    m_randomWalks = {};
+}
+
+void MovementPools::reserve(size_t count)
+{
+    for (uint8_t kind = 0; kind < std::variant_size_v<Movement>; kind++) {
+        visitPool(kind, [&](auto& pool) { pool.reserve(count); });
+    }
+}
+
+size_t MovementPools::size() const
+{
+    return m_lissajous.owners.size() + m_circles.owners.size()
+        + m_pingPongs.owners.size() + m_paths.owners.size()
+        + m_randomWalks.owners.size();
+}
+
+void MovementPools::evaluate(float timeSeconds, MovementFilter filter,
+    JobSystem& jobs, std::vector<glm::vec3>& offsets,
+    std::vector<uint32_t>& owners) const
+{
+    // where the offsets of each pool that passes the filter start
+    struct Segment {
+        uint8_t kind;
+        size_t first;
+        size_t count;
+    };
+    std::array<Segment, std::variant_size_v<Movement>> segments;
+    size_t segmentCount = 0;
+
+    owners.clear();
+    auto addSegment = [&](uint8_t kind) {
+        visitPool(kind, [&](const auto& pool) {
+            using Params = typename std::decay_t<decltype(pool)>::Params;
+            if ((filter == MovementFilter::CpuOnly && GPU_EVALUATED<Params>)
+                || (filter == MovementFilter::GpuOnly
+                    && !GPU_EVALUATED<Params>)) {
+                return;
+            }
+
+            segments[segmentCount++]
+                = { kind, owners.size(), pool.owners.size() };
+            owners.insert(
+                owners.end(), pool.owners.begin(), pool.owners.end());
+        });
+    };
+    for (uint8_t kind = 0; kind < segments.size(); kind++) {
+        addSegment(kind);
+    }
+    offsets.resize(owners.size());
+
+    // a range can cover the end of one pool and the start of the next
+    jobs.parallelFor(
+        owners.size(), MOVEMENTS_PER_JOB, [&](size_t begin, size_t end) {
+            for (size_t i = 0; i < segmentCount; i++) {
+                const Segment& segment = segments[i];
+                size_t from = std::max(begin, segment.first);
+                size_t to = std::min(end, segment.first + segment.count);
+                if (from >= to) {
+                    continue;
+                }
+
+                visitPool(segment.kind, [&](const auto& pool) {
+                    pool.evaluate(from - segment.first, to - from,
+                        timeSeconds, offsets.data() + from);
+                });
+            }
+        });
+}
+
+glm::vec3 MovementPools::evaluate(MovementSlot slot, float timeSeconds) const
+{
+    return visitPool(slot.kind, [&](const auto& pool) {
+        return evaluateMovement(pool.get(slot.index), timeSeconds);
+    });
+}
+
+bool MovementPools::gpuEvaluated(MovementSlot slot) const
+{
+    return visitPool(slot.kind, [](const auto& pool) {
+        using Params = typename std::decay_t<decltype(pool)>::Params;
+        return GPU_EVALUATED<Params>;
+    });
+}
+
+bool MovementPools::packForGpu(MovementSlot slot, GpuMovement& packed) const
+{
+    return visitPool(slot.kind, [&](const auto& pool) {
+        using Params = typename std::decay_t<decltype(pool)>::Params;
+        if constexpr (GPU_EVALUATED<Params>) {
+            packMovement(pool.get(slot.index), packed);
+            packed.params[0].w = slot.kind;
+            return true;
+        } else {
+            return false;
+        }
+    });
+}
+
+float fastCos(float x)
+{
+    // down to [-pi, pi]
+    x = (fract(x / TWO_PI + 0.5f) - 0.5f) * TWO_PI;
+
+    // then to [0, pi / 2], cos(pi - x) being -cos(x)
+    x = std::abs(x);
+    bool flipped = x > PI / 2.0f;
+    x = flipped ? PI - x : x;
+
+    // Taylor series up to x^10, off by less than (pi / 2)^12 / 12!
+    float x2 = x * x;
+    float result = -1.0f / 3628800.0f;
+    result = result * x2 + 1.0f / 40320.0f;
+    result = result * x2 - 1.0f / 720.0f;
+    result = result * x2 + 1.0f / 24.0f;
+    result = result * x2 - 1.0f / 2.0f;
+    result = result * x2 + 1.0f;
+    return flipped ? -result : result;
+}
+
+float fastSin(float x)
+{
+    return fastCos(x - PI / 2.0f);
+}
\ No newline at end of file
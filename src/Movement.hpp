@@ -0,0 +1,184 @@
+#pragma once
+
+#include "JobSystem.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <variant>
+#include <vector>
+
+// Movements are closed form: the offset of a target from its referential
+// only depends on the time, so nothing has to be stepped and any time can
+// be evaluated directly. Times are in seconds and angles in radians
+
+// amplitude * cos(frequency * time + phase) on each axis
+struct LissajousMovement {
+    glm::vec3 amplitude = glm::vec3(0.0f);
+    glm::vec3 frequency = glm::vec3(1.0f);
+    glm::vec3 phase = glm::vec3(0.0f);
+};
+
+// Around the referential, in the plane of the two axes
+struct CircleMovement {
+    float radius = 1.0f;
+    float speed = 1.0f;
+    float phase = 0.0f;
+    glm::vec3 firstAxis = glm::vec3(1.0f, 0.0f, 0.0f);
+    glm::vec3 secondAxis = glm::vec3(0.0f, 1.0f, 0.0f);
+};
+
+// Back and forth between from and to, at a constant speed
+struct PingPongMovement {
+    glm::vec3 from = glm::vec3(0.0f);
+    glm::vec3 to = glm::vec3(0.0f);
+    // for a round trip
+    float period = 1.0f;
+};
+
+struct PathMovement {
+    enum class Curve {
+        // cubic segments, every third point is on the path and the ones
+        // in between pull it towards them
+        Bezier,
+        // goes through every point
+        CatmullRom,
+    };
+
+    Curve curve = Curve::CatmullRom;
+    // never null, shared by the copies so spawning a target from its
+    // prefab doesn't allocate
+    std::shared_ptr<const std::vector<glm::vec3>> points
+        = std::make_shared<const std::vector<glm::vec3>>();
+    // to go through the path once
+    float duration = 1.0f;
+    // goes back to the first point after the last one if set, otherwise
+    // goes back along the path
+    bool loop = false;
+};
+
+// Wanders around smoothly, the same way every time for a given seed
+struct RandomWalkMovement {
+    uint32_t seed = 0;
+    // how far it can get from the referential on each axis
+    glm::vec3 radius = glm::vec3(1.0f);
+    // changes of direction per second, roughly
+    float speed = 1.0f;
+};
+
+using Movement = std::variant<LissajousMovement, CircleMovement,
+    PingPongMovement, PathMovement, RandomWalkMovement>;
+
+// Where a movement is stored in the MovementPools. kind is the index of
+// its type in Movement
+struct MovementSlot {
+    uint8_t kind;
+    uint32_t index;
+};
+
+// One movement as movement.glsl reads it from a std430 buffer. What's in
+// params depends on the kind, which is params[0].w (-1 for none)
+struct GpuMovement {
+    std::array<glm::vec4, 3> params;
+};
+
+enum class MovementFilter {
+    All,
+    // the kinds movement.glsl can't evaluate
+    CpuOnly,
+    // the kinds it can
+    GpuOnly,
+};
+
+// Movements of every moving target, in one pool per kind holding the
+// plain parameters of that kind. A pool is evaluated in one loop with
+// no branching on the kind. The simple kinds keep each of their floats
+// in its own array and are evaluated 8 or 4 at a time with AVX2 or SSE2
+// (see Simd.hpp). They can also be evaluated by model.vert (see
+// movement.glsl)
+class MovementPools {
+public:
+    MovementPools() = default;
+
+    // owner is whatever the movement belongs to, the pools don't use it
+    MovementSlot add(const Movement& movement, uint32_t owner);
+    // Moves the last movement of the same kind to the slot. Returns the
+    // owner of that one if it isn't the one removed
+    std::optional<uint32_t> swapRemove(MovementSlot slot);
+    void setOwner(MovementSlot slot, uint32_t owner);
+    void clear();
+    // Makes room for count movements of each kind
+    void reserve(size_t count);
+
+    size_t size() const;
+
+    // Offset from the referential of every movement that passes the
+    // filter at timeSeconds, with the owner of each at the same index.
+    // The kernels are split over the threads of jobs
+    void evaluate(float timeSeconds, MovementFilter filter, JobSystem& jobs,
+        std::vector<glm::vec3>& offsets, std::vector<uint32_t>& owners) const;
+    glm::vec3 evaluate(MovementSlot slot, float timeSeconds) const;
+
+    // Whether movement.glsl can evaluate the movement, the same way as
+    // evaluate() does
+    bool gpuEvaluated(MovementSlot slot) const;
+    // Returns false if the GPU can't evaluate the movement
+    bool packForGpu(MovementSlot slot, GpuMovement& packed) const;
+
+private:
+    // One struct per movement
+    template <typename P> struct Pool {
+        using Params = P;
+
+        std::vector<Params> params;
+        std::vector<uint32_t> owners;
+
+        const Params& get(size_t index) const;
+        void push(const Params& movement, uint32_t owner);
+        // Moves the last movement to index
+        void swapRemove(size_t index);
+        void reserve(size_t count);
+        void evaluate(size_t first, size_t count, float time,
+            glm::vec3* offsets) const;
+    };
+
+    // For the kinds that are only floats, one array per float of the
+    // parameters (in the order of the members) so the kernels can load
+    // them a register at a time
+    template <typename P> struct FloatPool {
+        using Params = P;
+        static constexpr size_t FLOAT_COUNT = sizeof(Params) / sizeof(float);
+
+        std::array<std::vector<float>, FLOAT_COUNT> params;
+        std::vector<uint32_t> owners;
+
+        Params get(size_t index) const;
+        void push(const Params& movement, uint32_t owner);
+        // Moves the last movement to index
+        void swapRemove(size_t index);
+        void reserve(size_t count);
+        void evaluate(size_t first, size_t count, float time,
+            glm::vec3* offsets) const;
+    };
+
+    template <typename Fn> decltype(auto) visitPool(uint8_t kind, Fn fn);
+    template <typename Fn>
+    decltype(auto) visitPool(uint8_t kind, Fn fn) const;
+
+    FloatPool<LissajousMovement> m_lissajous;
+    FloatPool<CircleMovement> m_circles;
+    FloatPool<PingPongMovement> m_pingPongs;
+    Pool<PathMovement> m_paths;
+    Pool<RandomWalkMovement> m_randomWalks;
+};
+
+// cos(x) without branches or calls, the SIMD kernels of MovementPools do
+// the same steps on whole registers. Within about 1e-6 for small angles,
+// reducing big ones to [-pi, pi] in floats costs some precision (1e-4
+// around 1000)
+float fastCos(float x);
+float fastSin(float x);
\ No newline at end of file
@@ -29,35 +29,31 @@
 #define MAX_ELEMENT_BUFFER 128 * 1024
 #define MAX_FIELD_SIZE 32
 
-// this whole function is bad...
 // interfacing with C strings is annoying
-SettingsData::SettingsData(const InternalSettingsData& data)
+static std::optional<float> parseNumberField(const nk_text_edit& edit)
 {
-    assert(data.sensitivity.string.len < MAX_FIELD_SIZE - 1);
-    assert(data.maxFps.string.len < MAX_FIELD_SIZE - 1);
+    assert(edit.string.len < MAX_FIELD_SIZE - 1);
 
     char* endPtr = nullptr;
     char buf[MAX_FIELD_SIZE];
-    std::strncpy(buf, nk_str_get_const(&data.sensitivity.string),
-        data.sensitivity.string.len);
+    std::memset(buf, 0, MAX_FIELD_SIZE);
+    std::strncpy(buf, nk_str_get_const(&edit.string), edit.string.len);
     buf[MAX_FIELD_SIZE - 1] = '\0';
     float value = std::strtof(buf, &endPtr);
-    if (endPtr - buf == data.sensitivity.string.len) { // no error
-        sensitivity = value;
-    } else {
-        sensitivity = std::nullopt;
+    if (endPtr - buf == edit.string.len) { // no error
+        return value;
     }
 
-    std::memset(buf, 0, MAX_FIELD_SIZE);
-    std::strncpy(
-        buf, nk_str_get_const(&data.maxFps.string), data.maxFps.string.len);
-    buf[MAX_FIELD_SIZE - 1] = '\0';
-    value = std::strtof(buf, &endPtr);
-    if (endPtr - buf == data.maxFps.string.len) { // no error
-        maxFps = value;
-    } else {
-        maxFps = std::nullopt;
-    }
+    return std::nullopt;
+}
+
+SettingsData::SettingsData(const InternalSettingsData& data)
+{
+    sensitivity = parseNumberField(data.sensitivity);
+    maxFps = parseNumberField(data.maxFps);
+    maxFramesInFlight = parseNumberField(data.maxFramesInFlight);
+    frameTimeBudget = parseNumberField(data.frameTimeBudget);
+    workerThreads = parseNumberField(data.workerThreads);
 
     crosshairColor.r = data.crosshairColor.r;
     crosshairColor.g = data.crosshairColor.g;
@@ -66,6 +62,12 @@ SettingsData::SettingsData(const InternalSettingsData& data)
     targetColor.r = data.targetColor.r;
     targetColor.g = data.targetColor.g;
     targetColor.b = data.targetColor.b;
+
+    lateLatch = data.lateLatch;
+    lateWarp = data.lateWarp;
+    latencyOverlay = data.latencyOverlay;
+    gpuMovement = data.gpuMovement;
+    hitTestMode = (HitTestMode)data.hitTestMode;
 }
 
 NuklearWrapper::NuklearWrapper(GLFWwindow* window)
@@ -93,6 +95,18 @@ NuklearWrapper::NuklearWrapper(GLFWwindow* window)
     nk_str_append_str_char(&m_unsavedSettings.sensitivity.string, "2.5");
     nk_textedit_init_default(&m_unsavedSettings.maxFps);
     nk_str_append_str_char(&m_unsavedSettings.maxFps.string, "300");
+    nk_textedit_init_default(&m_unsavedSettings.maxFramesInFlight);
+    nk_str_append_str_char(&m_unsavedSettings.maxFramesInFlight.string, "1");
+    nk_textedit_init_default(&m_unsavedSettings.frameTimeBudget);
+    nk_str_append_str_char(&m_unsavedSettings.frameTimeBudget.string, "0");
+    nk_textedit_init_default(&m_unsavedSettings.workerThreads);
+    nk_str_append_str_char(&m_unsavedSettings.workerThreads.string, "0");
+
+    m_unsavedSettings.lateLatch = true;
+    m_unsavedSettings.lateWarp = false;
+    m_unsavedSettings.latencyOverlay = false;
+    m_unsavedSettings.gpuMovement = false;
+    m_unsavedSettings.hitTestMode = (int)HitTestMode::Colliders;
 }
 
 void NuklearWrapper::renderBegin()
@@ -167,8 +181,24 @@ std::optional<SettingsData> NuklearWrapper::renderPauseMenu()
         renderNumberTextField(
             "Max FPS (0 for uncapped): ", m_unsavedSettings.maxFps);
         renderNumberTextField("Sensitivity:", m_unsavedSettings.sensitivity);
+        renderNumberTextField(
+            "Max frames in flight:", m_unsavedSettings.maxFramesInFlight);
+        renderNumberTextField("Frame time budget (ms, 0 for off):",
+            m_unsavedSettings.frameTimeBudget);
+        // 1 runs everything on the main thread, in order
+        renderNumberTextField("Worker threads (0 for one per core):",
+            m_unsavedSettings.workerThreads);
         renderColorPicker("Crosshair color:", m_unsavedSettings.crosshairColor);
         renderColorPicker("Target color:", m_unsavedSettings.targetColor);
+        renderCheckbox("Late latch camera", m_unsavedSettings.lateLatch);
+        renderCheckbox("Late warp", m_unsavedSettings.lateWarp);
+        renderCheckbox("Latency overlay", m_unsavedSettings.latencyOverlay);
+        renderCheckbox(
+            "Animate targets on the GPU", m_unsavedSettings.gpuMovement);
+        // same order as HitTestMode
+        renderCombobox("Hit test:",
+            { "Colliders", "ID buffer", "Colliders, checked by ID buffer" },
+            m_unsavedSettings.hitTestMode);
 
         if (nk_button_label(m_ctx, "Save")) {
             result = SettingsData(m_unsavedSettings);
@@ -258,6 +288,53 @@ bool NuklearWrapper::renderChallengeEndStats(int shotsHit, int totalShots)
     return result;
 }
 
+void NuklearWrapper::renderLatencyOverlay(const LatencyTracker& tracker)
+{
+    if (nk_begin(m_ctx, "Latency", nk_rect(m_width - 290, 10, 280, 210),
+            NK_WINDOW_BORDER | NK_WINDOW_TITLE)) {
+        const auto formatHistogram
+            = [](const std::string& name, const Histogram& histogram) {
+                  return std::format("{}: {:.1f} / {:.1f} / {:.1f} ms", name,
+                      histogram.percentile(0.5f), histogram.percentile(0.99f),
+                      histogram.max());
+              };
+
+        std::array<std::string, 5> labels = {
+            "p50 / p99 / max",
+            formatHistogram("Click to submit", tracker.clickToSubmit()),
+            formatHistogram("Click to GPU", tracker.clickToGpuComplete()),
+            formatHistogram("Frame to frame", tracker.frameToFrame()),
+            std::format("Clicks measured: {}",
+                tracker.clickToGpuComplete().count()),
+        };
+
+        for (auto& label : labels) {
+            nk_layout_row_dynamic(m_ctx, 20, 1);
+            nk_label(m_ctx, label.c_str(), NK_TEXT_LEFT);
+        }
+    }
+
+    nk_end(m_ctx);
+}
+
+void NuklearWrapper::renderHitTestCheck(size_t checks, size_t mismatches)
+{
+    if (nk_begin(m_ctx, "Hit test check", nk_rect(10, 270, 200, 100),
+            NK_WINDOW_BORDER | NK_WINDOW_TITLE)) {
+        std::array<std::string, 2> labels = {
+            std::format("Pellets checked: {}", checks),
+            std::format("Mismatches: {}", mismatches),
+        };
+
+        for (auto& label : labels) {
+            nk_layout_row_dynamic(m_ctx, 20, 1);
+            nk_label(m_ctx, label.c_str(), NK_TEXT_LEFT);
+        }
+    }
+
+    nk_end(m_ctx);
+}
+
 void NuklearWrapper::renderEnd()
 {
     nk_glfw3_render(NK_ANTI_ALIASING_ON);
@@ -282,6 +359,22 @@ void NuklearWrapper::renderColorPicker(
     }
 }
 
+void NuklearWrapper::renderCheckbox(const std::string& label, nk_bool& value)
+{
+    nk_layout_row_dynamic(m_ctx, 20, 1);
+    nk_checkbox_label(m_ctx, label.c_str(), &value);
+}
+
+void NuklearWrapper::renderCombobox(const std::string& label,
+    std::vector<const char*> options, int& selected)
+{
+    nk_layout_row_dynamic(m_ctx, 20, 1);
+    nk_label(m_ctx, label.c_str(), NK_TEXT_LEFT);
+    nk_layout_row_dynamic(m_ctx, 25, 1);
+    nk_combobox(m_ctx, options.data(), options.size(), &selected, 20,
+        nk_vec2(nk_widget_width(m_ctx), 100));
+}
+
 void NuklearWrapper::renderNumberTextField(
     const std::string& label, nk_text_edit& edit)
 {
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "GpuPicker.hpp"
+#include "LatencyTracker.hpp"
 #include "Scenario.hpp"
 
 #include <optional>
@@ -24,6 +26,15 @@ struct InternalSettingsData {
     nk_colorf crosshairColor;
     nk_colorf targetColor;
     nk_text_edit maxFps;
+    nk_text_edit maxFramesInFlight;
+    nk_text_edit frameTimeBudget;
+    nk_text_edit workerThreads;
+    nk_bool lateLatch;
+    nk_bool lateWarp;
+    nk_bool latencyOverlay;
+    nk_bool gpuMovement;
+    // index in HitTestMode
+    int hitTestMode;
 };
 
 struct SettingsData {
@@ -31,8 +42,16 @@ struct SettingsData {
 
     std::optional<float> sensitivity;
     std::optional<float> maxFps;
+    std::optional<float> maxFramesInFlight;
+    std::optional<float> frameTimeBudget;
+    std::optional<float> workerThreads;
     glm::vec3 crosshairColor;
     glm::vec3 targetColor;
+    bool lateLatch;
+    bool lateWarp;
+    bool latencyOverlay;
+    bool gpuMovement;
+    HitTestMode hitTestMode;
 };
 
 struct MenuData {
@@ -59,11 +78,16 @@ public:
     void renderChallengeData(
         int shotsHit, int totalShots, float timeRemainingSeconds, float fps);
     bool renderChallengeEndStats(int shotsHit, int totalShots);
+    void renderLatencyOverlay(const LatencyTracker& tracker);
+    void renderHitTestCheck(size_t checks, size_t mismatches);
     static void renderEnd();
 
 private:
     void renderColorPicker(const std::string& name, nk_colorf& color);
     void renderNumberTextField(const std::string& label, nk_text_edit& edit);
+    void renderCheckbox(const std::string& label, nk_bool& value);
+    void renderCombobox(const std::string& label,
+        std::vector<const char*> options, int& selected);
 
     static nk_bool numbersOnlyFilter(const nk_text_edit*, nk_rune unicode);
 
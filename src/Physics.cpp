@@ -0,0 +1,290 @@
+#include "Physics.hpp"
+
+#include "Simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// a tick of a thousand bodies only takes a few microseconds
+constexpr size_t BODIES_PER_JOB = 1024;
+// After a long hitch it's better to drop time than to catch up, which
+// would make the next frame even longer
+constexpr size_t MAX_TICKS_PER_ADVANCE = 30;
+
+template <typename T> void swapRemoveFrom(std::vector<T>& values, size_t index)
+{
+    values[index] = values.back();
+    values.pop_back();
+}
+
+// One axis of one body for one tick: semi-implicit Euler, then a bounce
+// off whichever side of the arena it went through. The SIMD loops do
+// exactly this for each lane, in the same order, so they agree with it
+void stepAxis(float& pos, float& velocity, float gravity, float halfSize,
+    float restitution, float arenaMin, float arenaMax)
+{
+    velocity += gravity * PHYSICS_TICK_SECONDS;
+    pos += velocity * PHYSICS_TICK_SECONDS;
+
+    float low = arenaMin + halfSize;
+    float high = arenaMax - halfSize;
+    float bounced = std::abs(velocity) * restitution;
+    if (pos < low) {
+        pos = low;
+        velocity = bounced;
+    }
+    if (pos > high) {
+        pos = high;
+        velocity = -bounced;
+    }
+}
+
+}
+
+uint32_t PhysicsBodies::add(const PhysicsBody& body, const glm::vec3& pos,
+    const glm::vec3& halfSize, uint32_t owner)
+{
+    for (int axis = 0; axis < 3; axis++) {
+        m_pos[axis].push_back(pos[axis]);
+        m_previousPos[axis].push_back(pos[axis]);
+        m_velocity[axis].push_back(body.velocity[axis]);
+        m_gravity[axis].push_back(body.gravity[axis]);
+        m_halfSize[axis].push_back(halfSize[axis]);
+    }
+    m_restitution.push_back(body.restitution);
+    m_startVelocity.push_back(body.velocity);
+    m_owners.push_back(owner);
+
+    return (uint32_t)m_owners.size() - 1;
+}
+
+std::optional<uint32_t> PhysicsBodies::swapRemove(uint32_t index)
+{
+    for (int axis = 0; axis < 3; axis++) {
+        swapRemoveFrom(m_pos[axis], index);
+        swapRemoveFrom(m_previousPos[axis], index);
+        swapRemoveFrom(m_velocity[axis], index);
+        swapRemoveFrom(m_gravity[axis], index);
+        swapRemoveFrom(m_halfSize[axis], index);
+    }
+    swapRemoveFrom(m_restitution, index);
+    swapRemoveFrom(m_startVelocity, index);
+    swapRemoveFrom(m_owners, index);
+
+    if (index == m_owners.size()) {
+        return std::nullopt;
+    }
+    return m_owners[index];
+}
+
+void PhysicsBodies::setOwner(uint32_t index, uint32_t owner)
+{
+    m_owners[index] = owner;
+}
+
+void PhysicsBodies::reserve(size_t count)
+{
+    for (int axis = 0; axis < 3; axis++) {
+        m_pos[axis].reserve(count);
+        m_previousPos[axis].reserve(count);
+        m_velocity[axis].reserve(count);
+        m_gravity[axis].reserve(count);
+        m_halfSize[axis].reserve(count);
+    }
+    m_restitution.reserve(count);
+    m_startVelocity.reserve(count);
+    m_owners.reserve(count);
+}
+
+size_t PhysicsBodies::size() const
+{
+    return m_owners.size();
+}
+
+const std::vector<uint32_t>& PhysicsBodies::owners() const
+{
+    return m_owners;
+}
+
+void PhysicsBodies::setArena(const Aabb& arena)
+{
+    m_arena = arena;
+}
+
+void PhysicsBodies::restart(uint32_t index, const glm::vec3& pos)
+{
+    for (int axis = 0; axis < 3; axis++) {
+        m_pos[axis][index] = pos[axis];
+        m_previousPos[axis][index] = pos[axis];
+        m_velocity[axis][index] = m_startVelocity[index][axis];
+    }
+}
+
+void PhysicsBodies::push(uint32_t index, const glm::vec3& offset)
+{
+    float length = glm::length(offset);
+    if (length == 0.0f) {
+        return;
+    }
+
+    glm::vec3 velocity;
+    for (int axis = 0; axis < 3; axis++) {
+        m_pos[axis][index] += offset[axis];
+        m_previousPos[axis][index] += offset[axis];
+        velocity[axis] = m_velocity[axis][index];
+    }
+
+    // same as a bounce off a wall facing the offset
+    glm::vec3 normal = offset / length;
+    float towards = glm::dot(velocity, normal);
+    if (towards < 0.0f) {
+        velocity -= (1.0f + m_restitution[index]) * towards * normal;
+        for (int axis = 0; axis < 3; axis++) {
+            m_velocity[axis][index] = velocity[axis];
+        }
+    }
+}
+
+void PhysicsBodies::advanceTo(float timeSeconds, JobSystem& jobs)
+{
+    if (timeSeconds < m_time) {
+        m_time = timeSeconds;
+        m_blend = 1.0f;
+        return;
+    }
+
+    auto ticks = (size_t)((timeSeconds - m_time) / PHYSICS_TICK_SECONDS);
+    if (ticks > MAX_TICKS_PER_ADVANCE) {
+        // the time past those ticks is dropped, apart from the fraction
+        // of a tick still to come, so the blend stays in [0, 1)
+        ticks = MAX_TICKS_PER_ADVANCE;
+        m_time = timeSeconds
+            - std::fmod(timeSeconds - m_time, PHYSICS_TICK_SECONDS);
+    } else {
+        m_time += (double)ticks * PHYSICS_TICK_SECONDS;
+    }
+    m_blend = (float)((timeSeconds - m_time) / PHYSICS_TICK_SECONDS);
+
+    if (ticks == 0) {
+        return;
+    }
+
+    // every tick of a range in one job, the range stays in cache from
+    // one tick to the next
+    jobs.parallelFor(size(), BODIES_PER_JOB, [&](size_t begin, size_t end) {
+        for (size_t tick = 0; tick < ticks; tick++) {
+            if (tick + 1 == ticks) {
+                for (int axis = 0; axis < 3; axis++) {
+                    std::copy(m_pos[axis].begin() + begin,
+                        m_pos[axis].begin() + end,
+                        m_previousPos[axis].begin() + begin);
+                }
+            }
+            step(begin, end);
+        }
+    });
+}
+
+glm::vec3 PhysicsBodies::position(uint32_t index) const
+{
+    glm::vec3 previous(m_previousPos[0][index], m_previousPos[1][index],
+        m_previousPos[2][index]);
+    glm::vec3 current(m_pos[0][index], m_pos[1][index], m_pos[2][index]);
+    return previous + (current - previous) * m_blend;
+}
+
+void PhysicsBodies::step(size_t begin, size_t end)
+{
+    for (int axis = 0; axis < 3; axis++) {
+        float* pos = m_pos[axis].data();
+        float* velocity = m_velocity[axis].data();
+        const float* gravity = m_gravity[axis].data();
+        const float* halfSize = m_halfSize[axis].data();
+        const float* restitution = m_restitution.data();
+        float arenaMin = m_arena.min[axis];
+        float arenaMax = m_arena.max[axis];
+
+        size_t i = begin;
+
+#ifdef OPENAIM_SIMD_AVX2
+        {
+            __m256 tick = _mm256_set1_ps(PHYSICS_TICK_SECONDS);
+            __m256 minimum = _mm256_set1_ps(arenaMin);
+            __m256 maximum = _mm256_set1_ps(arenaMax);
+            __m256 signBit = _mm256_set1_ps(-0.0f);
+
+            for (; i + 8 <= end; i += 8) {
+                __m256 p = _mm256_loadu_ps(&pos[i]);
+                __m256 v = _mm256_loadu_ps(&velocity[i]);
+                __m256 half = _mm256_loadu_ps(&halfSize[i]);
+
+                v = _mm256_add_ps(
+                    v, _mm256_mul_ps(_mm256_loadu_ps(&gravity[i]), tick));
+                p = _mm256_add_ps(p, _mm256_mul_ps(v, tick));
+
+                __m256 low = _mm256_add_ps(minimum, half);
+                __m256 high = _mm256_sub_ps(maximum, half);
+                __m256 bounced = _mm256_mul_ps(_mm256_andnot_ps(signBit, v),
+                    _mm256_loadu_ps(&restitution[i]));
+
+                __m256 below = _mm256_cmp_ps(p, low, _CMP_LT_OQ);
+                p = _mm256_blendv_ps(p, low, below);
+                v = _mm256_blendv_ps(v, bounced, below);
+                __m256 above = _mm256_cmp_ps(p, high, _CMP_GT_OQ);
+                p = _mm256_blendv_ps(p, high, above);
+                v = _mm256_blendv_ps(
+                    v, _mm256_xor_ps(bounced, signBit), above);
+
+                _mm256_storeu_ps(&pos[i], p);
+                _mm256_storeu_ps(&velocity[i], v);
+            }
+        }
+#endif
+
+#ifdef OPENAIM_SIMD_SSE
+        {
+            // SSE2 has no blendv
+            auto select = [](__m128 mask, __m128 ifSet, __m128 otherwise) {
+                return _mm_or_ps(_mm_and_ps(mask, ifSet),
+                    _mm_andnot_ps(mask, otherwise));
+            };
+            __m128 tick = _mm_set1_ps(PHYSICS_TICK_SECONDS);
+            __m128 minimum = _mm_set1_ps(arenaMin);
+            __m128 maximum = _mm_set1_ps(arenaMax);
+            __m128 signBit = _mm_set1_ps(-0.0f);
+
+            for (; i + 4 <= end; i += 4) {
+                __m128 p = _mm_loadu_ps(&pos[i]);
+                __m128 v = _mm_loadu_ps(&velocity[i]);
+                __m128 half = _mm_loadu_ps(&halfSize[i]);
+
+                v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(&gravity[i]), tick));
+                p = _mm_add_ps(p, _mm_mul_ps(v, tick));
+
+                __m128 low = _mm_add_ps(minimum, half);
+                __m128 high = _mm_sub_ps(maximum, half);
+                __m128 bounced = _mm_mul_ps(_mm_andnot_ps(signBit, v),
+                    _mm_loadu_ps(&restitution[i]));
+
+                __m128 below = _mm_cmplt_ps(p, low);
+                p = select(below, low, p);
+                v = select(below, bounced, v);
+                __m128 above = _mm_cmpgt_ps(p, high);
+                p = select(above, high, p);
+                v = select(above, _mm_xor_ps(bounced, signBit), v);
+
+                _mm_storeu_ps(&pos[i], p);
+                _mm_storeu_ps(&velocity[i], v);
+            }
+        }
+#endif
+
+        // whatever didn't fit in a full register
+        for (; i < end; i++) {
+            stepAxis(pos[i], velocity[i], gravity[i], halfSize[i],
+                restitution[i], arenaMin, arenaMax);
+        }
+    }
+}
\ No newline at end of file
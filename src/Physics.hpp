@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Aabb.hpp"
+#include "JobSystem.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Bodies are stepped at this rate whatever the frame rate is, so they
+// bounce the same way every time
+constexpr float PHYSICS_TICK_SECONDS = 1.0f / 120.0f;
+
+// A point with a size, thrown from where its target spawns and bouncing
+// off the walls of the arena. Units are meters and seconds
+struct PhysicsBody {
+    // when it spawns
+    glm::vec3 velocity = glm::vec3(0.0f);
+    glm::vec3 gravity = glm::vec3(0.0f, -9.81f, 0.0f);
+    // how much of its speed it keeps when it bounces
+    float restitution = 0.8f;
+};
+
+// Every body as a structure of arrays, stepped by a loop that handles 4
+// (SSE) or 8 (AVX2) of them per iteration. Bodies don't collide with each
+// other here, only with the arena, so ranges of them can be stepped on
+// different threads
+class PhysicsBodies {
+public:
+    PhysicsBodies() = default;
+
+    // owner is whatever the body belongs to, the bodies don't use it
+    uint32_t add(const PhysicsBody& body, const glm::vec3& pos,
+        const glm::vec3& halfSize, uint32_t owner);
+    // Moves the last body to index. Returns the owner of that one if it
+    // isn't the one removed
+    std::optional<uint32_t> swapRemove(uint32_t index);
+    void setOwner(uint32_t index, uint32_t owner);
+    void reserve(size_t count);
+
+    size_t size() const;
+    const std::vector<uint32_t>& owners() const;
+
+    // What the bodies bounce off, from the inside
+    void setArena(const Aabb& arena);
+
+    // Back to pos, with the velocity it was added with
+    void restart(uint32_t index, const glm::vec3& pos);
+    // Moves it out of something it overlapped. The part of its velocity
+    // going against offset bounces off
+    void push(uint32_t index, const glm::vec3& offset);
+
+    // Steps every body as many ticks as fit until timeSeconds, what's
+    // left is carried over to the next call. Going back in time (a new
+    // scenario) restarts the clock without stepping
+    void advanceTo(float timeSeconds, JobSystem& jobs);
+    // Between the last two ticks, where it was at the time given to
+    // advanceTo()
+    glm::vec3 position(uint32_t index) const;
+
+private:
+    void step(size_t begin, size_t end);
+
+    std::array<std::vector<float>, 3> m_pos;
+    // where each body was before the last tick
+    std::array<std::vector<float>, 3> m_previousPos;
+    std::array<std::vector<float>, 3> m_velocity;
+    std::array<std::vector<float>, 3> m_gravity;
+    std::array<std::vector<float>, 3> m_halfSize;
+    std::vector<float> m_restitution;
+    // for restart()
+    std::vector<glm::vec3> m_startVelocity;
+    std::vector<uint32_t> m_owners;
+
+    Aabb m_arena = { glm::vec3(-FLT_MAX), glm::vec3(FLT_MAX) };
+    // double so long sessions don't drift off the ticks
+    double m_time = 0.0;
+    // how far between the last two ticks the last advanceTo() was
+    float m_blend = 1.0f;
+};
\ No newline at end of file
@@ -9,4 +9,10 @@ float RNG::getFloatInRange(float leftInclusive, float rightInclusive)
 {
     std::uniform_real_distribution<> dist(leftInclusive, rightInclusive);
     return dist(m_mt);
+}
+
+int RNG::getIntInRange(int leftInclusive, int rightInclusive)
+{
+    std::uniform_int_distribution<> dist(leftInclusive, rightInclusive);
+    return dist(m_mt);
 }
\ No newline at end of file
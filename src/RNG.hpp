@@ -7,6 +7,7 @@ public:
     RNG();
 
     float getFloatInRange(float leftInclusive, float rightInclusive);
+    int getIntInRange(int leftInclusive, int rightInclusive);
 
 private:
     std::mt19937 m_mt;
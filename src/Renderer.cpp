@@ -1,12 +1,81 @@
 #include "Renderer.hpp"
 
-#include "Entity.hpp"
+#include "EntityStore.hpp"
+#include "Globals.hpp"
 #include "Material.hpp"
 #include "Shader.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// culling one is a couple of matrix products
+constexpr size_t ENTITIES_PER_CULLING_JOB = 256;
+
+// Planes of the frustum of the matrix, facing inwards, as (normal,
+// distance). Each is a row of the matrix added to or taken from the
+// fourth row (Gribb and Hartmann)
+std::array<glm::vec4, 6> frustumPlanes(const glm::mat4& viewProjection)
+{
+    glm::mat4 rows = glm::transpose(viewProjection);
+    return { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+        rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2] };
+}
+
+// Box around the box once transformed by the matrix (Arvo)
+Aabb transformBounds(const Aabb& bounds, const glm::mat4& matrix)
+{
+    glm::vec3 center = glm::vec3(matrix * glm::vec4(bounds.center(), 1.0f));
+    glm::vec3 halfSize = (bounds.max - bounds.min) / 2.0f;
+
+    glm::vec3 extent(0.0f);
+    for (int i = 0; i < 3; i++) {
+        extent += glm::abs(glm::vec3(matrix[i])) * halfSize[i];
+    }
+
+    return { center - extent, center + extent };
+}
+
+// Conservative, boxes near a corner of the frustum can pass without
+// being in it
+bool inFrustum(const std::array<glm::vec4, 6>& planes, const Aabb& box)
+{
+    for (const auto& plane : planes) {
+        // the corner furthest along the normal
+        glm::vec3 corner(plane.x >= 0 ? box.max.x : box.min.x,
+            plane.y >= 0 ? box.max.y : box.min.y,
+            plane.z >= 0 ? box.max.z : box.min.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+glm::vec3 getHealthBarColor(float healthPercentage)
+{
+    if (healthPercentage >= 0.75f) {
+        return { 0.0f, 1.0f, 0.0f };
+    }
+    if (healthPercentage >= 0.5f) {
+        return { 1.0f, 0.66f, 0.0f };
+    }
+    if (healthPercentage >= 0.25f) {
+        return { 1.0f, 0.33f, 0.0f };
+    }
+    return { 1.0f, 0.0f, 0.0f };
+}
+
+}
+
 Renderer::Renderer()
+    : m_presentShader("./resources/shaders/fullscreen.vert",
+        "./resources/shaders/present.frag")
 {
     // sprite
     glGenVertexArrays(1, &m_spriteVao);
@@ -40,6 +109,26 @@ Renderer::Renderer()
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
+
+    glGenVertexArrays(1, &m_fullscreenVao);
+
+    // camera uniform buffer
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_cameraUboSlotSize = ((sizeof(CameraUniforms) + alignment - 1) / alignment)
+        * alignment;
+
+    const GLbitfield flags
+        = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &m_cameraUbo);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_cameraUbo);
+    glBufferStorage(GL_UNIFORM_BUFFER, m_cameraUboSlotSize * CAMERA_UBO_SLOTS,
+        nullptr, flags);
+    m_cameraUboData = static_cast<char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0,
+        m_cameraUboSlotSize * CAMERA_UBO_SLOTS, flags));
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glGenBuffers(1, &m_movementSsbo);
 }
 
 Renderer::~Renderer()
@@ -48,16 +137,174 @@ Renderer::~Renderer()
     glDeleteBuffers(1, &m_spriteVbo);
     glDeleteVertexArrays(1, &m_skyboxVao);
     glDeleteBuffers(1, &m_skyboxVbo);
+    glDeleteVertexArrays(1, &m_fullscreenVao);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, m_cameraUbo);
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glDeleteBuffers(1, &m_cameraUbo);
+    glDeleteBuffers(1, &m_movementSsbo);
+}
+
+void Renderer::setLateWarp(bool enabled)
+{
+    m_lateWarp = enabled;
+}
+
+bool Renderer::lateWarp() const
+{
+    return m_lateWarp;
+}
+
+void Renderer::setFrameTimeBudget(float frameBudgetMs)
+{
+    m_dynamicResolution.setFrameBudget(frameBudgetMs);
+}
+
+float Renderer::resolutionScale() const
+{
+    return m_dynamicResolution.scale();
+}
+
+void Renderer::setIdBuffer(bool enabled)
+{
+    m_idBuffer = enabled;
+    m_sceneTarget.setIdAttachment(enabled);
+}
+
+void Renderer::requestPick(uint32_t tag, const glm::vec3& direction)
+{
+    if (!m_idBuffer) {
+        m_missedPicks.push_back({ tag, 0 });
+        return;
+    }
+
+    m_pickRequests.push_back({ tag, direction });
+}
+
+void Renderer::pollPicks(std::vector<PickResult>& results)
+{
+    results.insert(results.end(), m_missedPicks.begin(), m_missedPicks.end());
+    m_missedPicks.clear();
+    m_picker.poll(results);
+}
+
+bool Renderer::usesSceneTarget() const
+{
+    // the default framebuffer can't have an id attachment
+    return m_lateWarp || m_dynamicResolution.enabled() || m_idBuffer;
+}
+
+void Renderer::readPicks()
+{
+    m_sceneTarget.bindIdsForReading();
+
+    for (const auto& request : m_pickRequests) {
+        // a direction is a point at infinity, so only the rotation of the
+        // view matters
+        glm::vec4 clip = m_renderedProjection * m_renderedView
+            * glm::vec4(request.direction, 0.0f);
+        if (clip.w <= 0.0f) {
+            m_missedPicks.push_back({ request.tag, 0 });
+            continue;
+        }
+
+        glm::vec2 ndc = glm::vec2(clip.x, clip.y) / clip.w;
+        auto x = (int)std::floor((ndc.x + 1) / 2 * m_renderedWidth);
+        auto y = (int)std::floor((ndc.y + 1) / 2 * m_renderedHeight);
+        if (x < 0 || x >= m_renderedWidth || y < 0 || y >= m_renderedHeight
+            || !m_picker.request(request.tag, x, y)) {
+            m_missedPicks.push_back({ request.tag, 0 });
+        }
+    }
+    m_pickRequests.clear();
+
+    m_sceneTarget.bind();
+    glViewport(0, 0, m_renderedWidth, m_renderedHeight);
+}
+
+void Renderer::writeCameraUniforms(
+    const Scene& scene, const Camera& camera, float overscan)
+{
+    float fov = 2
+        * std::atan(std::tan(glm::radians(camera.zoom()) / 2) * overscan);
+
+    CameraUniforms uniforms;
+    uniforms.view = camera.buildViewMatrix();
+    uniforms.projection = glm::perspective(fov,
+        (float)scene.viewportWidth / scene.viewportHeight, 0.1F, 100.0F);
+    uniforms.viewPos = glm::vec4(camera.position, 1.0f);
+
+    m_renderedProjection = uniforms.projection;
+
+    m_cameraUboSlot = (m_cameraUboSlot + 1) % CAMERA_UBO_SLOTS;
+    GLintptr offset = m_cameraUboSlotSize * m_cameraUboSlot;
+    std::memcpy(m_cameraUboData + offset, &uniforms, sizeof(uniforms));
+    glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_UBO_BINDING, m_cameraUbo,
+        offset, sizeof(CameraUniforms));
 }
 
-void Renderer::renderEntity(const Scene& scene, const Entity& entity)
+void Renderer::cullEntities(
+    const EntityStore& entities, const glm::mat4& viewProjection)
 {
-    const Shader& shader = entity.shader.get();
+    std::array<glm::vec4, 6> planes = frustumPlanes(viewProjection);
+    const Aabb& healthbarBounds
+        = g_resourceManager->getModel("plane").bounds();
+
+    m_entityVisible.resize(entities.size());
+    g_jobSystem->parallelFor(entities.size(), ENTITIES_PER_CULLING_JOB,
+        [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                // the matrices of those don't have their offset
+                if (entities.gpuMoved(i)) {
+                    m_entityVisible[i] = true;
+                    continue;
+                }
+
+                const RenderComponent& render = entities.renders()[i];
+                Aabb bounds = transformBounds(
+                    render.model->bounds(), render.modelMatrix);
+                // same condition as renderEntity()
+                const HealthComponent& health = entities.healths()[i];
+                if (health.destroyable && health.starting != 1) {
+                    bounds.grow(transformBounds(
+                        healthbarBounds, render.healthbarMatrix));
+                }
+
+                m_entityVisible[i] = inFrustum(planes, bounds);
+            }
+        });
+}
+
+void Renderer::uploadGpuMovements(const EntityStore& entities)
+{
+    if (!entities.gpuMovement()
+        || m_uploadedMovementVersion == entities.gpuMovementVersion()) {
+        return;
+    }
+
+    // only changes when targets are added, removed or placed somewhere
+    // else, not every frame
+    entities.packGpuMovements(m_gpuMovements);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_movementSsbo);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,
+        m_gpuMovements.size() * sizeof(GpuMovement), m_gpuMovements.data(),
+        GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBufferBase(
+        GL_SHADER_STORAGE_BUFFER, MOVEMENT_SSBO_BINDING, m_movementSsbo);
+    m_uploadedMovementVersion = entities.gpuMovementVersion();
+}
+
+void Renderer::renderEntity(
+    const Scene& scene, const EntityStore& entities, EntityIndex entity)
+{
+    const RenderComponent& render = entities.renders()[entity];
+    const Shader& shader = *render.shader;
     shader.use();
 
     // lighting stuff
     if (scene.globalLightSource.has_value()) {
-        shader.setVec3("viewPos", scene.camera.position);
         shader.setVec3(
             "light.direction", scene.globalLightSource->get().direction);
         shader.setVec3("light.ambient", scene.globalLightSource->get().ambient);
@@ -66,37 +313,36 @@ void Renderer::renderEntity(const Scene& scene, const Entity& entity)
             "light.specular", scene.globalLightSource->get().specular);
     }
 
-    glm::mat4 view = scene.camera.buildViewMatrix();
-    shader.setMat4("view", view);
-
-    auto model = entity.modelMatrix();
-    shader.setMat4("model", model);
-    shader.setMat3("normal", entity.normalMatrix());
-
-    glm::mat4 projection = glm::perspective(glm::radians(scene.camera.zoom()),
-        (float)scene.viewportWidth / scene.viewportHeight, 0.1F, 100.0F);
-
-    glm::mat4 mvp = projection * view * model;
-    shader.setMat4("mvp", mvp);
-
-    entity.material.get().bind(shader);
-    entity.render();
-
-    if (entity.shouldRenderHealthBar()) {
-        const Shader& healthbarShader = entity.healthbarShader;
-        Material& healthbarMaterial = entity.healthbarMaterial;
+    // view and projection come from the camera uniform buffer
+    shader.setMat4("model", render.modelMatrix);
+    shader.setMat3("normal", render.normalMatrix);
+    shader.setUInt("entityId", entities.colliders()[entity].handle + 1);
+    int movementIndex = entities.gpuMoved(entity) ? (int)entity : -1;
+    shader.setInt("movementIndex", movementIndex);
+    shader.setFloat("movementTime", entities.movementTime());
+
+    render.material->bind(shader);
+    // the healthbar isn't part of the entity as far as picking goes
+    glColorMaski(1, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    render.model->render();
+    glColorMaski(1, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+    const HealthComponent& health = entities.healths()[entity];
+    if (health.destroyable && health.starting != 1) {
+        const Shader& healthbarShader
+            = g_resourceManager->getShader("healthbar");
+        Material& healthbarMaterial
+            = g_resourceManager->getMaterial("healthbar");
+        float healthPercentage = (float)health.current / health.starting;
 
         healthbarShader.use();
-
-        model = entity.buildHealthbarModelMatrix();
-        mvp = projection * view * model;
-
-        healthbarShader.setMat4("mvp", mvp);
-        healthbarShader.setFloat(
-            "healthPercentage", entity.getHealthPercentage());
-        healthbarMaterial.setColor(entity.getHealthBarColor());
+        healthbarShader.setMat4("model", render.healthbarMatrix);
+        healthbarShader.setInt("movementIndex", movementIndex);
+        healthbarShader.setFloat("movementTime", entities.movementTime());
+        healthbarShader.setFloat("healthPercentage", healthPercentage);
+        healthbarMaterial.setColor(getHealthBarColor(healthPercentage));
         healthbarMaterial.bind(healthbarShader);
-        entity.renderHealthBar();
+        g_resourceManager->getModel("plane").render();
     }
 }
 
@@ -131,18 +377,11 @@ void Renderer::renderSprite(const Scene& scene, const Sprite& sprite) const
     glDrawArrays(GL_TRIANGLES, 0, 6);
 }
 
-void Renderer::renderSkybox(
-    const Scene& scene, const Shader& shader, const Cubemap& cubemap) const
+void Renderer::renderSkybox(const Shader& shader, const Cubemap& cubemap) const
 {
     glDepthFunc(GL_LEQUAL);
+    // view and projection come from the camera uniform buffer
     shader.use();
-    // ... set view and projection matrix
-    glm::mat4 view = glm::mat4(glm::mat3(scene.camera.buildViewMatrix()));
-    shader.setMat4("view", view);
-
-    glm::mat4 projection = glm::perspective(glm::radians(scene.camera.zoom()),
-        (float)scene.viewportWidth / scene.viewportHeight, 0.1F, 100.0F);
-    shader.setMat4("projection", projection);
 
     glBindVertexArray(m_skyboxVao);
     glActiveTexture(GL_TEXTURE0); // temp
@@ -151,6 +390,49 @@ void Renderer::renderSkybox(
     glDepthFunc(GL_LESS);
 }
 
+void Renderer::renderPresentPass(const Scene& scene, const Camera& camera)
+{
+    // the camera passed when late warp is off isn't necessarily the one
+    // the scene was rendered with, so no reprojection at all then
+    auto reprojection = glm::identity<glm::mat3>();
+    float overscan = 1.0f;
+    if (m_lateWarp) {
+        glm::mat3 latestView = glm::mat3(camera.buildViewMatrix());
+        reprojection = glm::mat3(m_renderedView) * glm::transpose(latestView);
+        overscan = LATE_WARP_OVERSCAN;
+    }
+
+    float tanHalfFovY = std::tan(glm::radians(camera.zoom()) / 2);
+    glm::vec2 screenTanHalfFov(
+        tanHalfFovY * scene.viewportWidth / scene.viewportHeight, tanHalfFovY);
+
+    glm::vec2 uvScale((float)m_renderedWidth / m_sceneTarget.width(),
+        (float)m_renderedHeight / m_sceneTarget.height());
+    float sharpness = m_renderedWidth < m_sceneTarget.width()
+        ? DYNAMIC_RESOLUTION_SHARPNESS
+        : 0.0f;
+
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+
+    m_presentShader.use();
+    m_presentShader.setMat3("reprojection", reprojection);
+    m_presentShader.setVec2("screenTanHalfFov", screenTanHalfFov);
+    m_presentShader.setVec2("sceneTanHalfFov", screenTanHalfFov * overscan);
+    m_presentShader.setVec2("uvScale", uvScale);
+    m_presentShader.setFloat("sharpness", sharpness);
+    m_presentShader.setInt("scene", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_sceneTarget.colorTexture());
+
+    glBindVertexArray(m_fullscreenVao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glEnable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+}
+
 void Renderer::renderScene(const Scene& scene)
 {
     glEnable(GL_BLEND);
@@ -158,18 +440,73 @@ void Renderer::renderScene(const Scene& scene)
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
 
+    std::optional<float> sceneGpuMs = m_sceneTimer.poll();
+    if (sceneGpuMs.has_value()) {
+        m_dynamicResolution.update(sceneGpuMs.value());
+    }
+    m_sceneTimer.begin();
+
+    float overscan = m_lateWarp ? LATE_WARP_OVERSCAN : 1.0f;
+    if (usesSceneTarget()) {
+        // the target always has the full resolution, a lower scale
+        // only renders to part of it
+        m_sceneTarget.resize(std::lround(scene.viewportWidth * overscan),
+            std::lround(scene.viewportHeight * overscan));
+        m_sceneTarget.bind();
+
+        float scale = m_dynamicResolution.scale();
+        m_renderedWidth
+            = std::max(1L, std::lround(m_sceneTarget.width() * scale));
+        m_renderedHeight
+            = std::max(1L, std::lround(m_sceneTarget.height() * scale));
+        glViewport(0, 0, m_renderedWidth, m_renderedHeight);
+    }
+
     glClearColor(0.3, 0.3, 0.3, 1.0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (m_idBuffer) {
+        m_sceneTarget.clearIds();
+    }
+    // only entities write ids
+    glColorMaski(1, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+    // latching as late as possible, everything up to this point
+    // (entity updates, shots, etc.) happened with the old orientation
+    Camera camera = scene.latchCamera ? scene.latchCamera() : scene.camera;
+    writeCameraUniforms(scene, camera, overscan);
+    m_renderedView = camera.buildViewMatrix();
 
     if (scene.entities.has_value()) {
-        for (auto& entity : scene.entities->get()) {
-            renderEntity(scene, entity);
+        const EntityStore& entities = scene.entities->get();
+        uploadGpuMovements(entities);
+        cullEntities(entities, m_renderedProjection * m_renderedView);
+        for (size_t i = 0; i < entities.size(); i++) {
+            if (m_entityVisible[i]) {
+                renderEntity(scene, entities, i);
+            }
         }
     }
 
+    if (!m_pickRequests.empty()) {
+        readPicks();
+    }
+
     if (scene.skybox.has_value()) {
-        renderSkybox(
-            scene, scene.skybox->get().shader, scene.skybox->get().cubemap);
+        renderSkybox(scene.skybox->get().shader, scene.skybox->get().cubemap);
+    }
+
+    m_sceneTimer.end();
+
+    if (usesSceneTarget()) {
+        Framebuffer::bindDefault();
+        glViewport(0, 0, scene.viewportWidth, scene.viewportHeight);
+    }
+}
+
+void Renderer::composite(const Scene& scene, const Camera& camera)
+{
+    if (usesSceneTarget()) {
+        renderPresentPass(scene, camera);
     }
 
     if (scene.sprites.has_value()) {
@@ -1,26 +1,97 @@
 #pragma once
 
+#include "DynamicResolution.hpp"
+#include "Framebuffer.hpp"
+#include "GpuPicker.hpp"
+#include "GpuTimer.hpp"
 #include "Material.hpp"
 #include "Scene.hpp"
 #include "Shader.hpp"
 #include "Sprite.hpp"
 
+#include <glm/glm.hpp>
+
 #include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// The Camera uniform block is shared by every 3D shader
+constexpr GLuint CAMERA_UBO_BINDING = 0;
+// Each frame writes to its own slot of the camera buffer so we never
+// overwrite data the GPU might still be reading
+constexpr size_t CAMERA_UBO_SLOTS = 3;
+// Movements evaluated by the vertex shaders (see movement.glsl)
+constexpr GLuint MOVEMENT_SSBO_BINDING = 1;
+// With late warp the scene is rendered with a field of view this much
+// larger (in tangent space) than the screen's, so there is something to
+// show at the borders after rotating the image
+constexpr float LATE_WARP_OVERSCAN = 1.15f;
+// How much the upscale from a lower resolution gets sharpened, in [0, 1]
+constexpr float DYNAMIC_RESOLUTION_SHARPNESS = 0.6f;
 
 class Renderer {
 public:
     Renderer();
     ~Renderer();
 
+    // Renders the 3D part of the scene. With late warp or dynamic
+    // resolution enabled, this goes to an offscreen target that is only
+    // shown by composite()
     void renderScene(const Scene& scene);
+    // Meant to be called as close as possible to swapping buffers.
+    // Upscales and reprojects the offscreen scene to the orientation of
+    // camera (when late warp is enabled) and draws the sprites on top
+    void composite(const Scene& scene, const Camera& camera);
+
+    void setLateWarp(bool enabled);
+    bool lateWarp() const;
+
+    // 0 disables dynamic resolution
+    void setFrameTimeBudget(float frameBudgetMs);
+    float resolutionScale() const;
+
+    // Makes the entity pass write the id of each entity (its collider
+    // handle + 1) to an id buffer that picks are read from
+    void setIdBuffer(bool enabled);
+    // Picks what is drawn in direction from the camera in the next frame
+    // rendered. The result comes back through pollPicks() with tag, at
+    // most GpuPicker::MAX_LATENCY_FRAMES frames later
+    void requestPick(uint32_t tag, const glm::vec3& direction);
+    void pollPicks(std::vector<PickResult>& results);
 
 private:
+    // std140 layout of the Camera block in the shaders
+    struct CameraUniforms {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec4 viewPos;
+    };
+
+    struct PickRequest {
+        uint32_t tag;
+        glm::vec3 direction;
+    };
+
+    void writeCameraUniforms(
+        const Scene& scene, const Camera& camera, float overscan);
+    bool usesSceneTarget() const;
+    // Queues the reads of the picks requested for this frame
+    void readPicks();
+    void renderPresentPass(const Scene& scene, const Camera& camera);
+    // Fills m_entityVisible, on every thread
+    void cullEntities(
+        const EntityStore& entities, const glm::mat4& viewProjection);
+    // Uploads the movements of the entities if they changed since the
+    // last upload
+    void uploadGpuMovements(const EntityStore& entities);
+
     // Should probably change this later, having to always pass the scene
     // is kinda ugly
-    static void renderEntity(const Scene& scene, const Entity& entity);
+    static void renderEntity(
+        const Scene& scene, const EntityStore& entities, EntityIndex entity);
     void renderSprite(const Scene& scene, const Sprite& sprite) const;
-    void renderSkybox(
-        const Scene& scene, const Shader& shader, const Cubemap& cubemap) const;
+    void renderSkybox(const Shader& shader, const Cubemap& cubemap) const;
 
     // clang-format off
     std::array<float, 24> m_spriteVertices = {
@@ -82,4 +153,38 @@ private:
     GLuint m_spriteVbo;
     GLuint m_skyboxVao;
     GLuint m_skyboxVbo;
+    // empty, fullscreen passes generate their vertices
+    GLuint m_fullscreenVao;
+
+    bool m_lateWarp = false;
+    DynamicResolution m_dynamicResolution;
+    GpuTimer m_sceneTimer;
+    Framebuffer m_sceneTarget;
+    Shader m_presentShader;
+    // matrices the scene was last rendered with
+    glm::mat4 m_renderedView;
+    glm::mat4 m_renderedProjection;
+    // part of m_sceneTarget that was rendered to
+    int m_renderedWidth = 0;
+    int m_renderedHeight = 0;
+
+    bool m_idBuffer = false;
+    GpuPicker m_picker;
+    // waiting for the next frame
+    std::vector<PickRequest> m_pickRequests;
+    // picks that didn't need the GPU, like directions off screen
+    std::vector<PickResult> m_missedPicks;
+
+    // persistently mapped, so writing a slot is just a memcpy
+    GLuint m_cameraUbo;
+    GLsizeiptr m_cameraUboSlotSize;
+    char* m_cameraUboData;
+    size_t m_cameraUboSlot = 0;
+
+    // by EntityIndex, as of the last frame
+    std::vector<uint8_t> m_entityVisible;
+
+    GLuint m_movementSsbo;
+    std::vector<GpuMovement> m_gpuMovements;
+    std::optional<uint64_t> m_uploadedMovementVersion;
 };
\ No newline at end of file
@@ -5,6 +5,17 @@
 #include "Shader.hpp"
 #include "Sound.hpp"
 
+#include <exception>
+#include <memory>
+#include <optional>
+
+namespace {
+
+// files per job, they are all big enough for their own
+constexpr size_t FILES_PER_JOB = 1;
+
+}
+
 void ResourceManager::addShader(const std::string& name,
     const std::string& vertexPath, const std::string& fragmentPath)
 {
@@ -48,6 +59,11 @@ const Model& ResourceManager::getModel(const std::string& name)
     return m_models.at(name);
 }
 
+bool ResourceManager::hasModel(const std::string& name) const
+{
+    return m_models.find(name) != m_models.end();
+}
+
 void ResourceManager::addMaterial(const std::string& name)
 {
     m_materials.insert({ name, Material() });
@@ -67,3 +83,70 @@ const std::vector<Sound>& ResourceManager::getAllSounds() const
 {
     return m_sounds;
 }
+
+void ResourceManager::queueCubemap(
+    const std::string& name, const std::array<std::string, 6>& paths)
+{
+    auto faces = std::make_shared<std::array<ImageData, 6>>();
+    // each face on its own, they're the biggest images there are
+    for (size_t i = 0; i < paths.size(); i++) {
+        m_queuedLoads.push_back(
+            { [=] { (*faces)[i] = ImageData(paths[i]); }, nullptr });
+    }
+    m_queuedLoads.back().create
+        = [=, this] { m_cubemaps.insert({ name, Cubemap(*faces) }); };
+}
+
+void ResourceManager::queueTexture(
+    const std::string& name, const std::string& path, Texture::Type type)
+{
+    auto image = std::make_shared<ImageData>();
+    m_queuedLoads.push_back({ [=] { *image = ImageData(path); },
+        [=, this] { m_textures.insert({ name, Texture(*image, type) }); } });
+}
+
+void ResourceManager::queueModel(
+    const std::string& name, const std::string& path)
+{
+    auto data = std::make_shared<ModelData>();
+    m_queuedLoads.push_back({ [=] { *data = Model::load(path); },
+        [=, this] { m_models.insert({ name, Model(std::move(*data)) }); } });
+}
+
+void ResourceManager::queueSound(
+    const std::string& name, const std::string& path)
+{
+    auto sound = std::make_shared<std::optional<Sound>>();
+    m_queuedLoads.push_back({ [=] { sound->emplace(name, path); },
+        [=, this] { m_sounds.push_back(std::move(sound->value())); } });
+}
+
+void ResourceManager::loadQueued(JobSystem& jobs)
+{
+    // jobs can't throw, their errors are kept for this thread
+    std::vector<std::exception_ptr> errors(m_queuedLoads.size());
+    jobs.parallelFor(
+        m_queuedLoads.size(), FILES_PER_JOB, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                try {
+                    m_queuedLoads[i].decode();
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+        });
+
+    std::vector<QueuedLoad> loads = std::move(m_queuedLoads);
+    m_queuedLoads.clear();
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    for (const auto& load : loads) {
+        if (load.create) {
+            load.create();
+        }
+    }
+}
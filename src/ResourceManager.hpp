@@ -3,12 +3,14 @@
 // Heavily inspired by the LearnOpenGL version, except not a singleton.
 // Meant to be instantiated in Game and passed around as reference if needed
 
+#include "JobSystem.hpp"
 #include "Material.hpp"
 #include "Model.hpp"
 #include "Shader.hpp"
 #include "Sound.hpp"
 
 #include <array>
+#include <functional>
 #include <map>
 #include <string>
 #include <vector>
@@ -29,6 +31,7 @@ public:
 
     void addModel(const std::string& name, const std::string& path);
     const Model& getModel(const std::string& name);
+    bool hasModel(const std::string& name) const;
 
     void addMaterial(const std::string& name);
     Material& getMaterial(const std::string& name);
@@ -36,7 +39,29 @@ public:
     void addSound(const std::string& name, const std::string& path);
     const std::vector<Sound>& getAllSounds() const;
 
+    // Same as the add functions, except nothing is loaded until
+    // loadQueued()
+    void queueCubemap(
+        const std::string& name, const std::array<std::string, 6>& paths);
+    void queueTexture(
+        const std::string& name, const std::string& path, Texture::Type type);
+    void queueModel(const std::string& name, const std::string& path);
+    void queueSound(const std::string& name, const std::string& path);
+    // Decodes every queued file at once on the threads of jobs, then
+    // creates their GL objects on this thread, in the order they were
+    // queued. Rethrows the first error of a file, if any
+    void loadQueued(JobSystem& jobs);
+
 private:
+    struct QueuedLoad {
+        // can run on any thread
+        std::function<void()> decode;
+        // runs on the thread with the context once everything was
+        // decoded, can be empty
+        std::function<void()> create;
+    };
+
+    std::vector<QueuedLoad> m_queuedLoads;
     std::map<std::string, Shader> m_shaders;
     std::map<std::string, Texture> m_textures;
     // This is weird because Cubemap is a Texture, but it's
@@ -1,10 +1,15 @@
 #pragma once
 
 #include "Entity.hpp"
+#include "Movement.hpp"
+#include "Physics.hpp"
 #include "Weapon.hpp"
 
 #include <glm/glm.hpp>
 
+#include <optional>
+#include <string>
+
 struct Target {
     enum class Shape {
         Box,
@@ -14,14 +19,23 @@ struct Target {
     Entity::Type type = Entity::Type::GONER;
     Shape shape = Shape::Ball;
     glm::vec3 scale = glm::vec3(1.0f);
+    // replaces the model of the shape if set, also registered as the name
+    // of the model in the resource manager
+    std::string modelPath;
+    // hit by the triangles of the model instead of the box or ball
+    bool meshHitbox = false;
     glm::vec3 spawnCoords;
     glm::vec3 minCoords;
     glm::vec3 maxCoords;
     bool randomSpawn = true;
-    bool moves = false;
-    float movementAmplitude;
-    float movementSpeed;
+    // around the spawn point, none if unset
+    std::optional<Movement> movement;
+    // thrown from the spawn point instead of moving, if set
+    std::optional<PhysicsBody> physics;
     int health = 1;
+    // index of an earlier target of the scenario. The coordinates of
+    // the target are then relative to it, and it follows it around
+    std::optional<size_t> parent;
 };
 
 struct Scenario {
@@ -31,9 +45,13 @@ struct Scenario {
     };
 
     std::string name;
-    Weapon::Type weaponType = Weapon::Type::Pistol;
+    // name of the weapon definition
+    std::string weapon = "pistol";
     glm::vec3 playerPos;
     WinCondition winCondition = WinCondition::Time;
     float challengeDurationSeconds;
     std::vector<Target> targets;
+    // the entities of the targets, same order. Built once when the
+    // scenario is parsed so starting it only copies them in
+    std::vector<Entity> prefabs;
 };
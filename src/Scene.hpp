@@ -1,7 +1,7 @@
 #pragma once
 
 #include "Camera.hpp"
-#include "Entity.hpp"
+#include "EntityStore.hpp"
 #include "Material.hpp"
 #include "Sprite.hpp"
 
@@ -44,8 +44,12 @@ struct Scene {
     const Camera& camera;
     int viewportWidth;
     int viewportHeight;
+    // If set, called right before the entity pass is submitted. Returns
+    // the camera with the most recent mouse movement applied, which is
+    // what actually ends up in the view matrix
+    std::function<Camera()> latchCamera = nullptr;
     std::optional<std::reference_wrapper<LightSource>> globalLightSource;
     std::optional<std::reference_wrapper<Skybox>> skybox;
-    std::optional<std::reference_wrapper<const std::vector<Entity>>> entities;
+    std::optional<std::reference_wrapper<const EntityStore>> entities;
     std::optional<std::reference_wrapper<std::vector<Sprite>>> sprites;
 };
\ No newline at end of file
@@ -2,11 +2,45 @@
 
 #include "filereader.hpp"
 
+#include <filesystem>
+#include <sstream>
+
+namespace {
+
+// Replaces the #include "file" lines of a shader with the file, looked up
+// next to the shader. Only one level deep, included files can't include
+std::string expandIncludes(const std::string& code, const std::string& path)
+{
+    const std::string directive = "#include \"";
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+    std::istringstream lines(code);
+    std::string expanded;
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.starts_with(directive)) {
+            size_t end = line.find('"', directive.size());
+            std::string file
+                = line.substr(directive.size(), end - directive.size());
+            expanded += readTextFile((directory / file).string());
+        } else {
+            expanded += line;
+        }
+        expanded += '\n';
+    }
+
+    return expanded;
+}
+
+}
+
 Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath)
     : m_id(glCreateProgram())
 {
-    std::string vertexCode = readTextFile(vertexPath);
-    std::string fragmentCode = readTextFile(fragmentPath);
+    std::string vertexCode
+        = expandIncludes(readTextFile(vertexPath), vertexPath);
+    std::string fragmentCode
+        = expandIncludes(readTextFile(fragmentPath), fragmentPath);
 
     const char* vertexCodeCStr = vertexCode.c_str();
     const char* fragmentCodeCStr = fragmentCode.c_str();
@@ -37,11 +71,21 @@ void Shader::setInt(const std::string& name, int value) const
     glUniform1i(glGetUniformLocation(m_id, name.c_str()), value);
 }
 
+void Shader::setUInt(const std::string& name, unsigned int value) const
+{
+    glUniform1ui(glGetUniformLocation(m_id, name.c_str()), value);
+}
+
 void Shader::setFloat(const std::string& name, float value) const
 {
     glUniform1f(glGetUniformLocation(m_id, name.c_str()), value);
 }
 
+void Shader::setVec2(const std::string& name, const glm::vec2& value) const
+{
+    glUniform2fv(glGetUniformLocation(m_id, name.c_str()), 1, &value[0]);
+}
+
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const
 {
     glUniform3fv(glGetUniformLocation(m_id, name.c_str()), 1, &value[0]);
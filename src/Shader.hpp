@@ -12,7 +12,9 @@ public:
 
     void use() const;
     void setInt(const std::string& name, int value) const;
+    void setUInt(const std::string& name, unsigned int value) const;
     void setFloat(const std::string& name, float value) const;
+    void setVec2(const std::string& name, const glm::vec2& value) const;
     void setVec3(const std::string& name, const glm::vec3& value) const;
     void setVec4(const std::string& name, const glm::vec4& value) const;
     void setMat3(const std::string& name, const glm::mat3& value) const;
@@ -0,0 +1,14 @@
+#pragma once
+
+// Picks the widest instruction set the batched collision kernels can
+// use with the flags we were compiled with. AVX2 needs the OPENAIM_AVX2
+// CMake option, SSE2 is always there on x86-64. Anything else falls
+// back to the scalar loops
+#if defined(__AVX2__)
+#define OPENAIM_SIMD_AVX2
+#define OPENAIM_SIMD_SSE
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#define OPENAIM_SIMD_SSE
+#include <emmintrin.h>
+#endif
\ No newline at end of file
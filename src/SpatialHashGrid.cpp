@@ -0,0 +1,178 @@
+#include "SpatialHashGrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+void swapRemoveValue(std::vector<ColliderHandle>& values, ColliderHandle value)
+{
+    auto it = std::find(values.begin(), values.end(), value);
+    if (it != values.end()) {
+        *it = values.back();
+        values.pop_back();
+    }
+}
+
+}
+
+void SpatialHashGrid::reset(float cellSize)
+{
+    m_cellSize = cellSize;
+    // emptied but kept, like cells that get empty, so starting a
+    // scenario again doesn't allocate them all again
+    for (auto& [key, cell] : m_cells) {
+        cell.clear();
+    }
+    m_largeColliders.clear();
+    m_entries.clear();
+    m_queryStamps.clear();
+    m_queryCount = 0;
+}
+
+void SpatialHashGrid::reserve(size_t count)
+{
+    m_entries.reserve(count);
+    m_queryStamps.reserve(count);
+}
+
+float SpatialHashGrid::cellSize() const
+{
+    return m_cellSize;
+}
+
+void SpatialHashGrid::insert(ColliderHandle collider, const Aabb& bounds)
+{
+    if (collider >= m_entries.size()) {
+        m_entries.resize(collider + 1);
+        m_queryStamps.resize(collider + 1, 0);
+    }
+
+    Entry& entry = m_entries[collider];
+    entry.minCell = cellOf(bounds.min);
+    entry.maxCell = cellOf(bounds.max);
+    int64_t cellCount = 1;
+    for (int i = 0; i < 3; i++) {
+        cellCount *= entry.maxCell[i] - entry.minCell[i] + 1;
+    }
+    entry.large = cellCount > MAX_CELLS_PER_COLLIDER;
+    entry.inserted = true;
+
+    addToCells(collider, entry);
+}
+
+void SpatialHashGrid::update(ColliderHandle collider, const Aabb& bounds)
+{
+    if (collider >= m_entries.size() || !m_entries[collider].inserted) {
+        insert(collider, bounds);
+        return;
+    }
+
+    Entry& entry = m_entries[collider];
+    glm::ivec3 minCell = cellOf(bounds.min);
+    glm::ivec3 maxCell = cellOf(bounds.max);
+    if (minCell == entry.minCell && maxCell == entry.maxCell) {
+        return;
+    }
+
+    removeFromCells(collider, entry);
+    insert(collider, bounds);
+}
+
+void SpatialHashGrid::remove(ColliderHandle collider)
+{
+    if (collider >= m_entries.size() || !m_entries[collider].inserted) {
+        return;
+    }
+
+    removeFromCells(collider, m_entries[collider]);
+    m_entries[collider].inserted = false;
+}
+
+void SpatialHashGrid::query(
+    const Aabb& bounds, std::vector<ColliderHandle>& results)
+{
+    results.clear();
+    m_queryCount++;
+    // a wrapped counter could match stale stamps
+    if (m_queryCount == 0) {
+        std::fill(m_queryStamps.begin(), m_queryStamps.end(), 0);
+        m_queryCount = 1;
+    }
+
+    results.insert(
+        results.end(), m_largeColliders.begin(), m_largeColliders.end());
+
+    glm::ivec3 minCell = cellOf(bounds.min);
+    glm::ivec3 maxCell = cellOf(bounds.max);
+    for (int z = minCell.z; z <= maxCell.z; z++) {
+        for (int y = minCell.y; y <= maxCell.y; y++) {
+            for (int x = minCell.x; x <= maxCell.x; x++) {
+                auto it = m_cells.find(cellKey(x, y, z));
+                if (it == m_cells.end()) {
+                    continue;
+                }
+
+                for (ColliderHandle collider : it->second) {
+                    if (m_queryStamps[collider] != m_queryCount) {
+                        m_queryStamps[collider] = m_queryCount;
+                        results.push_back(collider);
+                    }
+                }
+            }
+        }
+    }
+}
+
+glm::ivec3 SpatialHashGrid::cellOf(const glm::vec3& point) const
+{
+    return glm::ivec3(glm::floor(point / m_cellSize));
+}
+
+// 21 bits per coordinate, which is plenty for anything in the arena
+uint64_t SpatialHashGrid::cellKey(int x, int y, int z)
+{
+    constexpr uint64_t mask = (1 << 21) - 1;
+    return ((uint64_t)x & mask) | (((uint64_t)y & mask) << 21)
+        | (((uint64_t)z & mask) << 42);
+}
+
+void SpatialHashGrid::addToCells(ColliderHandle collider, const Entry& entry)
+{
+    if (entry.large) {
+        m_largeColliders.push_back(collider);
+        return;
+    }
+
+    for (int z = entry.minCell.z; z <= entry.maxCell.z; z++) {
+        for (int y = entry.minCell.y; y <= entry.maxCell.y; y++) {
+            for (int x = entry.minCell.x; x <= entry.maxCell.x; x++) {
+                m_cells[cellKey(x, y, z)].push_back(collider);
+            }
+        }
+    }
+}
+
+void SpatialHashGrid::removeFromCells(
+    ColliderHandle collider, const Entry& entry)
+{
+    if (entry.large) {
+        swapRemoveValue(m_largeColliders, collider);
+        return;
+    }
+
+    for (int z = entry.minCell.z; z <= entry.maxCell.z; z++) {
+        for (int y = entry.minCell.y; y <= entry.maxCell.y; y++) {
+            for (int x = entry.minCell.x; x <= entry.maxCell.x; x++) {
+                auto it = m_cells.find(cellKey(x, y, z));
+                if (it == m_cells.end()) {
+                    continue;
+                }
+
+                // empty cells are kept, targets moving around would
+                // keep reallocating them otherwise
+                swapRemoveValue(it->second, collider);
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Aabb.hpp"
+#include "ColliderStore.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Uniform grid over the bounds of colliders, hashed so only cells with
+// something in them take memory. Finding what might overlap a box only
+// looks at the cells the box covers, so with cells about the size of
+// the colliders it costs the same no matter how many there are.
+// Colliders covering too many cells (walls, the floor) are kept in a
+// list of their own that every query returns instead
+class SpatialHashGrid {
+public:
+    SpatialHashGrid() = default;
+
+    // Removes everything
+    void reset(float cellSize);
+    // Makes room for colliders with handles up to count
+    void reserve(size_t count);
+    float cellSize() const;
+
+    void insert(ColliderHandle collider, const Aabb& bounds);
+    // Only touches the cells if the collider moved to different ones
+    void update(ColliderHandle collider, const Aabb& bounds);
+    void remove(ColliderHandle collider);
+
+    // Colliders whose cells overlap those of bounds, each one once. They
+    // don't necessarily overlap bounds themselves
+    void query(const Aabb& bounds, std::vector<ColliderHandle>& results);
+
+private:
+    // colliders covering more cells than this are kept aside
+    static constexpr int MAX_CELLS_PER_COLLIDER = 64;
+
+    struct Entry {
+        glm::ivec3 minCell;
+        glm::ivec3 maxCell;
+        bool inserted = false;
+        bool large = false;
+    };
+
+    glm::ivec3 cellOf(const glm::vec3& point) const;
+    static uint64_t cellKey(int x, int y, int z);
+    void addToCells(ColliderHandle collider, const Entry& entry);
+    void removeFromCells(ColliderHandle collider, const Entry& entry);
+
+    float m_cellSize = 1.0f;
+    std::unordered_map<uint64_t, std::vector<ColliderHandle>> m_cells;
+    std::vector<ColliderHandle> m_largeColliders;
+    // indexed by handle
+    std::vector<Entry> m_entries;
+    // query the collider was last returned by, to skip duplicates
+    std::vector<uint32_t> m_queryStamps;
+    uint32_t m_queryCount = 0;
+};
\ No newline at end of file
@@ -0,0 +1,294 @@
+#include "SpawnSampler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace {
+
+// attempts around each point before it's considered surrounded, the
+// usual value for Bridson's algorithm
+constexpr int SAMPLES_PER_POINT = 30;
+// the background grid gets too big past this, candidates stop there
+constexpr size_t MAX_GRID_CELLS = 1 << 22;
+constexpr float PI = 3.14159265f;
+
+// Smallest separation, at least minSeparation, that can't give more than
+// maxPoints points. Points that far apart are the centers of disjoint
+// balls of half that radius, all inside the volume grown by as much.
+// Balls fill at most a fraction of it (the densest packing), so that
+// fraction of the grown volume over the volume of one ball bounds the
+// count. Only the axisCount first extents are used
+float separationForPointCount(const std::array<float, 3>& extents,
+    int axisCount, float minSeparation, size_t maxPoints)
+{
+    const auto maxPointCount = [&](float separation) {
+        float measure = 1.0f;
+        for (int i = 0; i < axisCount; i++) {
+            measure *= extents[i] + separation;
+        }
+        float radius = separation / 2;
+        float ball = 2 * radius;
+        float packing = 1.0f;
+        if (axisCount == 2) {
+            ball = PI * radius * radius;
+            packing = 0.9069f;
+        } else if (axisCount == 3) {
+            ball = 4.0f / 3.0f * PI * radius * radius * radius;
+            packing = 0.7405f;
+        }
+        return measure * packing / ball;
+    };
+
+    if (maxPointCount(minSeparation) <= (float)maxPoints) {
+        return minSeparation;
+    }
+
+    // the count only goes down as the separation grows
+    float low = minSeparation;
+    float high = minSeparation;
+    while (maxPointCount(high) > (float)maxPoints) {
+        low = high;
+        high *= 2;
+    }
+    for (int i = 0; i < 32; i++) {
+        float middle = (low + high) / 2;
+        if (maxPointCount(middle) > (float)maxPoints) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+
+    return high;
+}
+
+}
+
+SpawnSampler::SpawnSampler(const Aabb& volume, float minSeparation, RNG& rng)
+    : m_volume(volume)
+    , m_minSeparation(minSeparation)
+{
+    generate(rng);
+    releaseAll();
+}
+
+const Aabb& SpawnSampler::volume() const
+{
+    return m_volume;
+}
+
+float SpawnSampler::minSeparation() const
+{
+    return m_minSeparation;
+}
+
+size_t SpawnSampler::candidateCount() const
+{
+    return m_candidates.size();
+}
+
+glm::vec3 SpawnSampler::candidate(uint32_t index) const
+{
+    return m_candidates[index];
+}
+
+std::optional<uint32_t> SpawnSampler::acquire(RNG& rng)
+{
+    if (m_free.empty()) {
+        return std::nullopt;
+    }
+
+    // swap with the last free one and pop it
+    auto freeIndex = (uint32_t)rng.getIntInRange(0, (int)m_free.size() - 1);
+    uint32_t index = m_free[freeIndex];
+    m_free[freeIndex] = m_free.back();
+    m_freeIndex[m_free[freeIndex]] = freeIndex;
+    m_free.pop_back();
+
+    m_occupied[index / 64] |= uint64_t(1) << (index % 64);
+    return index;
+}
+
+void SpawnSampler::release(uint32_t index)
+{
+    if (!isOccupied(index)) {
+        return;
+    }
+
+    m_occupied[index / 64] &= ~(uint64_t(1) << (index % 64));
+    m_freeIndex[index] = m_free.size();
+    m_free.push_back(index);
+}
+
+void SpawnSampler::releaseAll()
+{
+    m_occupied.assign((m_candidates.size() + 63) / 64, 0);
+    m_free.resize(m_candidates.size());
+    m_freeIndex.resize(m_candidates.size());
+    for (uint32_t i = 0; i < m_candidates.size(); i++) {
+        m_free[i] = i;
+        m_freeIndex[i] = i;
+    }
+}
+
+bool SpawnSampler::isOccupied(uint32_t index) const
+{
+    return (m_occupied[index / 64] >> (index % 64)) & 1;
+}
+
+// Bridson's Poisson disk sampling. New points are tried around existing
+// ones at a distance between r and 2r, and a background grid with cells
+// small enough to hold a single point makes checking the distance to
+// the others O(1). Flat axes (a spawn volume can be a plane) are left
+// out so the points spread over the ones that remain. Bridson grows out
+// of one point, so the separation is raised first for volumes that
+// would need more than MAX_CANDIDATES points, a cut short run would
+// only cover the area around the first one
+void SpawnSampler::generate(RNG& rng)
+{
+    glm::vec3 extent = m_volume.max - m_volume.min;
+    std::array<int, 3> axes {};
+    int axisCount = 0;
+    for (int i = 0; i < 3; i++) {
+        if (extent[i] > 1e-6f) {
+            axes[axisCount++] = i;
+        }
+    }
+
+    if (axisCount == 0 || m_minSeparation <= 0.0f) {
+        m_candidates.push_back(m_volume.center());
+        return;
+    }
+
+    std::array<float, 3> extents {};
+    for (int i = 0; i < axisCount; i++) {
+        extents[i] = extent[axes[i]];
+    }
+    float separation = separationForPointCount(
+        extents, axisCount, m_minSeparation, MAX_CANDIDATES);
+
+    float cellSize = separation / std::sqrt((float)axisCount);
+    std::array<int, 3> gridSize = { 1, 1, 1 };
+    size_t cellCount = 1;
+    for (int i = 0; i < axisCount; i++) {
+        int axis = axes[i];
+        gridSize[axis] = std::max(1, (int)std::ceil(extent[axis] / cellSize));
+        cellCount *= gridSize[axis];
+    }
+    if (cellCount > MAX_GRID_CELLS) {
+        // coarser cells hold more points each, which is only slower
+        float scale = std::pow(
+            (float)cellCount / MAX_GRID_CELLS, 1.0f / (float)axisCount);
+        cellSize *= scale;
+        cellCount = 1;
+        for (int i = 0; i < axisCount; i++) {
+            int axis = axes[i];
+            gridSize[axis]
+                = std::max(1, (int)std::ceil(extent[axis] / cellSize));
+            cellCount *= gridSize[axis];
+        }
+    }
+    // cells of the grid within the separation of a point on each side
+    int reach = (int)std::ceil(separation / cellSize);
+
+    // first point of each cell, the others are linked through next
+    std::vector<int32_t> grid(cellCount, -1);
+    std::vector<int32_t> next;
+    auto cellOf = [&](const glm::vec3& point) {
+        glm::ivec3 cell(0, 0, 0);
+        for (int i = 0; i < axisCount; i++) {
+            int axis = axes[i];
+            cell[axis] = std::clamp(
+                (int)((point[axis] - m_volume.min[axis]) / cellSize), 0,
+                gridSize[axis] - 1);
+        }
+        return cell;
+    };
+    auto gridIndex = [&](const glm::ivec3& cell) {
+        return (size_t)cell.x
+            + (size_t)gridSize[0] * (cell.y + (size_t)gridSize[1] * cell.z);
+    };
+    auto isFarEnough = [&](const glm::vec3& point) {
+        glm::ivec3 cell = cellOf(point);
+        glm::ivec3 first = cell;
+        glm::ivec3 last = cell;
+        for (int i = 0; i < axisCount; i++) {
+            int axis = axes[i];
+            first[axis] = std::max(cell[axis] - reach, 0);
+            last[axis] = std::min(cell[axis] + reach, gridSize[axis] - 1);
+        }
+
+        for (int z = first.z; z <= last.z; z++) {
+            for (int y = first.y; y <= last.y; y++) {
+                for (int x = first.x; x <= last.x; x++) {
+                    int32_t other = grid[gridIndex(glm::ivec3(x, y, z))];
+                    for (; other >= 0; other = next[other]) {
+                        if (glm::length(m_candidates[other] - point)
+                            < separation) {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+
+        return true;
+    };
+    auto addPoint = [&](const glm::vec3& point) {
+        size_t index = gridIndex(cellOf(point));
+        next.push_back(grid[index]);
+        grid[index] = (int32_t)m_candidates.size();
+        m_candidates.push_back(point);
+    };
+
+    glm::vec3 first = m_volume.min;
+    for (int i = 0; i < axisCount; i++) {
+        int axis = axes[i];
+        first[axis] = rng.getFloatInRange(
+            m_volume.min[axis], m_volume.max[axis]);
+    }
+    addPoint(first);
+
+    std::vector<uint32_t> active = { 0 };
+    while (!active.empty() && m_candidates.size() < MAX_CANDIDATES) {
+        auto activeIndex
+            = (size_t)rng.getIntInRange(0, (int)active.size() - 1);
+        glm::vec3 center = m_candidates[active[activeIndex]];
+
+        bool found = false;
+        for (int sample = 0; sample < SAMPLES_PER_POINT; sample++) {
+            // random direction over the axes in use, by rejection
+            glm::vec3 direction(0.0f);
+            float length = 0.0f;
+            do {
+                for (int i = 0; i < axisCount; i++) {
+                    direction[axes[i]] = rng.getFloatInRange(-1.0f, 1.0f);
+                }
+                length = glm::length(direction);
+            } while (length > 1.0f || length < 1e-3f);
+
+            float dist
+                = rng.getFloatInRange(separation, 2 * separation);
+            glm::vec3 point = center + direction / length * dist;
+
+            bool inside = true;
+            for (int i = 0; i < axisCount; i++) {
+                int axis = axes[i];
+                inside = inside && point[axis] >= m_volume.min[axis]
+                    && point[axis] <= m_volume.max[axis];
+            }
+            if (inside && isFarEnough(point)) {
+                active.push_back(m_candidates.size());
+                addPoint(point);
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            active[activeIndex] = active.back();
+            active.pop_back();
+        }
+    }
+}
\ No newline at end of file
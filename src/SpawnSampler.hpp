@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Aabb.hpp"
+#include "RNG.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Spawn points spread over a volume with blue noise: random, but never
+// closer than minSeparation to each other, so targets on them can't
+// overlap and don't bunch up like with plain random positions.
+// The points are generated once, picking a free one is O(1) however
+// many are taken
+class SpawnSampler {
+public:
+    SpawnSampler(const Aabb& volume, float minSeparation, RNG& rng);
+
+    const Aabb& volume() const;
+    float minSeparation() const;
+    size_t candidateCount() const;
+    glm::vec3 candidate(uint32_t index) const;
+
+    // Random free candidate, which is now occupied. nullopt if they are
+    // all taken
+    std::optional<uint32_t> acquire(RNG& rng);
+    void release(uint32_t index);
+    // Frees every candidate, the candidates stay the same
+    void releaseAll();
+    bool isOccupied(uint32_t index) const;
+
+private:
+    // Volumes that would need more points than this are sampled with
+    // a bigger separation, so the points still cover all of them
+    static constexpr size_t MAX_CANDIDATES = 4096;
+
+    void generate(RNG& rng);
+
+    Aabb m_volume;
+    float m_minSeparation;
+    std::vector<glm::vec3> m_candidates;
+    // one bit per candidate
+    std::vector<uint64_t> m_occupied;
+    // free candidates, in no particular order
+    std::vector<uint32_t> m_free;
+    // index in m_free of each free candidate
+    std::vector<uint32_t> m_freeIndex;
+};
\ No newline at end of file
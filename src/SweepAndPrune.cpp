@@ -0,0 +1,146 @@
+#include "SweepAndPrune.hpp"
+
+#include <algorithm>
+
+void SweepAndPrune::add(ColliderHandle collider, bool dynamic)
+{
+    if (collider >= m_entryOf.size()) {
+        m_entryOf.resize(collider + 1);
+    }
+
+    // sorted into place on the next update
+    place({ Aabb(), collider, dynamic }, m_entries.size());
+}
+
+void SweepAndPrune::remove(ColliderHandle collider)
+{
+    // the handle may have been removed and given to another collider
+    // since, only its current entry counts
+    if (collider >= m_entryOf.size() || m_entryOf[collider] >= m_entries.size()
+        || m_entries[m_entryOf[collider]].collider != collider) {
+        return;
+    }
+
+    // erasing would shift everything after it, it's left out of the
+    // next update instead
+    m_entries[m_entryOf[collider]].collider = INVALID_COLLIDER;
+}
+
+void SweepAndPrune::clear()
+{
+    m_entries.clear();
+}
+
+void SweepAndPrune::reserve(size_t count)
+{
+    m_entries.reserve(count);
+    m_entryOf.reserve(count);
+}
+
+void SweepAndPrune::findPairs(
+    const ColliderStore& colliders, std::vector<ColliderPair>& pairs)
+{
+    pairs.clear();
+    refresh(colliders);
+
+    int otherAxis1 = (m_axis + 1) % 3;
+    int otherAxis2 = (m_axis + 2) % 3;
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        const Entry& first = m_entries[i];
+
+        // everything after this one starts after it ends
+        for (size_t j = i + 1; j < m_entries.size()
+             && m_entries[j].bounds.min[m_axis] <= first.bounds.max[m_axis];
+             j++) {
+            const Entry& second = m_entries[j];
+            if (!first.dynamic && !second.dynamic) {
+                continue;
+            }
+
+            if (first.bounds.min[otherAxis1] <= second.bounds.max[otherAxis1]
+                && second.bounds.min[otherAxis1] <= first.bounds.max[otherAxis1]
+                && first.bounds.min[otherAxis2] <= second.bounds.max[otherAxis2]
+                && second.bounds.min[otherAxis2]
+                    <= first.bounds.max[otherAxis2]) {
+                pairs.emplace_back(first.collider, second.collider);
+            }
+        }
+    }
+}
+
+void SweepAndPrune::refresh(const ColliderStore& colliders)
+{
+    // drops the removed entries on the way, keeping the order
+    glm::vec3 sum(0.0f);
+    glm::vec3 sumSquares(0.0f);
+    size_t kept = 0;
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        Entry entry = m_entries[i];
+        if (entry.collider == INVALID_COLLIDER) {
+            continue;
+        }
+
+        entry.bounds = colliders.bounds(entry.collider);
+        glm::vec3 center = entry.bounds.center();
+        sum += center;
+        sumSquares += center * center;
+        place(entry, kept++);
+    }
+    m_entries.resize(kept);
+
+    if (m_entries.empty()) {
+        return;
+    }
+
+    // sweeping along the axis with the most variance leaves the fewest
+    // boxes overlapping on it
+    glm::vec3 mean = sum / (float)m_entries.size();
+    glm::vec3 variance = sumSquares / (float)m_entries.size() - mean * mean;
+    int axis = 0;
+    if (variance.y > variance[axis]) {
+        axis = 1;
+    }
+    if (variance.z > variance[axis]) {
+        axis = 2;
+    }
+
+    bool axisChanged = axis != m_axis;
+    m_axis = axis;
+    sortEntries(axisChanged);
+}
+
+void SweepAndPrune::sortEntries(bool axisChanged)
+{
+    // the previous order means nothing on another axis
+    if (axisChanged) {
+        std::sort(m_entries.begin(), m_entries.end(),
+            [this](const Entry& first, const Entry& second) {
+                return first.bounds.min[m_axis] < second.bounds.min[m_axis];
+            });
+        for (size_t i = 0; i < m_entries.size(); i++) {
+            m_entryOf[m_entries[i].collider] = i;
+        }
+        return;
+    }
+
+    for (size_t i = 1; i < m_entries.size(); i++) {
+        Entry entry = m_entries[i];
+        size_t j = i;
+        while (j > 0
+            && m_entries[j - 1].bounds.min[m_axis] > entry.bounds.min[m_axis]) {
+            place(m_entries[j - 1], j);
+            j--;
+        }
+        place(entry, j);
+    }
+}
+
+void SweepAndPrune::place(const Entry& entry, size_t index)
+{
+    if (index == m_entries.size()) {
+        m_entries.push_back(entry);
+    } else {
+        m_entries[index] = entry;
+    }
+    m_entryOf[entry.collider] = index;
+}
\ No newline at end of file
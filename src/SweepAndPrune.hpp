@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Aabb.hpp"
+#include "ColliderStore.hpp"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using ColliderPair = std::pair<ColliderHandle, ColliderHandle>;
+
+// Sort and sweep broadphase. Colliders are kept sorted by where their
+// box starts along one axis, so only neighbors in that order can
+// overlap. Between updates things barely move, so the order is almost
+// right already and an insertion sort fixes it in about linear time.
+// The axis is the one the colliders are the most spread along
+class SweepAndPrune {
+public:
+    SweepAndPrune() = default;
+
+    // Pairs of static colliders are never reported
+    void add(ColliderHandle collider, bool dynamic);
+    // O(1), the entry is only dropped on the next update
+    void remove(ColliderHandle collider);
+    void clear();
+    void reserve(size_t count);
+
+    // Reads the boxes of the colliders from the store, then finds the
+    // pairs whose boxes overlap
+    void findPairs(
+        const ColliderStore& colliders, std::vector<ColliderPair>& pairs);
+
+private:
+    struct Entry {
+        Aabb bounds;
+        // INVALID_COLLIDER once removed
+        ColliderHandle collider;
+        bool dynamic;
+    };
+
+    void refresh(const ColliderStore& colliders);
+    void sortEntries(bool axisChanged);
+    void place(const Entry& entry, size_t index);
+
+    // sorted by bounds.min[m_axis]
+    std::vector<Entry> m_entries;
+    // index in m_entries of each collider, by handle
+    std::vector<uint32_t> m_entryOf;
+    int m_axis = 0;
+};
\ No newline at end of file
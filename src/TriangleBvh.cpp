@@ -0,0 +1,320 @@
+#include "TriangleBvh.hpp"
+
+#include "Simd.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace {
+
+// triangles per leaf, one SSE register worth
+constexpr uint32_t MAX_LEAF_SIZE = 4;
+// Median splits halve the triangle count at every level, so a tree over
+// a uint32_t count is less deep than this. Traversal keeps at most one
+// node per level waiting, so its stack has a fixed size
+constexpr size_t STACK_SIZE = 33;
+
+}
+
+// https://en.wikipedia.org/wiki/M%C3%B6ller%E2%80%93Trumbore_intersection_algorithm
+// The SIMD version in closestHitInLeaf() does the same operations in
+// the same order
+std::optional<float> intersectRayTriangle(const glm::vec3& eyePos,
+    const glm::vec3& eyeDir, const glm::vec3& vertex0, const glm::vec3& edge1,
+    const glm::vec3& edge2)
+{
+    glm::vec3 p = glm::cross(eyeDir, edge2);
+    float det = glm::dot(edge1, p);
+    // parallel to the triangle
+    if (det == 0.0f) {
+        return std::nullopt;
+    }
+
+    float invDet = 1.0f / det;
+    glm::vec3 toEye = eyePos - vertex0;
+    float u = glm::dot(toEye, p) * invDet;
+    if (u < 0.0f || u > 1.0f) {
+        return std::nullopt;
+    }
+
+    glm::vec3 q = glm::cross(toEye, edge1);
+    float v = glm::dot(eyeDir, q) * invDet;
+    if (v < 0.0f || u + v > 1.0f) {
+        return std::nullopt;
+    }
+
+    float t = glm::dot(edge2, q) * invDet;
+    if (t > 0.0f) {
+        return t;
+    }
+
+    return std::nullopt;
+}
+
+TriangleBvh::TriangleBvh(const std::vector<glm::vec3>& positions,
+    const std::vector<uint32_t>& indices)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    std::vector<Aabb> triangleBounds(triangleCount);
+    std::vector<uint32_t> triangles(triangleCount);
+    for (uint32_t i = 0; i < triangleCount; i++) {
+        for (int j = 0; j < 3; j++) {
+            const glm::vec3& vertex = positions[indices[i * 3 + j]];
+            triangleBounds[i].grow({ vertex, vertex });
+        }
+        triangles[i] = i;
+    }
+
+    m_nodes.reserve(triangleCount * 2);
+    Node root;
+    root.count = triangleCount;
+    for (const Aabb& bounds : triangleBounds) {
+        root.bounds.grow(bounds);
+    }
+    m_nodes.push_back(root);
+    subdivide(triangleBounds, triangles, 0);
+
+    // the leaves now cover contiguous ranges of triangles
+    for (auto* values : { &m_vertex0, &m_edge1, &m_edge2 }) {
+        for (auto& axis : *values) {
+            axis.resize(triangleCount);
+        }
+    }
+    for (uint32_t i = 0; i < triangleCount; i++) {
+        const uint32_t* vertices = &indices[triangles[i] * 3];
+        glm::vec3 vertex0 = positions[vertices[0]];
+        glm::vec3 edge1 = positions[vertices[1]] - vertex0;
+        glm::vec3 edge2 = positions[vertices[2]] - vertex0;
+        for (int axis = 0; axis < 3; axis++) {
+            m_vertex0[axis][i] = vertex0[axis];
+            m_edge1[axis][i] = edge1[axis];
+            m_edge2[axis][i] = edge2[axis];
+        }
+    }
+}
+
+std::optional<float> TriangleBvh::closestHit(const glm::vec3& eyePos,
+    const glm::vec3& eyeDir, float maxDist) const
+{
+    if (m_nodes.empty()) {
+        return std::nullopt;
+    }
+
+    glm::vec3 invDir = 1.0f / eyeDir;
+    std::optional<float> result = std::nullopt;
+    float closestDist = maxDist;
+
+    if (!intersectRayAabb(m_nodes[0].bounds, eyePos, invDir, closestDist)) {
+        return std::nullopt;
+    }
+
+    std::array<uint32_t, STACK_SIZE> stack;
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const Node& node = m_nodes[stack[--stackSize]];
+
+        if (node.count != 0) {
+            auto dist = closestHitInLeaf(node, eyePos, eyeDir, closestDist);
+            if (dist.has_value()) {
+                closestDist = dist.value();
+                result = dist;
+            }
+            continue;
+        }
+
+        // closest child first, same as Bvh
+        uint32_t near = node.first;
+        uint32_t far = node.first + 1;
+        auto tNear = intersectRayAabb(
+            m_nodes[near].bounds, eyePos, invDir, closestDist);
+        auto tFar = intersectRayAabb(
+            m_nodes[far].bounds, eyePos, invDir, closestDist);
+
+        if (tNear.has_value() && tFar.has_value() && *tFar < *tNear) {
+            std::swap(near, far);
+            std::swap(tNear, tFar);
+        }
+
+        if (tFar.has_value()) {
+            stack[stackSize++] = far;
+        }
+        if (tNear.has_value()) {
+            stack[stackSize++] = near;
+        }
+    }
+
+    return result;
+}
+
+const Aabb& TriangleBvh::bounds() const
+{
+    static const Aabb empty;
+    return m_nodes.empty() ? empty : m_nodes[0].bounds;
+}
+
+size_t TriangleBvh::triangleCount() const
+{
+    return m_vertex0[0].size();
+}
+
+// Median split along the longest axis. Meshes don't change after being
+// loaded, a balanced tree is good enough
+void TriangleBvh::subdivide(const std::vector<Aabb>& triangleBounds,
+    std::vector<uint32_t>& triangles, uint32_t nodeIndex)
+{
+    uint32_t first = m_nodes[nodeIndex].first;
+    uint32_t count = m_nodes[nodeIndex].count;
+    if (count <= MAX_LEAF_SIZE) {
+        return;
+    }
+
+    Aabb centroidBounds;
+    for (uint32_t i = first; i < first + count; i++) {
+        glm::vec3 centroid = triangleBounds[triangles[i]].center();
+        centroidBounds.grow({ centroid, centroid });
+    }
+
+    glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+    int axis = 0;
+    if (extent.y > extent[axis]) {
+        axis = 1;
+    }
+    if (extent.z > extent[axis]) {
+        axis = 2;
+    }
+
+    uint32_t leftSize = count / 2;
+    auto begin = triangles.begin() + first;
+    std::nth_element(begin, begin + leftSize, begin + count,
+        [&](uint32_t a, uint32_t b) {
+            return triangleBounds[a].center()[axis]
+                < triangleBounds[b].center()[axis];
+        });
+
+    auto leftIndex = (uint32_t)m_nodes.size();
+    for (uint32_t i = 0; i < 2; i++) {
+        Node child;
+        child.first = i == 0 ? first : first + leftSize;
+        child.count = i == 0 ? leftSize : count - leftSize;
+        for (uint32_t j = child.first; j < child.first + child.count; j++) {
+            child.bounds.grow(triangleBounds[triangles[j]]);
+        }
+        m_nodes.push_back(child);
+    }
+
+    m_nodes[nodeIndex].first = leftIndex;
+    m_nodes[nodeIndex].count = 0;
+
+    subdivide(triangleBounds, triangles, leftIndex);
+    subdivide(triangleBounds, triangles, leftIndex + 1);
+}
+
+std::optional<float> TriangleBvh::closestHitInLeaf(const Node& node,
+    const glm::vec3& eyePos, const glm::vec3& eyeDir, float maxDist) const
+{
+    std::optional<float> result = std::nullopt;
+    float closestDist = maxDist;
+
+    size_t i = node.first;
+    size_t end = node.first + node.count;
+
+#ifdef OPENAIM_SIMD_SSE
+    {
+        __m128 zero = _mm_setzero_ps();
+        __m128 one = _mm_set1_ps(1.0f);
+        __m128 dir[3];
+        __m128 eye[3];
+        for (int axis = 0; axis < 3; axis++) {
+            dir[axis] = _mm_set1_ps(eyeDir[axis]);
+            eye[axis] = _mm_set1_ps(eyePos[axis]);
+        }
+
+        auto load = [](const std::array<std::vector<float>, 3>& values,
+                        size_t index, __m128* out) {
+            for (int axis = 0; axis < 3; axis++) {
+                out[axis] = _mm_loadu_ps(&values[axis][index]);
+            }
+        };
+        auto cross = [](const __m128* a, const __m128* b, __m128* out) {
+            out[0] = _mm_sub_ps(_mm_mul_ps(a[1], b[2]), _mm_mul_ps(a[2], b[1]));
+            out[1] = _mm_sub_ps(_mm_mul_ps(a[2], b[0]), _mm_mul_ps(a[0], b[2]));
+            out[2] = _mm_sub_ps(_mm_mul_ps(a[0], b[1]), _mm_mul_ps(a[1], b[0]));
+        };
+        auto dot = [](const __m128* a, const __m128* b) {
+            return _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(a[0], b[0]), _mm_mul_ps(a[1], b[1])),
+                _mm_mul_ps(a[2], b[2]));
+        };
+
+        for (; i + 4 <= end; i += 4) {
+            __m128 vertex0[3];
+            __m128 edge1[3];
+            __m128 edge2[3];
+            load(m_vertex0, i, vertex0);
+            load(m_edge1, i, edge1);
+            load(m_edge2, i, edge2);
+
+            __m128 p[3];
+            cross(dir, edge2, p);
+            __m128 det = dot(edge1, p);
+            __m128 invDet = _mm_div_ps(one, det);
+
+            __m128 toEye[3];
+            for (int axis = 0; axis < 3; axis++) {
+                toEye[axis] = _mm_sub_ps(eye[axis], vertex0[axis]);
+            }
+            __m128 u = _mm_mul_ps(dot(toEye, p), invDet);
+
+            __m128 q[3];
+            cross(toEye, edge1, q);
+            __m128 v = _mm_mul_ps(dot(dir, q), invDet);
+            __m128 t = _mm_mul_ps(dot(edge2, q), invDet);
+
+            __m128 hit = _mm_and_ps(_mm_cmpneq_ps(det, zero),
+                _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmple_ps(u, one)));
+            hit = _mm_and_ps(hit,
+                _mm_and_ps(_mm_cmpge_ps(v, zero),
+                    _mm_cmple_ps(_mm_add_ps(u, v), one)));
+            hit = _mm_and_ps(hit,
+                _mm_and_ps(_mm_cmpgt_ps(t, zero),
+                    _mm_cmplt_ps(t, _mm_set1_ps(closestDist))));
+
+            auto mask = (unsigned)_mm_movemask_ps(hit);
+            if (mask == 0) {
+                continue;
+            }
+
+            alignas(16) float dists[4];
+            _mm_store_ps(dists, t);
+            while (mask != 0) {
+                int lane = std::countr_zero(mask);
+                mask &= mask - 1;
+                if (dists[lane] < closestDist) {
+                    closestDist = dists[lane];
+                    result = closestDist;
+                }
+            }
+        }
+    }
+#endif
+
+    for (; i < end; i++) {
+        auto dist = intersectRayTriangle(eyePos, eyeDir,
+            { m_vertex0[0][i], m_vertex0[1][i], m_vertex0[2][i] },
+            { m_edge1[0][i], m_edge1[1][i], m_edge1[2][i] },
+            { m_edge2[0][i], m_edge2[1][i], m_edge2[2][i] });
+        if (dist.has_value() && dist.value() < closestDist) {
+            closestDist = dist.value();
+            result = dist;
+        }
+    }
+
+    return result;
+}
\ No newline at end of file
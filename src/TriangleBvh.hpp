@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Aabb.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Distance along the ray, in units of eyeDir, to where it crosses the
+// triangle (Moller-Trumbore). Both sides of the triangle count.
+// edge1 and edge2 go from vertex0 to the two other vertices
+std::optional<float> intersectRayTriangle(const glm::vec3& eyePos,
+    const glm::vec3& eyeDir, const glm::vec3& vertex0, const glm::vec3& edge1,
+    const glm::vec3& edge2);
+
+// Bounding volume hierarchy over the triangles of a model, in the space
+// of the model. Built once when the model is loaded and shared by every
+// entity using it, which only have to bring rays into object space
+class TriangleBvh {
+public:
+    // indices are 3 per triangle
+    TriangleBvh(const std::vector<glm::vec3>& positions,
+        const std::vector<uint32_t>& indices);
+
+    // Distance along the ray, in units of eyeDir, to the closest
+    // triangle hit before maxDist. eyeDir doesn't have to be normalized,
+    // so a ray transformed by a scaled model matrix keeps its distances
+    std::optional<float> closestHit(const glm::vec3& eyePos,
+        const glm::vec3& eyeDir, float maxDist) const;
+
+    const Aabb& bounds() const;
+    size_t triangleCount() const;
+
+private:
+    struct Node {
+        Aabb bounds;
+        // For leaves, index of the first triangle. Otherwise index of
+        // the left child, the right one is right after
+        uint32_t first = 0;
+        // 0 for internal nodes
+        uint32_t count = 0;
+    };
+
+    void subdivide(const std::vector<Aabb>& triangleBounds,
+        std::vector<uint32_t>& triangles, uint32_t nodeIndex);
+    std::optional<float> closestHitInLeaf(const Node& node,
+        const glm::vec3& eyePos, const glm::vec3& eyeDir,
+        float maxDist) const;
+
+    std::vector<Node> m_nodes;
+    // Triangles in leaf order as a structure of arrays, so the triangles
+    // of a leaf can be tested 4 at a time
+    std::array<std::vector<float>, 3> m_vertex0;
+    std::array<std::vector<float>, 3> m_edge1;
+    std::array<std::vector<float>, 3> m_edge2;
+};
\ No newline at end of file
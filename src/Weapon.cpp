@@ -2,21 +2,106 @@
 
 #include "Globals.hpp"
 
-bool Weapon::tryShoot(float currentTimeMs, bool holdingMouseLeft)
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// a long hitch shouldn't turn into a wall of shots
+constexpr size_t MAX_SHOTS_PER_UPDATE = 32;
+
+}
+
+void Weapon::setDefinition(const WeaponDefinition& definition)
+{
+    m_definition = definition;
+    m_lastTimeFiredMs = 0.0;
+    m_consecutiveShots = 0;
+}
+
+const WeaponDefinition& Weapon::definition() const
+{
+    return m_definition;
+}
+
+void Weapon::dueShots(double fromMs, double toMs, bool triggerHeld,
+    std::optional<double> pressTimeMs, std::vector<double>& shotTimesMs) const
 {
-    if (type == Type::Pistol && holdingMouseLeft) {
-        return false;
+    shotTimesMs.clear();
+    if (!triggerHeld || (!m_definition.automatic && !pressTimeMs.has_value())) {
+        return;
+    }
+
+    // a press can be timestamped a bit outside of the update, input is
+    // polled on its own schedule
+    double triggerMs = std::clamp(pressTimeMs.value_or(fromMs), fromMs, toMs);
+    double readyMs = m_lastTimeFiredMs + m_definition.shotDelayMs;
+
+    if (!m_definition.automatic) {
+        // too early, the press is ignored
+        if (triggerMs >= readyMs) {
+            shotTimesMs.push_back(triggerMs);
+        }
+        return;
     }
 
-    if (currentTimeMs - m_lastTimeFiredMs >= m_shootDelaysMs[(int)type]) {
-        if (type == Type::Pistol) {
-            g_soundPlayer->playWithRandomPitch("pistol");
-        } else if (type == Type::Machine_Gun) {
-            g_soundPlayer->playIfNotAlreadyPlaying("machine_gun");
+    // from one shot to the next without rounding to frames, but the
+    // trigger has to be down for it to start
+    double firstMs = std::max(triggerMs, readyMs);
+    for (size_t i = 0; i < MAX_SHOTS_PER_UPDATE; i++) {
+        double timeMs = firstMs + (double)i * m_definition.shotDelayMs;
+        if (timeMs > toMs) {
+            break;
         }
-        m_lastTimeFiredMs = currentTimeMs;
-        return true;
+        shotTimesMs.push_back(timeMs);
+    }
+}
+
+void Weapon::fire(double timeMs)
+{
+    if (timeMs - m_lastTimeFiredMs > m_definition.recoilResetMs) {
+        m_consecutiveShots = 0;
+    }
+    m_consecutiveShots++;
+
+    if (m_definition.soundMode == WeaponDefinition::SoundMode::Continuous) {
+        g_soundPlayer->playIfNotAlreadyPlaying(m_definition.sound);
+    } else {
+        g_soundPlayer->playWithRandomPitch(m_definition.sound);
+    }
+    m_lastTimeFiredMs = timeMs;
+}
+
+void Weapon::pelletDirections(const glm::vec3& front, const glm::vec3& right,
+    const glm::vec3& up, std::vector<glm::vec3>& directions) const
+{
+    directions.clear();
+    if (m_definition.spreadDegrees <= 0.0f) {
+        directions.assign(std::max(m_definition.pellets, 1), front);
+        return;
     }
 
-    return false;
+    // uniform over the cap of the unit sphere inside the cone, so pellets
+    // don't bunch up in the middle
+    float minCos = std::cos(glm::radians(m_definition.spreadDegrees));
+    for (int i = 0; i < m_definition.pellets; i++) {
+        float cosAngle = g_rng->getFloatInRange(minCos, 1.0f);
+        float sinAngle = std::sqrt(1.0f - cosAngle * cosAngle);
+        float around = g_rng->getFloatInRange(0.0f, glm::two_pi<float>());
+
+        glm::vec3 offset = right * std::cos(around) + up * std::sin(around);
+        directions.push_back(front * cosAngle + offset * sinAngle);
+    }
 }
+
+glm::vec2 Weapon::recoil() const
+{
+    const auto& pattern = m_definition.recoilPattern;
+    if (pattern.empty() || m_consecutiveShots == 0) {
+        return glm::vec2(0.0f);
+    }
+
+    return pattern[std::min(m_consecutiveShots, pattern.size()) - 1];
+}
\ No newline at end of file
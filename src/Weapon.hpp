@@ -1,24 +1,69 @@
 #pragma once
 
-#include <array>
+#include <glm/glm.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+// What a weapon does, read from resources/weapons
+struct WeaponDefinition {
+    enum class SoundMode {
+        // new sound every shot, with a random pitch
+        Pitched,
+        // only starts the sound if it isn't playing, for fast weapons
+        Continuous,
+    };
+
+    std::string name;
+    float shotDelayMs = 100.0f;
+    // keeps firing while the button is held
+    bool automatic = false;
+    // rays per shot
+    int pellets = 1;
+    // half angle of the cone the pellets are spread in
+    float spreadDegrees = 0.0f;
+    // camera kick (yaw, pitch) in degrees of each consecutive shot. The
+    // last one repeats once the pattern runs out
+    std::vector<glm::vec2> recoilPattern;
+    // time without shooting after which the pattern starts over
+    float recoilResetMs = 300.0f;
+    std::string sound;
+    SoundMode soundMode = SoundMode::Pitched;
+};
 
 class Weapon {
 public:
     Weapon() = default;
 
-    enum class Type {
-        Pistol,
-        Machine_Gun,
-        Last,
-    };
+    void setDefinition(const WeaponDefinition& definition);
+    const WeaponDefinition& definition() const;
 
-    bool tryShoot(float currentTimeMs, bool holdingMouseLeft);
+    // Times of the shots due in (fromMs, toMs], in order, in the
+    // milliseconds of glfwGetTime(). Automatic weapons fire exactly every
+    // shotDelayMs while the trigger is held, whatever the frame rate,
+    // others once per press. pressTimeMs is when the trigger was pressed
+    // if it was since the last call
+    void dueShots(double fromMs, double toMs, bool triggerHeld,
+        std::optional<double> pressTimeMs,
+        std::vector<double>& shotTimesMs) const;
+    // Plays the sound and moves along the recoil pattern. To call for
+    // each of the times from dueShots(), in order
+    void fire(double timeMs);
 
-    Type type = Type::Pistol;
+    // Directions of the pellets of a shot towards front, spread in the
+    // cone of the weapon. right and up complete the basis of the camera
+    void pelletDirections(const glm::vec3& front, const glm::vec3& right,
+        const glm::vec3& up, std::vector<glm::vec3>& directions) const;
+    // Camera kick (yaw, pitch) of the last shot, in degrees
+    glm::vec2 recoil() const;
 
 private:
-    const std::array<float, (int)Type::Last> m_shootDelaysMs
-        = { 100.0f, 25.0f };
+    WeaponDefinition m_definition;
 
-    float m_lastTimeFiredMs = 0.0f;
+    // the time it was scheduled at, not when it was handled, so the fire
+    // rate doesn't depend on frame times
+    double m_lastTimeFiredMs = 0.0;
+    // shots fired without stopping, the position in the recoil pattern
+    size_t m_consecutiveShots = 0;
 };
\ No newline at end of file